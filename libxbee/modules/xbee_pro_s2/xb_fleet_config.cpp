@@ -0,0 +1,13 @@
+/* LibXBEE Includes */
+#include <libxbee/include/modules/xbee_pro_s2/xb_fleet_config.hpp>
+
+namespace libxbee
+{
+    namespace modules
+    {
+        namespace XBEEProS2
+        {
+            template class XBBasicFleetConfigurator<XBEEProS2>;
+        }
+    }
+}
@@ -0,0 +1,589 @@
+/**
+ * @file xb_fleet_config.hpp
+ */
+
+#ifndef XBEE_FLEET_CONFIG_HPP
+#define XBEE_FLEET_CONFIG_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/modules/xbee_pro_s2/xbpros2.hpp>
+
+/** Nodes that can be configured at once. Each has one Remote AT Command outstanding at a time. */
+#ifndef XB_FLEET_MAX_CONCURRENCY
+#define XB_FLEET_MAX_CONCURRENCY 16
+#endif
+
+#define XB_FLEET_MAX_SETTINGS       32      /**< Registers in one profile, one bit each in a node's pending mask */
+
+namespace libxbee
+{
+    namespace modules
+    {
+        namespace XBEEProS2
+        {
+            /** One register of a fleet profile */
+            struct XBRegisterSetting
+            {
+                const char* command;            /**< Register to set, e.g. "ATNJ" or "NJ" */
+                uint32_t value;
+                uint8_t width;                  /**< Parameter bytes to send, 0 for the fewest that hold the value */
+            };
+
+            struct XBFleetStats
+            {
+                size_t nodesConfigured = 0;     /**< Nodes that had at least one register written */
+                size_t nodesUnchanged = 0;      /**< Nodes that already matched the profile */
+                size_t nodesFailed = 0;         /**< Nodes given up on */
+                size_t commands = 0;            /**< Remote AT Commands put on the wire, including retries */
+                size_t reads = 0;               /**< Register reads answered */
+                size_t writes = 0;              /**< Register writes answered */
+                size_t skipped = 0;             /**< Writes left out because the register already held the value */
+                size_t retries = 0;             /**< Commands that were repeats of a failed one */
+                size_t timeouts = 0;            /**< Commands whose response never arrived */
+                size_t inFlightHighWater = 0;   /**< Most commands outstanding at once */
+                size_t elapsed_mS = 0;          /**< Time from start() until the last node finished */
+            };
+
+            /** Reports the outcome for one node
+             *  status is XB_OK once the node holds the profile, or the status of the command that failed. changed is the
+             *  number of registers that were written. */
+            typedef void (*XBNodeConfiguredCallback)(uint64_t address64, XBStatus status, size_t changed, void* context);
+
+            /** Parallel Fleet Configuration
+             *  Pushes a register profile to many remote nodes with Remote AT Commands (0x17). Configuring nodes one
+             *  after another costs a full RF round trip per register, so this keeps up to concurrency nodes in progress
+             *  at once, each with one command outstanding. Responses (0x97) are matched back by frame ID through the
+             *  driver's receive dispatcher, so a slow or unreachable node doesn't hold up the others.
+             *
+             *  Per node, the registers are first read back when diffOnly is set, and only the ones that differ are
+             *  written. The last write carries the apply changes option, so the node switches over to the new values
+             *  in one step, and WR then makes them persistent. A node that already matches is left alone entirely.
+             *  A command that failed for a transient reason (no RF acknowledgement, or the response never arrived) is
+             *  repeated after a backoff, up to maxRetries times; any other failure gives up on the node.
+             *
+             *  Neither the profile nor the node list is copied, so both must stay valid until the run is finished.
+             *  The driver must already be in API mode.
+             *
+             *  @tparam Driver      Driver the Remote AT Commands are sent through
+             **/
+            template<typename Driver = XBEEProS2>
+            class XBBasicFleetConfigurator
+            {
+            public:
+                /** Sets the registers to push
+                 *  @return XB_OK, or XB_INVALID_PARAM if a run is in progress, there are more than XB_FLEET_MAX_SETTINGS,
+                 *          a command isn't a two character code or a value doesn't fit its width */
+                XBStatus setProfile(const XBRegisterSetting* settings, size_t count);
+
+                /** Starts configuring the given nodes
+                 *  @return XB_OK, XB_INVALID_PARAM without a profile or nodes, or XB_BUFFER_OVERRUN if a run is
+                 *          still in progress */
+                XBStatus start(const uint64_t* nodes, size_t count);
+
+                /** Runs the driver's receive dispatcher, advances nodes whose response has arrived and starts new ones
+                 *  @param[in]  timeout_mS  How long to wait for incoming frames */
+                void service(size_t timeout_mS = 0);
+
+                /** Services the run until every node has finished
+                 *  @return XB_OK if every node holds the profile, XB_FAILED_COMMAND if any node failed, or XB_TIMEOUT
+                 *          if timeout_mS ran out first */
+                XBStatus run(size_t timeout_mS);
+
+                /** True while nodes are waiting or in progress */
+                bool busy() { return remaining != 0; }
+
+                /** Sets how many nodes are configured at once, clamped to XB_FLEET_MAX_CONCURRENCY and the frame ID
+                 *  table size */
+                void setConcurrency(size_t nodes);
+                size_t getConcurrency() { return concurrency; }
+
+                /** Called once per node with its outcome */
+                void setCallback(XBNodeConfiguredCallback callback, void* context = nullptr);
+
+                XBFleetStats getStats();
+                void resetStats();
+
+                bool diffOnly = true;           /**< Read each register first and only write the ones that differ */
+                bool persist = true;            /**< Send WR to nodes that had registers written */
+                size_t maxRetries = 3;          /**< Repeats of a failed command before giving up on the node */
+                size_t retryBackoff_mS = 100;   /**< Wait before a repeat, multiplied by the attempt number */
+                size_t responseTimeout_mS = Driver::XB_ASYNC_TIMEOUT_mS;  /**< How long to wait for a response */
+
+                XBBasicFleetConfigurator(Driver& xbee, size_t concurrency = 8);
+
+                /** Cancels the requests still waiting on a response, so none can reach a destroyed worker. Nodes left
+                 *  unfinished aren't reported to the callback. */
+                ~XBBasicFleetConfigurator();
+
+                XBBasicFleetConfigurator(const XBBasicFleetConfigurator&) = delete;
+                XBBasicFleetConfigurator& operator=(const XBBasicFleetConfigurator&) = delete;
+
+            private:
+                enum Phase : uint8_t
+                {
+                    PHASE_READ,             /**< Reading the profile registers back */
+                    PHASE_WRITE,            /**< Writing the registers that differ */
+                    PHASE_PERSIST,          /**< Waiting on WR */
+                };
+
+                struct Worker
+                {
+                    bool active;
+                    bool inFlight;
+                    bool responded;         /**< Response arrived, waiting to be handled by service() */
+                    Phase phase;
+                    uint8_t index;          /**< Profile entry being read or written */
+                    uint8_t attempts;       /**< Times the current command has been sent */
+                    uint64_t address64;
+                    uint16_t address16;
+                    uint32_t pending;       /**< Profile entries still to be written */
+                    size_t changed;
+                    size_t retryAt_mS;
+                    XBStatus status;
+                    uint32_t value;         /**< Register value from a read response */
+                    bool valueValid;        /**< False if the response held no value or one wider than 4 bytes */
+                    XBRequestHandle handle;
+                    XBBasicFleetConfigurator* owner;
+                };
+
+                Driver& xbee;
+                Worker workers[XB_FLEET_MAX_CONCURRENCY];
+                size_t concurrency;
+
+                const XBRegisterSetting* settings = nullptr;
+                size_t settingCount = 0;
+
+                const uint64_t* nodes = nullptr;
+                size_t nodeCount = 0;
+                size_t nextNode = 0;
+                size_t remaining = 0;
+                size_t outstanding = 0;
+                size_t failedThisRun = 0;
+
+                XBNodeConfiguredCallback callback = nullptr;
+                void* callbackContext = nullptr;
+
+                XBFleetStats stats;
+                size_t start_mS = 0;
+                size_t lastFinish_mS = 0;
+
+                /** Completion callback handed to the driver. The context is the worker. */
+                static void onResponse(const XBCompletion& completion, void* context);
+
+                /** Acts on the response a worker received */
+                void advance(Worker& worker, size_t now_mS);
+
+                /** Sends the worker's next command, or finishes the node if there is nothing left to do */
+                void issue(Worker& worker, size_t now_mS);
+
+                void finish(Worker& worker, XBStatus status, size_t now_mS);
+
+                /** Bytes a setting is sent with */
+                static size_t widthOf(const XBRegisterSetting& setting);
+            };
+
+            typedef XBBasicFleetConfigurator<XBEEProS2> XBFleetConfigurator;
+
+            template<typename Driver>
+            XBBasicFleetConfigurator<Driver>::XBBasicFleetConfigurator(Driver& xbee, size_t concurrency) : xbee(xbee)
+            {
+                for (Worker& worker : workers)
+                {
+                    worker = Worker();
+                    worker.owner = this;
+                }
+                setConcurrency(concurrency);
+            }
+
+            template<typename Driver>
+            XBBasicFleetConfigurator<Driver>::~XBBasicFleetConfigurator()
+            {
+                for (Worker& worker : workers)
+                {
+                    if (worker.inFlight && !worker.responded)
+                    {
+                        xbee.requestTable().cancel(worker.handle);
+                    }
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicFleetConfigurator<Driver>::setConcurrency(size_t nodes)
+            {
+                nodes = (nodes < XB_FLEET_MAX_CONCURRENCY) ? nodes : XB_FLEET_MAX_CONCURRENCY;
+                nodes = (nodes < XB_MAX_PENDING_REQUESTS) ? nodes : XB_MAX_PENDING_REQUESTS;
+                concurrency = nodes ? nodes : 1;
+            }
+
+            template<typename Driver>
+            void XBBasicFleetConfigurator<Driver>::setCallback(XBNodeConfiguredCallback callback, void* context)
+            {
+                this->callback = callback;
+                callbackContext = context;
+            }
+
+            template<typename Driver>
+            size_t XBBasicFleetConfigurator<Driver>::widthOf(const XBRegisterSetting& setting)
+            {
+                if (setting.width)
+                {
+                    return setting.width;
+                }
+
+                size_t width = 1;
+                while ((width < 4) && (setting.value >> (8 * width)))
+                {
+                    width++;
+                }
+
+                return width;
+            }
+
+            template<typename Driver>
+            XBStatus XBBasicFleetConfigurator<Driver>::setProfile(const XBRegisterSetting* settings, size_t count)
+            {
+                if (busy() || (count > XB_FLEET_MAX_SETTINGS) || (count && !settings))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    size_t width = widthOf(settings[i]);
+
+                    if (!commandCode(settings[i].command) || (width > 4) ||
+                        ((width < 4) && (settings[i].value >> (8 * width))))
+                    {
+                        return XB_INVALID_PARAM;
+                    }
+                }
+
+                this->settings = settings;
+                settingCount = count;
+                return XB_OK;
+            }
+
+            template<typename Driver>
+            XBStatus XBBasicFleetConfigurator<Driver>::start(const uint64_t* nodes, size_t count)
+            {
+                if (!settingCount || !nodes || !count)
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                if (busy())
+                {
+                    return XB_BUFFER_OVERRUN;
+                }
+
+                this->nodes = nodes;
+                nodeCount = count;
+                nextNode = 0;
+                remaining = count;
+                failedThisRun = 0;
+                start_mS = platform::millis();
+                lastFinish_mS = start_mS;
+
+                service(0);
+                return XB_OK;
+            }
+
+            template<typename Driver>
+            void XBBasicFleetConfigurator<Driver>::service(size_t timeout_mS)
+            {
+                /* Only block when there's actually something to wait for */
+                xbee.processIncoming(outstanding ? timeout_mS : 0);
+
+                size_t now = platform::millis();
+
+                for (size_t i = 0; i < concurrency; i++)
+                {
+                    Worker& worker = workers[i];
+
+                    if (worker.active && worker.responded)
+                    {
+                        advance(worker, now);
+                    }
+
+                    if (!worker.active && (nextNode < nodeCount))
+                    {
+                        worker.active = true;
+                        worker.inFlight = false;
+                        worker.responded = false;
+                        worker.phase = diffOnly ? PHASE_READ : PHASE_WRITE;
+                        worker.index = 0;
+                        worker.attempts = 0;
+                        worker.address64 = nodes[nextNode++];
+                        worker.address16 = XB_ADDRESS_16_UNKNOWN;
+                        worker.pending = diffOnly ? 0 : (uint32_t)((1ull << settingCount) - 1);
+                        worker.changed = 0;
+                        worker.retryAt_mS = now;
+                    }
+
+                    if (worker.active && !worker.inFlight && ((long)(now - worker.retryAt_mS) >= 0))
+                    {
+                        issue(worker, now);
+                    }
+                }
+            }
+
+            template<typename Driver>
+            XBStatus XBBasicFleetConfigurator<Driver>::run(size_t timeout_mS)
+            {
+                size_t startTime = platform::millis();
+
+                while (busy())
+                {
+                    size_t elapsed = platform::millis() - startTime;
+                    if (elapsed >= timeout_mS)
+                    {
+                        return XB_TIMEOUT;
+                    }
+
+                    /* With nothing outstanding the only thing left is a retry backoff, so don't spin through it */
+                    if (!outstanding)
+                    {
+                        platform::delayMilliseconds(1);
+                    }
+
+                    service(timeout_mS - elapsed);
+                }
+
+                return failedThisRun ? XB_FAILED_COMMAND : XB_OK;
+            }
+
+            template<typename Driver>
+            void XBBasicFleetConfigurator<Driver>::onResponse(const XBCompletion& completion, void* context)
+            {
+                Worker* worker = static_cast<Worker*>(context);
+
+                if (!worker->inFlight || worker->responded || (worker->handle.frameID != completion.frameID))
+                {
+                    return;
+                }
+
+                worker->status = completion.status;
+                worker->responded = true;
+                worker->owner->outstanding--;
+
+                /* Register values come back big-endian in as many bytes as the register is wide */
+                worker->value = 0;
+                worker->valueValid = (completion.dataLength > 0) && (completion.dataLength <= 4);
+                for (size_t i = 0; worker->valueValid && (i < completion.dataLength); i++)
+                {
+                    worker->value = (worker->value << 8) | completion.data[i];
+                }
+
+                /* Later commands to this node can skip the network address discovery */
+                if ((completion.status == XB_OK) && (completion.address16 != XB_ADDRESS_16_UNKNOWN))
+                {
+                    worker->address16 = completion.address16;
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicFleetConfigurator<Driver>::advance(Worker& worker, size_t now_mS)
+            {
+                worker.responded = false;
+                worker.inFlight = false;
+
+                if (worker.status == XB_TIMEOUT)
+                {
+                    stats.timeouts++;
+                }
+
+                if (worker.status != XB_OK)
+                {
+                    /* Only failures the next attempt could fix are retried. A rejected register or value isn't. */
+                    bool transient = (worker.status == XB_NO_RESPONSE) || (worker.status == XB_TIMEOUT);
+
+                    if (transient && (worker.attempts <= maxRetries))
+                    {
+                        worker.retryAt_mS = now_mS + (retryBackoff_mS * worker.attempts);
+                    }
+                    else
+                    {
+                        finish(worker, worker.status, now_mS);
+                    }
+                    return;
+                }
+
+                worker.attempts = 0;
+                worker.retryAt_mS = now_mS;
+
+                switch (worker.phase)
+                {
+                case PHASE_READ:
+                    stats.reads++;
+                    if (worker.valueValid && (worker.value == settings[worker.index].value))
+                    {
+                        stats.skipped++;
+                    }
+                    else
+                    {
+                        worker.pending |= (uint32_t)1 << worker.index;
+                    }
+                    worker.index++;
+                    break;
+
+                case PHASE_WRITE:
+                    stats.writes++;
+                    worker.pending &= ~((uint32_t)1 << worker.index);
+                    worker.changed++;
+                    worker.index++;
+                    break;
+
+                case PHASE_PERSIST:
+                    finish(worker, XB_OK, now_mS);
+                    break;
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicFleetConfigurator<Driver>::issue(Worker& worker, size_t now_mS)
+            {
+                const char* command = nullptr;
+                uint8_t param[4];
+                size_t paramLength = 0;
+                uint8_t options = 0;
+
+                if (worker.phase == PHASE_READ)
+                {
+                    if (worker.index < settingCount)
+                    {
+                        command = settings[worker.index].command;
+                    }
+                    else
+                    {
+                        worker.phase = PHASE_WRITE;
+                        worker.index = 0;
+                    }
+                }
+
+                if (worker.phase == PHASE_WRITE)
+                {
+                    while ((worker.index < settingCount) && !(worker.pending & ((uint32_t)1 << worker.index)))
+                    {
+                        worker.index++;
+                    }
+
+                    if (worker.index < settingCount)
+                    {
+                        const XBRegisterSetting& setting = settings[worker.index];
+                        command = setting.command;
+                        paramLength = widthOf(setting);
+
+                        for (size_t i = 0; i < paramLength; i++)
+                        {
+                            param[i] = (uint8_t)(setting.value >> (8 * (paramLength - 1 - i)));
+                        }
+
+                        /* The last write switches the node over to all of the new values at once */
+                        if (!(worker.pending >> worker.index >> 1))
+                        {
+                            options = XB_REMOTE_AT_APPLY_CHANGES;
+                        }
+                    }
+                    else if (worker.changed && persist)
+                    {
+                        worker.phase = PHASE_PERSIST;
+                    }
+                    else
+                    {
+                        finish(worker, XB_OK, now_mS);
+                        return;
+                    }
+                }
+
+                if (worker.phase == PHASE_PERSIST)
+                {
+                    command = XB_WRITE_MEMORY;
+                }
+
+                XBStatus result = xbee.remoteATCommandAsync(worker.address64, worker.address16, options, command,
+                    paramLength ? param : nullptr, paramLength, worker.handle, &XBBasicFleetConfigurator::onResponse, &worker,
+                    responseTimeout_mS);
+
+                if (result == XB_BUFFER_OVERRUN)
+                {
+                    /* Every frame ID is taken by someone else's requests. Try again on the next service(). */
+                    return;
+                }
+
+                if (result != XB_OK)
+                {
+                    finish(worker, result, now_mS);
+                    return;
+                }
+
+                if (worker.attempts)
+                {
+                    stats.retries++;
+                }
+
+                worker.attempts++;
+                worker.inFlight = true;
+                stats.commands++;
+                outstanding++;
+
+                if (outstanding > stats.inFlightHighWater)
+                {
+                    stats.inFlightHighWater = outstanding;
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicFleetConfigurator<Driver>::finish(Worker& worker, XBStatus status, size_t now_mS)
+            {
+                if (status != XB_OK)
+                {
+                    stats.nodesFailed++;
+                    failedThisRun++;
+                }
+                else if (worker.changed)
+                {
+                    stats.nodesConfigured++;
+                }
+                else
+                {
+                    stats.nodesUnchanged++;
+                }
+
+                worker.active = false;
+                worker.inFlight = false;
+                remaining--;
+                lastFinish_mS = now_mS;
+
+                if (callback)
+                {
+                    callback(worker.address64, status, worker.changed, callbackContext);
+                }
+            }
+
+            template<typename Driver>
+            XBFleetStats XBBasicFleetConfigurator<Driver>::getStats()
+            {
+                XBFleetStats snapshot = stats;
+                snapshot.elapsed_mS = lastFinish_mS - start_mS;
+                return snapshot;
+            }
+
+            template<typename Driver>
+            void XBBasicFleetConfigurator<Driver>::resetStats()
+            {
+                stats = XBFleetStats();
+                start_mS = platform::millis();
+                lastFinish_mS = start_mS;
+            }
+
+            extern template class XBBasicFleetConfigurator<XBEEProS2>;
+        }
+    }
+}
+
+#endif /* !XBEE_FLEET_CONFIG_HPP */
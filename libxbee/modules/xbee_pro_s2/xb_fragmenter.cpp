@@ -0,0 +1,13 @@
+/* LibXBEE Includes */
+#include <libxbee/include/modules/xbee_pro_s2/xb_fragmenter.hpp>
+
+namespace libxbee
+{
+    namespace modules
+    {
+        namespace XBEEProS2
+        {
+            template class XBBasicFragmenter<XBEEProS2>;
+        }
+    }
+}
@@ -0,0 +1,679 @@
+/**
+ * @file xb_fragmenter.hpp
+ */
+
+#ifndef XBEE_FRAGMENTER_HPP
+#define XBEE_FRAGMENTER_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/modules/xbee_pro_s2/xbpros2.hpp>
+#include <libxbee/include/modules/xbee_pro_s2/xb_transmit_window.hpp>
+
+/** Most fragments in one message. Each reassembly session keeps one bit per fragment. */
+#ifndef XB_FRAGMENT_MAX_FRAGMENTS
+#define XB_FRAGMENT_MAX_FRAGMENTS 1024
+#endif
+
+/** Peers that can have a message in reassembly at once */
+#ifndef XB_FRAGMENT_MAX_PEERS
+#define XB_FRAGMENT_MAX_PEERS 4
+#endif
+
+#define XB_FRAGMENT_MARKER          ((uint8_t)0xF5)     /**< First payload byte of every fragment */
+#define XB_FRAGMENT_HEADER_SIZE     ((size_t)7)         /**< [marker][message id][index:16][count:16][chunk size] */
+
+namespace libxbee
+{
+    namespace modules
+    {
+        namespace XBEEProS2
+        {
+            struct XBFragmentStats
+            {
+                size_t messagesSent = 0;        /**< Outgoing messages whose every fragment was delivered */
+                size_t messagesFailed = 0;      /**< Outgoing messages with an undeliverable fragment */
+                size_t fragmentsSent = 0;       /**< Outgoing fragments handed to the transmit window */
+                size_t messagesReceived = 0;    /**< Incoming messages fully reassembled */
+                size_t fragmentsReceived = 0;   /**< Incoming fragments placed in a reassembly buffer */
+                size_t duplicates = 0;          /**< Incoming fragments that had already been received */
+                size_t outOfOrder = 0;          /**< Incoming fragments that didn't follow the previous one */
+                size_t abandoned = 0;           /**< Incoming messages dropped before they were complete */
+                size_t rejected = 0;            /**< Incoming fragments that were malformed or had nowhere to go */
+            };
+
+            /** Supplies the reassembly buffer for a new incoming message
+             *
+             *  @param[in]  peer        Sending node
+             *  @param[in]  messageID   Sender's message ID
+             *  @param[in]  maxLength   Upper bound of the message size, from its fragment count and size
+             *  @param[out] capacity    Size of the returned buffer
+             *  @param[in]  context     Registered with the provider
+             *  @return     uint8_t*    Buffer the fragments are written into, or nullptr to refuse the message
+             **/
+            typedef uint8_t* (*XBFragmentBufferProvider)(uint64_t peer, uint8_t messageID, size_t maxLength,
+                size_t& capacity, void* context);
+
+            /** Hands a reassembly buffer back to its owner
+             *  status is XB_OK for a complete message of the given length, XB_TIMEOUT if the sender went quiet,
+             *  XB_BUFFER_TOO_SMALL if the message didn't fit, or XB_BAD_RESULT if a newer message from the same peer
+             *  replaced it. */
+            typedef void (*XBMessageCallback)(uint64_t peer, uint8_t messageID, XBStatus status, uint8_t* buffer,
+                size_t length, void* context);
+
+            /** Reports the outcome of sendMessage() */
+            typedef void (*XBMessageSentCallback)(uint32_t tag, XBStatus status, void* context);
+
+            /** Message Fragmentation and Reassembly
+             *  Carries messages larger than the module's RF payload limit (ATNP). Outgoing messages are split into
+             *  fragments of up to NP bytes, each led by a small header with the message ID, fragment index, fragment
+             *  count and fragment size. They go out through a sliding transmit window, so delivery is confirmed and
+             *  failed fragments are retried.
+             *
+             *  Incoming fragments are written straight from the received frame into a buffer the application supplies,
+             *  at the offset given by their index. The fragments of a message may arrive in any order, and duplicates
+             *  are detected and dropped. Memory is bounded: each peer gets at most one message in reassembly, and at
+             *  most XB_FRAGMENT_MAX_PEERS peers at once, each tracked by a fixed bitmap of XB_FRAGMENT_MAX_FRAGMENTS
+             *  bits. A message that stops arriving for reassemblyTimeout_mS is abandoned.
+             *
+             *  Receive Packet payloads that don't start with XB_FRAGMENT_MARKER are left alone, so fragmented and plain
+             *  traffic can share the link.
+             *
+             *  @tparam Driver      Driver the fragments are sent and received through
+             **/
+            template<typename Driver = XBEEProS2>
+            class XBBasicFragmenter
+            {
+            public:
+                /** Subscribes to Receive Packets and reads ATNP so fragments use the largest payload the network allows.
+                 *  Nothing is reassembled until this has succeeded, and until then XB_TX_MAX_PAYLOAD is assumed.
+                 *
+                 *  @return     XBStatus    XB_OK, XB_BUFFER_OVERRUN if a message is being sent or the driver has no
+                 *                          free frame handler, or the error from reading ATNP
+                 **/
+                XBStatus initialize();
+
+                /** Starts sending a message. The data must stay valid until the sent callback reports the outcome.
+                 *
+                 *  @param[in]  address64   Destination node
+                 *  @param[in]  address16   Destination network address, XB_ADDRESS_16_UNKNOWN if not known
+                 *  @param[in]  data        The message
+                 *  @param[in]  length      Number of bytes, up to XB_FRAGMENT_MAX_FRAGMENTS fragments worth
+                 *  @param[in]  tag         Passed to the sent callback
+                 *  @return     XBStatus    XB_OK if started, XB_BUFFER_OVERRUN if a message is still being sent,
+                 *                          XB_INVALID_PARAM if the message is empty or too large
+                 **/
+                XBStatus sendMessage(uint64_t address64, uint16_t address16, const uint8_t* data, size_t length,
+                    uint32_t tag = 0);
+
+                /** True while an outgoing message has fragments that haven't been confirmed */
+                bool isSending() { return sending; }
+
+                /** Runs the receive dispatcher, feeds the transmit window and expires stale reassemblies
+                 *  @param[in]  timeout_mS  How long to wait for incoming frames */
+                void service(size_t timeout_mS = 0);
+
+                /** Handles one Receive Packet (0x90) frame. Called automatically through the driver's frame handlers.
+                 *  @return True if the payload was a fragment */
+                bool receive(const uint8_t* frame, size_t length);
+
+                void setBufferProvider(XBFragmentBufferProvider provider, void* context = nullptr);
+                void setMessageCallback(XBMessageCallback callback, void* context = nullptr);
+                void setSentCallback(XBMessageSentCallback callback, void* context = nullptr);
+
+                /** Payload bytes carried by each fragment */
+                size_t chunkSize() { return payloadLimit - XB_FRAGMENT_HEADER_SIZE; }
+
+                /** The transmit window the fragments are sent through, e.g. to tune its window size or retries */
+                XBBasicTransmitWindow<Driver>& transmitWindow() { return window; }
+
+                const XBFragmentStats& getStats() { return stats; }
+                void resetStats();
+
+                size_t reassemblyTimeout_mS = 5000;
+
+                XBBasicFragmenter(Driver& xbee, size_t windowSize = 4);
+                ~XBBasicFragmenter();
+
+            private:
+                struct Session
+                {
+                    bool active;            /**< A message is being reassembled */
+                    bool known;             /**< A message from the peer was closed, so lastClosed is meaningful */
+                    bool lastDelivered;     /**< The last closed message was complete */
+                    uint64_t peer;
+                    uint8_t messageID;
+                    uint8_t lastClosed;     /**< Catches late fragments of a message that was already closed */
+                    uint8_t chunk;
+                    uint16_t count;
+                    uint16_t received;
+                    uint16_t lastIndex;
+                    size_t length;          /**< Message length, known once the last fragment arrived */
+                    uint8_t* buffer;
+                    size_t capacity;
+                    size_t lastActivity_mS;
+                    uint8_t bitmap[(XB_FRAGMENT_MAX_FRAGMENTS + 7) / 8];
+                };
+
+                Driver& xbee;
+                XBBasicTransmitWindow<Driver> window;
+                size_t payloadLimit = XB_TX_MAX_PAYLOAD;
+                bool subscribed = false;
+
+                /* Outgoing message */
+                bool sending = false;
+                bool sendFailed = false;
+                XBStatus outStatus = XB_OK;
+                const uint8_t* outData = nullptr;
+                size_t outLength = 0;
+                uint64_t outAddress64 = 0;
+                uint16_t outAddress16 = XB_ADDRESS_16_UNKNOWN;
+                uint8_t outChunk = 0;
+                uint16_t outCount = 0;
+                uint16_t nextIndex = 0;
+                uint16_t confirmed = 0;
+                uint8_t outMessageID = 0;
+                uint32_t outTag = 0;
+
+                Session sessions[XB_FRAGMENT_MAX_PEERS];
+
+                XBFragmentBufferProvider provider = nullptr;
+                void* providerContext = nullptr;
+                XBMessageCallback messageCallback = nullptr;
+                void* messageContext = nullptr;
+                XBMessageSentCallback sentCallback = nullptr;
+                void* sentContext = nullptr;
+
+                XBFragmentStats stats;
+
+                /** Queues fragments while the transmit window has room */
+                void pump();
+
+                /** Reports the outgoing message once every fragment handed to the window has been accounted for */
+                void complete();
+
+                /** Frame handler registered with the driver. The context is the fragmenter. */
+                static void onReceive(const uint8_t* frame, size_t length, void* context);
+
+                /** Transmit window callback. The tag is the fragment index. */
+                static void onFragmentSent(uint32_t tag, XBStatus status, void* context);
+
+                /** Finds the peer's session, or claims one for it */
+                Session* sessionFor(uint64_t peer, size_t now_mS);
+
+                /** Gives the buffer back to the application and ends the reassembly */
+                void close(Session& session, XBStatus status);
+
+                void expire(size_t now_mS);
+            };
+
+            typedef XBBasicFragmenter<XBEEProS2> XBFragmenter;
+
+            template<typename Driver>
+            XBBasicFragmenter<Driver>::XBBasicFragmenter(Driver& xbee, size_t windowSize) : xbee(xbee), window(xbee, windowSize)
+            {
+                memset(sessions, 0, sizeof(sessions));
+
+                window.setCallback(&XBBasicFragmenter::onFragmentSent, this);
+            }
+
+            template<typename Driver>
+            XBBasicFragmenter<Driver>::~XBBasicFragmenter()
+            {
+                if (subscribed)
+                {
+                    xbee.removeFrameHandler(&XBBasicFragmenter::onReceive, this);
+                }
+            }
+
+            template<typename Driver>
+            XBStatus XBBasicFragmenter<Driver>::initialize()
+            {
+                if (sending)
+                {
+                    return XB_BUFFER_OVERRUN;
+                }
+
+                if (!subscribed)
+                {
+                    XBStatus result = xbee.addFrameHandler(XB_FRAME_RECEIVE_PACKET, &XBBasicFragmenter::onReceive, this);
+                    if (result != XB_OK)
+                    {
+                        return result;
+                    }
+
+                    subscribed = true;
+                }
+
+                uint32_t np = 0;
+                XBStatus result = xbee.readRegister(XB_MAX_PAYLOAD_BYTES, np);
+                if (result != XB_OK)
+                {
+                    return result;
+                }
+
+                if (np <= XB_FRAGMENT_HEADER_SIZE)
+                {
+                    return XB_BAD_RESPONSE;
+                }
+
+                /* The transmit window's entries can't hold more than XB_TX_MAX_PAYLOAD, whatever the network allows */
+                payloadLimit = (np < XB_TX_MAX_PAYLOAD) ? np : XB_TX_MAX_PAYLOAD;
+                return XB_OK;
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::setBufferProvider(XBFragmentBufferProvider provider, void* context)
+            {
+                this->provider = provider;
+                providerContext = context;
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::setMessageCallback(XBMessageCallback callback, void* context)
+            {
+                messageCallback = callback;
+                messageContext = context;
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::setSentCallback(XBMessageSentCallback callback, void* context)
+            {
+                sentCallback = callback;
+                sentContext = context;
+            }
+
+            template<typename Driver>
+            XBStatus XBBasicFragmenter<Driver>::sendMessage(uint64_t address64, uint16_t address16, const uint8_t* data,
+                size_t length, uint32_t tag)
+            {
+                if (sending)
+                {
+                    return XB_BUFFER_OVERRUN;
+                }
+
+                size_t chunk = chunkSize();
+                size_t count = (length + chunk - 1) / chunk;
+
+                if (!data || !length || (count > XB_FRAGMENT_MAX_FRAGMENTS))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                sending = true;
+                sendFailed = false;
+                outStatus = XB_OK;
+                outData = data;
+                outLength = length;
+                outAddress64 = address64;
+                outAddress16 = address16;
+                outChunk = (uint8_t)chunk;
+                outCount = (uint16_t)count;
+                nextIndex = 0;
+                confirmed = 0;
+                outMessageID++;
+                outTag = tag;
+
+                pump();
+                return XB_OK;
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::pump()
+            {
+                uint8_t payload[XB_TX_MAX_PAYLOAD];
+
+                while (sending && !sendFailed && (nextIndex < outCount) && (window.queued() < XB_TX_QUEUE_SIZE))
+                {
+                    uint16_t index = nextIndex;
+                    size_t offset = (size_t)index * outChunk;
+                    size_t length = ((outLength - offset) < outChunk) ? (outLength - offset) : outChunk;
+
+                    payload[0] = XB_FRAGMENT_MARKER;
+                    payload[1] = outMessageID;
+                    payload[2] = (uint8_t)(index >> 8);
+                    payload[3] = (uint8_t)index;
+                    payload[4] = (uint8_t)(outCount >> 8);
+                    payload[5] = (uint8_t)outCount;
+                    payload[6] = outChunk;
+                    memcpy(&payload[XB_FRAGMENT_HEADER_SIZE], &outData[offset], length);
+
+                    /* Counted before sending, since a fragment the window rejects outright is reported from inside send() */
+                    nextIndex++;
+                    stats.fragmentsSent++;
+
+                    XBStatus result = window.send(outAddress64, outAddress16, payload, XB_FRAGMENT_HEADER_SIZE + length,
+                        index);
+
+                    if (result != XB_OK)
+                    {
+                        nextIndex--;
+                        stats.fragmentsSent--;
+
+                        if (result != XB_BUFFER_OVERRUN)
+                        {
+                            sendFailed = true;
+                            outStatus = result;
+                            complete();
+                        }
+                        return;
+                    }
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::onFragmentSent(uint32_t tag, XBStatus status, void* context)
+            {
+                (void)tag;
+                XBBasicFragmenter* self = static_cast<XBBasicFragmenter*>(context);
+
+                if (!self->sending)
+                {
+                    return;
+                }
+
+                self->confirmed++;
+
+                /* Once a fragment is lost the message can't be reassembled, so stop queueing the rest */
+                if ((status != XB_OK) && !self->sendFailed)
+                {
+                    self->sendFailed = true;
+                    self->outStatus = status;
+                }
+
+                self->complete();
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::complete()
+            {
+                /* Wait for everything already handed to the window, so its callbacks can't leak into the next message */
+                if (confirmed < nextIndex)
+                {
+                    return;
+                }
+
+                if (!sendFailed && (confirmed < outCount))
+                {
+                    return;
+                }
+
+                sending = false;
+                outData = nullptr;
+
+                if (sendFailed)
+                {
+                    stats.messagesFailed++;
+                }
+                else
+                {
+                    stats.messagesSent++;
+                }
+
+                if (sentCallback)
+                {
+                    sentCallback(outTag, outStatus, sentContext);
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::service(size_t timeout_mS)
+            {
+                if (window.inFlight())
+                {
+                    window.service(timeout_mS);
+                }
+                else
+                {
+                    xbee.processIncoming(timeout_mS);
+                    window.service(0);
+                }
+
+                pump();
+                expire(platform::millis());
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::onReceive(const uint8_t* frame, size_t length, void* context)
+            {
+                static_cast<XBBasicFragmenter*>(context)->receive(frame, length);
+            }
+
+            template<typename Driver>
+            bool XBBasicFragmenter<Driver>::receive(const uint8_t* frame, size_t length)
+            {
+                /* [0x90][64-bit source][16-bit source][options][marker][message id][index:16][count:16][chunk][data...] */
+                if (!frame || (frame[0] != XB_FRAME_RECEIVE_PACKET) || (length <= XB_RECEIVE_HEADER_SIZE) ||
+                    (frame[XB_RECEIVE_HEADER_SIZE] != XB_FRAGMENT_MARKER))
+                {
+                    return false;
+                }
+
+                if (length <= (XB_RECEIVE_HEADER_SIZE + XB_FRAGMENT_HEADER_SIZE))
+                {
+                    stats.rejected++;
+                    return true;
+                }
+
+                uint64_t peer = 0;
+                for (size_t i = 0; i < 8; i++)
+                {
+                    peer = (peer << 8) | frame[1 + i];
+                }
+
+                const uint8_t* header = &frame[XB_RECEIVE_HEADER_SIZE];
+                uint8_t messageID = header[1];
+                uint16_t index = (uint16_t)((header[2] << 8) | header[3]);
+                uint16_t count = (uint16_t)((header[4] << 8) | header[5]);
+                uint8_t chunk = header[6];
+
+                const uint8_t* data = &header[XB_FRAGMENT_HEADER_SIZE];
+                size_t dataLength = length - XB_RECEIVE_HEADER_SIZE - XB_FRAGMENT_HEADER_SIZE;
+
+                /* Every fragment but the last is exactly one chunk */
+                bool last = (index == (count - 1));
+                if (!count || (count > XB_FRAGMENT_MAX_FRAGMENTS) || (index >= count) || !chunk ||
+                    (dataLength > chunk) || (!last && (dataLength != chunk)))
+                {
+                    stats.rejected++;
+                    return true;
+                }
+
+                size_t now = platform::millis();
+                Session* session = sessionFor(peer, now);
+                if (!session)
+                {
+                    stats.rejected++;
+                    return true;
+                }
+
+                /* Late fragments of a message that was already delivered, refused or given up on */
+                if (session->known && (session->lastClosed == messageID) &&
+                    (!session->active || (session->messageID != messageID)))
+                {
+                    if (session->lastDelivered)
+                    {
+                        stats.duplicates++;
+                    }
+                    else
+                    {
+                        stats.rejected++;
+                    }
+                    return true;
+                }
+
+                if (session->active && (session->messageID != messageID))
+                {
+                    /* The sender gave up on the old message and moved on */
+                    stats.abandoned++;
+                    close(*session, XB_BAD_RESULT);
+                }
+
+                if (!session->active)
+                {
+                    session->messageID = messageID;
+                    session->chunk = chunk;
+                    session->count = count;
+                    session->received = 0;
+                    session->lastIndex = 0;
+                    session->length = 0;
+                    session->capacity = 0;
+                    session->buffer = provider ?
+                        provider(peer, messageID, (size_t)count * chunk, session->capacity, providerContext) : nullptr;
+                    memset(session->bitmap, 0, sizeof(session->bitmap));
+
+                    if (!session->buffer)
+                    {
+                        /* Nothing to hand back, but the rest of the message still has to be ignored */
+                        session->known = true;
+                        session->lastClosed = messageID;
+                        session->lastDelivered = false;
+                        stats.rejected++;
+                        return true;
+                    }
+
+                    session->active = true;
+
+                    /* Smallest possible message: every fragment but the last full, the last one byte */
+                    if (session->capacity < ((size_t)(count - 1) * chunk + 1))
+                    {
+                        stats.abandoned++;
+                        close(*session, XB_BUFFER_TOO_SMALL);
+                        return true;
+                    }
+                }
+                else if ((session->count != count) || (session->chunk != chunk))
+                {
+                    stats.rejected++;
+                    return true;
+                }
+
+                session->lastActivity_mS = now;
+
+                uint8_t bit = (uint8_t)(1 << (index & 7));
+                if (session->bitmap[index >> 3] & bit)
+                {
+                    stats.duplicates++;
+                    return true;
+                }
+
+                size_t offset = (size_t)index * chunk;
+                if ((offset + dataLength) > session->capacity)
+                {
+                    stats.abandoned++;
+                    close(*session, XB_BUFFER_TOO_SMALL);
+                    return true;
+                }
+
+                if (session->received && (index != (uint16_t)(session->lastIndex + 1)))
+                {
+                    stats.outOfOrder++;
+                }
+
+                memcpy(&session->buffer[offset], data, dataLength);
+                session->bitmap[index >> 3] |= bit;
+                session->lastIndex = index;
+                session->received++;
+                stats.fragmentsReceived++;
+
+                if (last)
+                {
+                    session->length = offset + dataLength;
+                }
+
+                if (session->received == session->count)
+                {
+                    stats.messagesReceived++;
+                    close(*session, XB_OK);
+                }
+
+                return true;
+            }
+
+            template<typename Driver>
+            typename XBBasicFragmenter<Driver>::Session* XBBasicFragmenter<Driver>::sessionFor(uint64_t peer, size_t now_mS)
+            {
+                Session* unused = nullptr;
+                Session* idle = nullptr;
+
+                for (Session& session : sessions)
+                {
+                    if ((session.active || session.known) && (session.peer == peer))
+                    {
+                        return &session;
+                    }
+
+                    if (session.active)
+                    {
+                        continue;
+                    }
+
+                    if (!session.known)
+                    {
+                        unused = unused ? unused : &session;
+                    }
+                    else if (!idle || ((now_mS - session.lastActivity_mS) > (now_mS - idle->lastActivity_mS)))
+                    {
+                        idle = &session;
+                    }
+                }
+
+                /* A finished session only remembers its last message ID, so the longest idle one is given up first */
+                Session* session = unused ? unused : idle;
+                if (session)
+                {
+                    session->peer = peer;
+                    session->known = false;
+                }
+
+                return session;
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::close(Session& session, XBStatus status)
+            {
+                uint8_t* buffer = session.buffer;
+                size_t length = (status == XB_OK) ? session.length : 0;
+
+                /* Ended before the callback, so it can reuse the buffer or start another message straight away */
+                session.active = false;
+                session.buffer = nullptr;
+                session.known = true;
+                session.lastClosed = session.messageID;
+                session.lastDelivered = (status == XB_OK);
+
+                if (messageCallback)
+                {
+                    messageCallback(session.peer, session.messageID, status, buffer, length, messageContext);
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::expire(size_t now_mS)
+            {
+                for (Session& session : sessions)
+                {
+                    if (session.active && ((now_mS - session.lastActivity_mS) >= reassemblyTimeout_mS))
+                    {
+                        stats.abandoned++;
+                        close(session, XB_TIMEOUT);
+                    }
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicFragmenter<Driver>::resetStats()
+            {
+                stats = XBFragmentStats();
+            }
+
+            extern template class XBBasicFragmenter<XBEEProS2>;
+        }
+    }
+}
+
+#endif /* !XBEE_FRAGMENTER_HPP */
@@ -0,0 +1,78 @@
+/**
+ * @file xb_static_device.hpp
+ */
+
+#ifndef XBEE_STATIC_DEVICE_HPP
+#define XBEE_STATIC_DEVICE_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_serial.hpp>
+#include <libxbee/include/modules/xbee_pro_s2/xbpros2.hpp>
+
+namespace libxbee
+{
+    namespace modules
+    {
+        namespace XBEEProS2
+        {
+            /** Statically Allocated Device
+             *  Holds a transport and the driver that runs over it in one object, so the whole device, every buffer
+             *  included, can be placed in static memory and nothing is ever allocated from the heap. The AT buffer
+             *  sizes are picked per device, other table sizes are fixed through their XB_*_SIZE definitions, and the
+             *  driver rejects payloads that can't fit a frame at compile time where their size is known.
+             *
+             *  The driver is instantiated on the concrete transport, so the read, write, writev and waitForData calls
+             *  it makes on the frame path are bound statically rather than going through the XBEESerial vtable.
+             *
+             *  @code
+             *  static XBStaticDevice<XbeePosixSerial> radio(115200);
+             *  radio.transport().open("/dev/ttyUSB0", 115200);
+             *  radio->discover(115200);
+             *  @endcode
+             *
+             *  @tparam Transport   XBEESerial implementation to embed
+             *  @tparam TxCapacity  Size of the driver's AT command buffer
+             *  @tparam RxCapacity  Size of the driver's AT response buffer
+             **/
+            template<typename Transport, size_t TxCapacity = XB_TX_BUFFER_SIZE, size_t RxCapacity = XB_RX_BUFFER_SIZE>
+            class XBStaticDevice
+            {
+                static_assert(std::is_base_of<XBEESerial, Transport>::value, "Transport must implement XBEESerial");
+
+            public:
+                /** Builds the transport from args and the driver on top of it
+                 *  @param[in]  baud        Rate the transport will be opened at, if known */
+                template<typename... Args>
+                explicit XBStaticDevice(uint32_t baud, Args&&... args) :
+                    port(std::forward<Args>(args)...), xbee(&port, baud)
+                {
+                }
+
+                ~XBStaticDevice() = default;
+
+                XBStaticDevice(const XBStaticDevice&) = delete;
+                XBStaticDevice& operator=(const XBStaticDevice&) = delete;
+
+                typedef XBEEProS2Driver<Transport, TxCapacity, RxCapacity> Driver;
+
+                Transport& transport() { return port; }
+                Driver& driver() { return xbee; }
+
+                Driver* operator->() { return &xbee; }
+
+            private:
+                /* Declared first, since the driver is handed a pointer to it while being built */
+                Transport port;
+                Driver xbee;
+            };
+        }
+    }
+}
+
+#endif /* !XBEE_STATIC_DEVICE_HPP */
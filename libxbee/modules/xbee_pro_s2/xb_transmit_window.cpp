@@ -0,0 +1,13 @@
+/* LibXBEE Includes */
+#include <libxbee/include/modules/xbee_pro_s2/xb_transmit_window.hpp>
+
+namespace libxbee
+{
+    namespace modules
+    {
+        namespace XBEEProS2
+        {
+            template class XBBasicTransmitWindow<XBEEProS2>;
+        }
+    }
+}
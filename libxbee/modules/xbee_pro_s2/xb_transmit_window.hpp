@@ -0,0 +1,485 @@
+/**
+ * @file xb_transmit_window.hpp
+ */
+
+#ifndef XBEE_TRANSMIT_WINDOW_HPP
+#define XBEE_TRANSMIT_WINDOW_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/modules/xbee_pro_s2/xbpros2.hpp>
+
+/** Transmissions that can be queued or in flight at once */
+#ifndef XB_TX_QUEUE_SIZE
+#define XB_TX_QUEUE_SIZE 16
+#endif
+
+namespace libxbee
+{
+    namespace modules
+    {
+        namespace XBEEProS2
+        {
+            /** Throughput and retry statistics of a transmit window */
+            struct XBTransmitStats
+            {
+                size_t queued = 0;              /**< Payloads accepted by send() */
+                size_t sent = 0;                /**< Transmit Requests put on the wire, including retries */
+                size_t delivered = 0;           /**< Payloads the module reported as delivered */
+                size_t failed = 0;              /**< Payloads given up on */
+                size_t retries = 0;             /**< Transmit Requests that were repeats of a failed one */
+                size_t timeouts = 0;            /**< Transmit Status frames that never arrived */
+                size_t bytesDelivered = 0;      /**< Payload bytes the module reported as delivered */
+                size_t inFlightHighWater = 0;   /**< Most Transmit Requests outstanding at once */
+                size_t elapsed_mS = 0;          /**< Time from the first send to the last delivery */
+                size_t packetsPerSecond = 0;    /**< delivered / elapsed_mS */
+                size_t bytesPerSecond = 0;      /**< bytesDelivered / elapsed_mS */
+            };
+
+            /** Reports the final outcome of a payload handed to XBTransmitWindow::send() */
+            typedef void (*XBTransmitCallback)(uint32_t tag, XBStatus status, void* context);
+
+            /** Sliding Window Transmitter
+             *  Keeps up to window Transmit Requests (0x10) outstanding instead of waiting for each Transmit Status
+             *  (0x8B) before sending the next one, so throughput isn't capped at one packet per RF round trip. Status
+             *  frames are matched back by frame ID through the driver's receive dispatcher.
+             *
+             *  A payload whose delivery failed for a transient reason (no MAC/network ACK, or the status never arrived)
+             *  is retried after a backoff, up to maxRetries times. While a destination has a retry pending, payloads
+             *  for it that haven't been sent yet are held back, so a struggling route isn't flooded, while other
+             *  destinations keep flowing. Payloads already in flight when the failure was reported may still be
+             *  delivered ahead of the retry.
+             *
+             *  Payloads are copied into a fixed queue, so the caller's buffer can be reused as soon as send() returns.
+             *  The driver must already be in API mode.
+             *
+             *  @tparam Driver      Driver the payloads are sent through
+             **/
+            template<typename Driver = XBEEProS2>
+            class XBBasicTransmitWindow
+            {
+            public:
+                /** Queues a payload
+                 *
+                 *  @param[in]  address64   Destination, XB_ADDRESS_64_COORDINATOR or XB_ADDRESS_64_BROADCAST
+                 *  @param[in]  address16   Destination network address, XB_ADDRESS_16_UNKNOWN if not known
+                 *  @param[in]  data        RF payload
+                 *  @param[in]  length      Number of payload bytes, up to XB_TX_MAX_PAYLOAD
+                 *  @param[in]  tag         Passed to the delivery callback to identify the payload
+                 *  @return     XBStatus    XB_OK if queued, XB_BUFFER_OVERRUN if the queue is full, XB_INVALID_PARAM if
+                 *                          the payload is empty or too large
+                 **/
+                XBStatus send(uint64_t address64, uint16_t address16, const uint8_t* data, size_t length, uint32_t tag = 0);
+
+                /** Runs the driver's receive dispatcher, retires completed transmissions and refills the window
+                 *  @param[in]  timeout_mS  How long to wait for incoming frames */
+                void service(size_t timeout_mS = 0);
+
+                /** Services the window until every queued payload has been delivered or given up on
+                 *  @return XB_OK if the queue drained, XB_TIMEOUT if timeout_mS ran out first */
+                XBStatus flush(size_t timeout_mS);
+
+                /** Sets how many Transmit Requests may be outstanding, clamped to the queue and frame ID table sizes */
+                void setWindow(size_t size);
+                size_t getWindow() { return window; }
+
+                /** Called once per payload with its final status */
+                void setCallback(XBTransmitCallback callback, void* context = nullptr);
+
+                /** Payloads queued or in flight */
+                size_t queued() { return used; }
+
+                /** Transmit Requests currently outstanding */
+                size_t inFlight() { return outstanding; }
+
+                XBTransmitStats getStats();
+                void resetStats();
+
+                size_t maxRetries = 3;          /**< Repeats of a failed payload before giving up */
+                size_t retryBackoff_mS = 50;    /**< Wait before a retry, multiplied by the attempt number */
+                size_t statusTimeout_mS = Driver::XB_ASYNC_TIMEOUT_mS;  /**< How long to wait for a Transmit Status */
+
+                XBBasicTransmitWindow(Driver& xbee, size_t window = 4);
+
+                /** Cancels the Transmit Requests still in flight, so their status can't reach a destroyed entry. The
+                 *  payloads aren't reported to the callback. */
+                ~XBBasicTransmitWindow();
+
+                XBBasicTransmitWindow(const XBBasicTransmitWindow&) = delete;
+                XBBasicTransmitWindow& operator=(const XBBasicTransmitWindow&) = delete;
+
+            private:
+                enum EntryState : uint8_t
+                {
+                    ENTRY_FREE,
+                    ENTRY_QUEUED,           /**< Waiting for a window slot, or for its retry backoff to pass */
+                    ENTRY_IN_FLIGHT,        /**< Sent, waiting for the Transmit Status */
+                    ENTRY_DONE,             /**< Status arrived, waiting to be retired by service() */
+                };
+
+                struct Entry
+                {
+                    EntryState state;
+                    uint32_t sequence;      /**< Queue order, used to keep payloads to one destination in order */
+                    uint32_t tag;
+                    uint64_t address64;
+                    uint16_t address16;
+                    uint8_t data[XB_TX_MAX_PAYLOAD];
+                    uint8_t length;
+                    uint8_t attempts;
+                    size_t retryAt_mS;
+                    XBStatus status;
+                    XBRequestHandle handle;
+                    XBBasicTransmitWindow* owner;
+                };
+
+                Driver& xbee;
+                Entry entries[XB_TX_QUEUE_SIZE];
+                size_t window;
+                size_t used = 0;
+                size_t outstanding = 0;
+                uint32_t nextSequence = 0;
+
+                XBTransmitCallback callback = nullptr;
+                void* callbackContext = nullptr;
+
+                XBTransmitStats stats;
+                bool started = false;
+                size_t firstSend_mS = 0;
+                size_t lastDelivery_mS = 0;
+
+                /** Completion callback handed to the driver. The context is the entry. */
+                static void onStatus(const XBCompletion& completion, void* context);
+
+                /** Delivers, retries or fails entries whose status has arrived */
+                void retire(size_t now_mS);
+
+                /** Sends queued entries while the window has room */
+                void fill(size_t now_mS);
+
+                /** True if an earlier payload to the same destination is still waiting on a retry */
+                bool blockedByRetry(const Entry& entry);
+
+                void finish(Entry& entry, XBStatus status, size_t now_mS);
+            };
+
+            typedef XBBasicTransmitWindow<XBEEProS2> XBTransmitWindow;
+
+            template<typename Driver>
+            XBBasicTransmitWindow<Driver>::XBBasicTransmitWindow(Driver& xbee, size_t window) : xbee(xbee)
+            {
+                for (Entry& entry : entries)
+                {
+                    entry = Entry();
+                }
+                setWindow(window);
+            }
+
+            template<typename Driver>
+            XBBasicTransmitWindow<Driver>::~XBBasicTransmitWindow()
+            {
+                for (Entry& entry : entries)
+                {
+                    if (entry.state == ENTRY_IN_FLIGHT)
+                    {
+                        xbee.requestTable().cancel(entry.handle);
+                    }
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicTransmitWindow<Driver>::setWindow(size_t size)
+            {
+                size = (size < XB_TX_QUEUE_SIZE) ? size : XB_TX_QUEUE_SIZE;
+                size = (size < XB_MAX_PENDING_REQUESTS) ? size : XB_MAX_PENDING_REQUESTS;
+                window = size ? size : 1;
+            }
+
+            template<typename Driver>
+            void XBBasicTransmitWindow<Driver>::setCallback(XBTransmitCallback callback, void* context)
+            {
+                this->callback = callback;
+                callbackContext = context;
+            }
+
+            template<typename Driver>
+            XBStatus XBBasicTransmitWindow<Driver>::send(uint64_t address64, uint16_t address16, const uint8_t* data, size_t length,
+                uint32_t tag)
+            {
+                if (!data || !length || (length > XB_TX_MAX_PAYLOAD))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                for (size_t i = 0; i < XB_TX_QUEUE_SIZE; i++)
+                {
+                    Entry& entry = entries[i];
+                    if (entry.state != ENTRY_FREE)
+                    {
+                        continue;
+                    }
+
+                    entry.state = ENTRY_QUEUED;
+                    entry.sequence = nextSequence++;
+                    entry.tag = tag;
+                    entry.address64 = address64;
+                    entry.address16 = address16;
+                    memcpy(entry.data, data, length);
+                    entry.length = (uint8_t)length;
+                    entry.attempts = 0;
+                    entry.retryAt_mS = 0;
+                    entry.owner = this;
+
+                    used++;
+                    stats.queued++;
+
+                    /* Get it on the wire straight away if the window has room */
+                    fill(platform::millis());
+                    return XB_OK;
+                }
+
+                return XB_BUFFER_OVERRUN;
+            }
+
+            template<typename Driver>
+            void XBBasicTransmitWindow<Driver>::service(size_t timeout_mS)
+            {
+                /* Only block when there's actually something to wait for */
+                xbee.processIncoming(outstanding ? timeout_mS : 0);
+
+                size_t now = platform::millis();
+                retire(now);
+                fill(now);
+            }
+
+            template<typename Driver>
+            XBStatus XBBasicTransmitWindow<Driver>::flush(size_t timeout_mS)
+            {
+                size_t startTime = platform::millis();
+
+                while (used)
+                {
+                    size_t elapsed = platform::millis() - startTime;
+                    if (elapsed >= timeout_mS)
+                    {
+                        return XB_TIMEOUT;
+                    }
+
+                    /* With nothing outstanding the only thing left is a retry backoff, so don't spin through it */
+                    if (!outstanding)
+                    {
+                        platform::delayMilliseconds(1);
+                    }
+
+                    service(timeout_mS - elapsed);
+                }
+
+                return XB_OK;
+            }
+
+            template<typename Driver>
+            void XBBasicTransmitWindow<Driver>::onStatus(const XBCompletion& completion, void* context)
+            {
+                Entry* entry = static_cast<Entry*>(context);
+
+                if ((entry->state != ENTRY_IN_FLIGHT) || (entry->handle.frameID != completion.frameID))
+                {
+                    return;
+                }
+
+                entry->status = completion.status;
+                entry->state = ENTRY_DONE;
+                entry->owner->outstanding--;
+
+                /* Remember the network address the module resolved so retries skip address discovery */
+                if ((completion.status == XB_OK) && (entry->address16 == XB_ADDRESS_16_UNKNOWN) &&
+                    (completion.address16 != XB_ADDRESS_16_UNKNOWN))
+                {
+                    entry->address16 = completion.address16;
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicTransmitWindow<Driver>::retire(size_t now_mS)
+            {
+                for (size_t i = 0; i < XB_TX_QUEUE_SIZE; i++)
+                {
+                    Entry& entry = entries[i];
+                    if (entry.state != ENTRY_DONE)
+                    {
+                        continue;
+                    }
+
+                    if (entry.status == XB_TIMEOUT)
+                    {
+                        stats.timeouts++;
+                    }
+
+                    /* Only failures the next attempt could fix are retried. A bad address or oversized payload isn't. */
+                    bool transient = (entry.status == XB_NO_RESPONSE) || (entry.status == XB_TIMEOUT);
+
+                    if ((entry.status != XB_OK) && transient && (entry.attempts <= maxRetries))
+                    {
+                        entry.state = ENTRY_QUEUED;
+                        entry.retryAt_mS = now_mS + (retryBackoff_mS * entry.attempts);
+                        continue;
+                    }
+
+                    finish(entry, entry.status, now_mS);
+                }
+            }
+
+            template<typename Driver>
+            bool XBBasicTransmitWindow<Driver>::blockedByRetry(const Entry& entry)
+            {
+                for (size_t i = 0; i < XB_TX_QUEUE_SIZE; i++)
+                {
+                    const Entry& other = entries[i];
+
+                    /* A queued entry that has been sent before is backing off, an in flight one is a repeat */
+                    bool retrying = ((other.state == ENTRY_QUEUED) && (other.attempts > 0)) ||
+                        ((other.state == ENTRY_IN_FLIGHT) && (other.attempts > 1));
+
+                    if ((&other != &entry) && retrying && (other.address64 == entry.address64) &&
+                        ((int32_t)(other.sequence - entry.sequence) < 0))
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            template<typename Driver>
+            void XBBasicTransmitWindow<Driver>::fill(size_t now_mS)
+            {
+                while (outstanding < window)
+                {
+                    /* Oldest eligible entry first, so each destination sees its payloads in order */
+                    Entry* next = nullptr;
+
+                    for (size_t i = 0; i < XB_TX_QUEUE_SIZE; i++)
+                    {
+                        Entry& entry = entries[i];
+
+                        if ((entry.state != ENTRY_QUEUED) || ((long)(now_mS - entry.retryAt_mS) < 0))
+                        {
+                            continue;
+                        }
+
+                        if (next && ((int32_t)(entry.sequence - next->sequence) > 0))
+                        {
+                            continue;
+                        }
+
+                        if (!blockedByRetry(entry))
+                        {
+                            next = &entry;
+                        }
+                    }
+
+                    if (!next)
+                    {
+                        return;
+                    }
+
+                    XBStatus result = xbee.transmitAsync(next->address64, next->address16, next->data, next->length,
+                        next->handle, &XBBasicTransmitWindow::onStatus, next, statusTimeout_mS);
+
+                    if (result == XB_BUFFER_OVERRUN)
+                    {
+                        /* Every frame ID is taken by someone else's requests. Try again on the next service(). */
+                        return;
+                    }
+
+                    if (result != XB_OK)
+                    {
+                        finish(*next, result, now_mS);
+                        continue;
+                    }
+
+                    if (!started)
+                    {
+                        started = true;
+                        firstSend_mS = now_mS;
+                    }
+
+                    if (next->attempts)
+                    {
+                        stats.retries++;
+                    }
+
+                    next->attempts++;
+                    next->state = ENTRY_IN_FLIGHT;
+                    stats.sent++;
+                    outstanding++;
+
+                    if (outstanding > stats.inFlightHighWater)
+                    {
+                        stats.inFlightHighWater = outstanding;
+                    }
+                }
+            }
+
+            template<typename Driver>
+            void XBBasicTransmitWindow<Driver>::finish(Entry& entry, XBStatus status, size_t now_mS)
+            {
+                if (status == XB_OK)
+                {
+                    stats.delivered++;
+                    stats.bytesDelivered += entry.length;
+                    lastDelivery_mS = now_mS;
+                }
+                else
+                {
+                    stats.failed++;
+                }
+
+                uint32_t tag = entry.tag;
+                entry.state = ENTRY_FREE;
+                entry.attempts = 0;
+                used--;
+
+                if (callback)
+                {
+                    callback(tag, status, callbackContext);
+                }
+            }
+
+            template<typename Driver>
+            XBTransmitStats XBBasicTransmitWindow<Driver>::getStats()
+            {
+                XBTransmitStats snapshot = stats;
+
+                if (started && stats.delivered)
+                {
+                    snapshot.elapsed_mS = lastDelivery_mS - firstSend_mS;
+
+                    /* Clamp to 1 mS so a burst that completed within one tick still reports a rate */
+                    size_t elapsed = snapshot.elapsed_mS ? snapshot.elapsed_mS : 1;
+                    snapshot.packetsPerSecond = (stats.delivered * 1000) / elapsed;
+                    snapshot.bytesPerSecond = (stats.bytesDelivered * 1000) / elapsed;
+                }
+
+                return snapshot;
+            }
+
+            template<typename Driver>
+            void XBBasicTransmitWindow<Driver>::resetStats()
+            {
+                stats = XBTransmitStats();
+                started = false;
+                firstSend_mS = 0;
+                lastDelivery_mS = 0;
+            }
+
+            extern template class XBBasicTransmitWindow<XBEEProS2>;
+        }
+    }
+}
+
+#endif /* !XBEE_TRANSMIT_WINDOW_HPP */
@@ -1,14 +1,33 @@
 #ifndef XBEE_PRO_SERIES_2_HPP
 #define XBEE_PRO_SERIES_2_HPP
 
+/* C/C++ Includes */
+#include <new>
+#include <type_traits>
+
+#if !defined(XBEE_PLATFORM_POSIX)
 /* Chimera Includes */
 #include <Chimera/gpio.hpp>
 #include <Chimera/serial.hpp>
 #include <Chimera/threading.hpp>
+#endif
 
 /* Libxbee Includes */
+#include <libxbee/include/xb_platform.hpp>
 #include <libxbee/include/xb_serial.hpp>
+#if !defined(XBEE_PLATFORM_POSIX)
+#include <libxbee/include/xb_chimera_serial.hpp>
+#endif
 #include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_api_frame.hpp>
+#include <libxbee/include/xb_command.hpp>
+#include <libxbee/include/xb_at_batch.hpp>
+#include <libxbee/include/xb_register_cache.hpp>
+#include <libxbee/include/xb_request_table.hpp>
+#include <libxbee/include/xb_node_table.hpp>
+#include <libxbee/include/xb_route_cache.hpp>
+#include <libxbee/include/xb_statistics.hpp>
+#include <libxbee/include/xb_frame_pool.hpp>
 
 namespace libxbee
 {
@@ -16,31 +35,166 @@ namespace libxbee
     {
 		namespace XBEEProS2
 		{
-			class XBEEProS2
+            enum XBRxMode : uint8_t
+            {
+                XB_RX_POLLING,      /**< Check the serial driver for new packets every few milliseconds */
+                XB_RX_BLOCKING,     /**< Sleep on the RX complete semaphore until data arrives (requires FreeRTOS) */
+            };
+
+            /** Response latency as seen by readWithTimeout, from the start of the wait to data availability */
+            struct XBLatency
+            {
+                size_t last_mS = 0;         /**< Latency of the most recent read, including failed ones */
+                size_t min_mS = 0;          /**< Fastest successful read */
+                size_t max_mS = 0;          /**< Slowest successful read */
+                size_t total_mS = 0;        /**< Sum of all successful reads, used with samples for the average */
+                size_t samples = 0;         /**< Number of successful reads */
+                size_t timeouts = 0;        /**< Number of reads that expired without data */
+            };
+
+            /** Outcome of the last discover() call */
+            struct XBDiscoveryStats
+            {
+                uint32_t baud = 0;          /**< Rate the module was found at, 0 if it wasn't */
+                size_t elapsed_mS = 0;      /**< Time-to-discover, including every failed probe */
+                size_t probes = 0;          /**< Number of rates tried */
+                bool lastKnownHit = false;  /**< Found at the last-known baud rate */
+            };
+
+            /** Outcome of the last hardwareReset() call */
+            struct XBBootStats
+            {
+                size_t elapsed_mS = 0;      /**< Time from releasing reset until the module answered, or gave up */
+                bool modemStatus = false;   /**< Came up announcing itself with a Modem Status frame */
+                uint8_t status = 0;         /**< Status byte of that frame, e.g. 0x00 for a hardware reset */
+                size_t probes = 0;          /**< "+++" sequences sent when waiting for command mode instead */
+            };
+
+            /** Drives the module's reset line: asserted pulls it low, which holds the module in reset */
+            typedef void (*XBResetCallback)(bool asserted, void* context);
+
+            /** Result of the round trip burst used to verify a baud rate change */
+            struct XBLinkCheck
+            {
+                uint32_t baud = 0;          /**< Rate that was verified */
+                size_t rounds = 0;          /**< Round trips attempted */
+                size_t errors = 0;          /**< Round trips that failed or came back wrong */
+            };
+
+            #define XB_DISCOVERY_RATE_COUNT 8   /**< Standard rates tried by discover() */
+
+            /** Default size of the AT mode command buffer, see XBEEProS2Driver's TxCapacity */
+            #ifndef XB_TX_BUFFER_SIZE
+            #define XB_TX_BUFFER_SIZE 24
+            #endif
+
+            /** Default size of the AT mode response buffer, see XBEEProS2Driver's RxCapacity. API frames are also pulled
+             *  from the transport in chunks of this size, so a larger buffer means fewer calls into the serial backend
+             *  per frame. */
+            #ifndef XB_RX_BUFFER_SIZE
+            #if defined(XBEE_PLATFORM_POSIX)
+            #define XB_RX_BUFFER_SIZE 128
+            #else
+            #define XB_RX_BUFFER_SIZE 24
+            #endif
+            #endif
+
+            /** How long the Chimera constructor waits for the module to settle after a possible reset. Set to 0 when
+             *  bringing the module up with hardwareReset(), which only waits as long as the module actually takes. */
+            #ifndef XB_STARTUP_DELAY_mS
+            #define XB_STARTUP_DELAY_mS 500
+            #endif
+
+            /** Frame type subscriptions the receive dispatcher can hold */
+            #ifndef XB_MAX_FRAME_HANDLERS
+            #define XB_MAX_FRAME_HANDLERS 4
+            #endif
+
+            template<typename Driver>
+            class XBBasicCommandSession;
+
+            /** XBEE Pro S2 Driver
+             *  Templated on the transport and on the sizes of its AT mode buffers. The read/write/wait calls on the frame
+             *  path go through XBSerialIO, so they are bound statically for a concrete transport such as XbeePosixSerial
+             *  and only stay virtual when the transport is the XBEESerial interface itself, as it is for XBEEProS2.
+             *
+             *  @tparam Transport   Serial backend the driver talks through
+             *  @tparam TxCapacity  Size of the AT command buffer
+             *  @tparam RxCapacity  Size of the AT response buffer, which is also the chunk size API frames are read in
+             **/
+			template<typename Transport = XBEESerial, size_t TxCapacity = XB_TX_BUFFER_SIZE, size_t RxCapacity = XB_RX_BUFFER_SIZE>
+			class XBEEProS2Driver
 			{
 			public:
-                static const size_t XBEE_TX_BUFFER_SIZE = 24;
-                static const size_t XBEE_RX_BUFFER_SIZE = 24;
+                static const size_t XBEE_TX_BUFFER_SIZE = TxCapacity;
+                static const size_t XBEE_RX_BUFFER_SIZE = RxCapacity;
+
+                static_assert(XBEE_TX_BUFFER_SIZE >= (XB_ATxx_COMMAND_LENGTH + XB_MAX_HEX_DIGITS + 1),
+                    "TxCapacity can't hold an AT command with a 32-bit parameter");
+                static_assert(XBEE_RX_BUFFER_SIZE >= (XB_MAX_HEX_DIGITS + 2),
+                    "RxCapacity can't hold a 32-bit register value");
+
                 static const size_t XB_ENTER_AT_TIMEOUT_mS = 2000;
                 static const size_t XB_PING_TIMEOUT_mS = 2000;
                 static const size_t XB_DEFAULT_TIMEOUT_mS = 100;
+                static const size_t XB_AT_MODE_MARGIN_mS = XB_DEFAULT_TIMEOUT_mS;
+                static const size_t XB_PROBE_MARGIN_mS = 100;          /**< Allowance on top of the guard time for a "+++" probe */
+                static const size_t XB_API_PROBE_TIMEOUT_mS = 50;      /**< How long an API probe waits for its response */
+                static const size_t XB_ASYNC_TIMEOUT_mS = 2000;        /**< Default lifetime of an asynchronous request */
+                static const size_t XB_RESET_PULSE_mS = 1;             /**< How long reset is held low */
+                static const size_t XB_BOOT_TIMEOUT_mS = 2000;         /**< Default bound on waiting for the module to boot */
 
 				/** Discovery of the Xbee
 				 *	Attempts to connect to the Xbee and reconfigure it to desired baud rate. This is under the assumption
-				 *	that the device's serial port is configured as 8N1. If connection cannot be established at the given baud
-				 *	rate, the software will search through all available standard baud rates for the device, error-ing out if 
-				 *	it cannot be found.
+				 *	that the device's serial port is configured as 8N1. The given baud rate is tried first, then the
+				 *	last-known rate, then the remaining standard rates in order of likelihood, error-ing out if the device
+				 *	cannot be found. Each probe only waits about one guard time, and in API mode a quick AT Command frame
+				 *	is tried at every rate before falling back to "+++". On success the serial port is left at the
+				 *	discovered rate and getLastKnownBaud() reports it.
 				 *
 				 *	@param[in]	baud	        Desired baud rate to use for communication
 				 *	@return     XBStatus        XB_OK if device was found, XB_NOT_FOUND if not
 				 **/
 				XBStatus discover(uint32_t baud);
 
+				/** Seeds discovery with the rate the module was last found at, e.g. restored from non-volatile storage */
+				void setLastKnownBaud(uint32_t baud) { lastKnownBaud = baud; }
+
+				/** Rate of the last successful discovery, to be persisted across reboots */
+				uint32_t getLastKnownBaud() { return lastKnownBaud; }
+
+				/** Time-to-discover and probe count of the last discover() call */
+				const XBDiscoveryStats& getDiscoveryStats() { return discoveryStats; }
+
+				/** Hardware Reset
+				 *	Pulses the reset line and returns as soon as the module is back, instead of sleeping for the worst
+				 *	case boot time. In API mode that is the first valid frame, normally the Modem Status (0x8A) reporting
+				 *	the hardware reset, which is dispatched like any other frame. In transparent mode the module announces
+				 *	nothing, so "+++" is sent, one guard time after reset is released, until it answers OK. Either way the
+				 *	wait is bounded by timeout_mS.
+				 *
+				 *	The module comes back with its saved configuration, so the register cache is invalidated and the API
+				 *	mode has to match what was written with ATWR. Requests in flight are lost and time out.
+				 *
+				 *	@param[in]	timeout_mS	    Longest time to wait for the module after releasing reset
+				 *	@return     XBStatus        XB_OK once the module answered, XB_NOT_SUPPORTED without a reset line,
+				 *	                            XB_NO_RESPONSE if it didn't answer in time
+				 **/
+				XBStatus hardwareReset(size_t timeout_mS = XB_BOOT_TIMEOUT_mS);
+
+				/** Supplies the reset line for drivers built without a reset pin, e.g. a GPIO of a host gateway. A
+				 *	callback set here takes over from the Chimera constructor's pin. */
+				void setResetLine(XBResetCallback line, void* context = nullptr);
+
+				/** Boot time and how the module announced itself in the last hardwareReset() call */
+				const XBBootStats& getBootStats() { return bootStats; }
+
 				/** Initializes an Xbee to some basic settings
 				 *	Attempts to reprogram Xbee settings according to a configuration struct. All settings are verified by
-				 *	reading back of the data after writing.
+				 *	reading back of the data after writing, then applied.
 				 *
-				 *	@param[in] config	        Configuration struct for how the Xbee should be set up
+				 *	@param[in] config	        Configuration struct for how the Xbee should be set up. A zero
+				 *	                            commandModeTimeout selects 6 seconds, a zero guardTime leaves GT alone.
 				 *	@return                     XB_OK if everything is alright, error code if not
 				 **/
 				XBStatus initialize(const Config& config);
@@ -49,21 +203,109 @@ namespace libxbee
                  *  This does not write parameters to non-volatile memory, so registers will be reset on power cycling to whatever values
                  *  are stored in on-board memory.
                  *
+                 *  @param[in]  onlyIfDirty     Skip ATAC when the register cache saw no unapplied write. Only safe if every
+                 *                              write since the last reset went through this driver's synchronous calls.
                  *  @return     XBStatus        XB_OK if everything is alright, error code if not
                  **/
-                XBStatus applyChanges();
+                XBStatus applyChanges(bool onlyIfDirty = false);
 
                 /** Writes whatever values are currently set in the device registers to non-volatile memory so that parameters persist
                  *  through subsequent resets. Use this sparingly as the memory can get worn out with too many write cycles.
                  *  
+                 *  @param[in]  onlyIfDirty     Skip ATWR when the register cache saw no write since the last one, to spare
+                 *                              flash cycles. Only safe under the same conditions as for applyChanges().
                  *  @return     XBStatus        XB_OK if everything is alright, error code if not
                  **/
-                XBStatus updateNonVolatileMemory();
+                XBStatus updateNonVolatileMemory(bool onlyIfDirty = false);
+
+                /** Reads a register, serving it from the shadow register cache when the value is already known
+                 *
+                 *  @param[in]  command     The register to read
+                 *  @param[out] value       The register value
+                 *  @param[in]  useCache    Set false to force a read from the module
+                 *  @return     XBStatus    XB_OK if everything is alright, error code if not
+                 **/
+                XBStatus readRegister(const char* command, uint32_t& value, bool useCache = true);
+
+                /** Stages a register write in the shadow register cache. Nothing is sent until commitRegisters() is called,
+                 *  and writing a value the module already holds is a no-op.
+                 *
+                 *  @param[in]  command     The register to write
+                 *  @param[in]  value       The desired value
+                 *  @return     XBStatus    XB_OK if staged, XB_INVALID_PARAM if the register isn't cached or is read-only
+                 **/
+                XBStatus writeRegister(const char* command, uint32_t value);
+
+                /** Stages a constant register write, rejecting out of range values at compile time
+                 *
+                 *  @tparam     Command     Command descriptor from libxbee::commands
+                 *  @tparam     Value       The desired value
+                 *  @return     XBStatus    XB_OK if staged, XB_INVALID_PARAM if the register isn't cached
+                 **/
+                template<typename Command, uint32_t Value>
+                XBStatus writeRegister()
+                {
+                    const char code[] = { Command::code0, Command::code1, 0 };
+                    return writeRegister(code, XBCheckedParam<Command, Value>::value);
+                }
+
+                /** Flushes every staged register write in one batch followed by a single ATAC. If persist is set, ATWR is
+                 *  appended only when non-volatile memory would actually change.
+                 *
+                 *  @param[in]  persist     Whether to write the values to non-volatile memory
+                 *  @return     XBStatus    XB_OK if everything is alright, error code if not
+                 **/
+                XBStatus commitRegisters(bool persist = false);
 
-                void setBaudRate(uint32_t baud, bool applyChange);
+                /** Access to the shadow register cache, e.g. to invalidate it after an external reset */
+                XBRegisterCache& registerCache() { return registers; }
 
+                /** Receive ring statistics of the serial port (high water mark, overruns) */
+                XBSerialRxStats getSerialRxStats() { return serial->rxStats(); }
+
+                /** Negotiated Baud Rate Change
+                 *  Writes ATBD and, if applyChange is set, applies it with ATAC. The local UART is switched once the
+                 *  module's "OK\r" has arrived at the old rate, then the link is verified with a burst of
+                 *  baudVerifyRounds register reads. If more than baudMaxErrors of them fail, the module is told to go
+                 *  back to the previous rate. If even that can't be confirmed, it is found again with discover().
+                 *  Nothing is written to non-volatile memory, so a power cycle always returns to the stored rate.
+                 *
+                 *  @param[in]  baud        The new rate
+                 *  @param[in]  applyChange False to only queue the change in the module
+                 *  @return     XBStatus    XB_OK if the link works at the new rate, XB_FAILED_COMPARE if verification
+                 *                          failed (the link was rolled back to the previous rate, if one was known),
+                 *                          XB_NOT_FOUND if the module was lost, or the error of a rejected command
+                 **/
+                XBStatus setBaudRate(uint32_t baud, bool applyChange = true);
+
+                /** Rate the local UART is using to talk with the module, 0 if not known yet */
                 uint32_t getBuadRate();
 
+                /** Round trips and failures seen by the last link verification */
+                const XBLinkCheck& getLinkCheck() { return linkCheck; }
+
+                /** Hardware Flow Control
+                 *  Configures RTS/CTS on both ends of the link: DIO6/DIO7 on the module (ATD6/ATD7) and the local
+                 *  transport. When enabling, the local side goes first so the host is already honoring CTS by the time
+                 *  the module starts relying on it. When disabling, the module goes first for the same reason. The
+                 *  change is applied with ATAC but not written to non-volatile memory.
+                 *
+                 *  @param[in]  enabled     True to turn RTS/CTS flow control on
+                 *  @return     XBStatus    XB_OK if both sides were configured, XB_NOT_SUPPORTED if the transport can't
+                 *                          do flow control, or the error of a rejected command
+                 **/
+                XBStatus setFlowControl(bool enabled);
+
+                /** How often the transport was throttled by CTS, and how often it held the module off with RTS */
+                XBFlowStats getFlowStats() { return serial->flowStats(); }
+
+                #if !defined(XBEE_PLATFORM_POSIX)
+                /** Assigns the GPIOs wired to the module's CTS (DIO7) and RTS (DIO6) pins. Required before
+                 *  setFlowControl(true), since the serial peripheral doesn't handle flow control itself. */
+                void attachFlowControlPins(Chimera::GPIO::Port ctsPort, uint8_t ctsPin, Chimera::GPIO::Port rtsPort,
+                    uint8_t rtsPin);
+                #endif
+
                 /** Set/Read the period of inactivity (no valid commands received) after which the RF module automatically exits 
                  *  AT Command Mode and returns to Idle Mode.
                  *  
@@ -75,6 +317,9 @@ namespace libxbee
                 /** Set required period of silence before and after the Command Sequence Characters of the AT Command Mode Sequence 
                  *  (GT + CC + GT). The period of silence is used to prevent inadvertent entrance into AT Command Mode.
                  *  
+                 *  The new value takes effect once applied with applyChanges(), which also switches the driver's own
+                 *  guard time over.
+                 *
                  *  @param[in]  guardTime_mS    Length of the required silence period in milliseconds
                  *  @param[in]  verify          Checks with the XBEE to make sure it reports back the value just set
                  *  @return     uint16_t        If verify is true, returns back the value reported from the XBEE. Otherwise returns the input.
@@ -85,36 +330,498 @@ namespace libxbee
                  *  @return true if in AT mode, false if not */
                 bool isATMode();
 
+                /** How much longer the module will stay in AT mode without another command, based on the time the last
+                 *  command was sent and atModeTimeout_mS.
+                 *
+                 *  @return     size_t      Remaining AT mode lifetime in milliseconds, 0 if not in AT mode
+                 **/
+                size_t atModeRemaining_mS();
+
+                /** Sends a batch of commands using as few round trips as possible
+                 *  In AT mode the commands are chained into comma separated lines that fill the tx buffer, and the response
+                 *  lines are matched back onto each command. In API mode each command is sent as its own AT Command frame.
+                 *  The per-command results are stored in the batch.
+                 *
+                 *  @param[in]  batch       The commands to send
+                 *  @param[in]  timeout_mS  How long to wait for each response chunk before erroring out
+                 *  @return     XBStatus    XB_OK if every command succeeded, otherwise the first failure
+                 **/
+                XBStatus txBatch(XBATBatch& batch, size_t timeout_mS = XB_DEFAULT_TIMEOUT_mS);
+
+                /** Explicitly exits AT mode with ATCN, which also applies any queued register changes.
+                 *  @return     XBStatus    XB_OK if everything is alright, error code if not */
+                XBStatus exitCommandMode();
+
+                /** Switches the module between transparent (AT) and API operation
+                 *  Once in API mode every register access is carried in AT Command (0x08) frames, so none of the
+                 *  command mode guard times are paid again. Leaving API mode is done with an API frame as well.
+                 *
+                 *  @param[in]  mode        The desired API mode
+                 *  @return     XBStatus    XB_OK if the module acknowledged the change, error code if not
+                 **/
+                XBStatus setAPIMode(XBAPIMode mode);
+
+                /** Returns the API mode the driver is currently using to talk with the module */
+                XBAPIMode getAPIMode() { return apiMode; }
+
+                /** Asynchronous Local AT Command
+                 *  Sends an AT Command (0x08) frame and returns as soon as it is on the wire. The AT Command Response
+                 *  (0x88) is routed back by frame ID from processIncoming(), so any number of requests up to
+                 *  XB_MAX_PENDING_REQUESTS can be outstanding. Requires API mode.
+                 *
+                 *  A write drops the register's cached value as soon as it is sent and counts as unapplied and
+                 *  unpersisted, so readRegister() goes back to the module and applyChanges(true) doesn't skip it.
+                 *
+                 *  @param[in]  command     The command to send
+                 *  @param[in]  param       Big-endian parameter bytes, nullptr to read the register
+                 *  @param[in]  paramLen    Number of parameter bytes
+                 *  @param[out] handle      Identifies the request, for waitFor() or isComplete()
+                 *  @param[in]  callback    Called with the completion, or nullptr to collect it with waitFor()
+                 *  @param[in]  context     Passed through to the callback
+                 *  @param[in]  timeout_mS  How long until the request completes with XB_TIMEOUT
+                 *  @return     XBStatus    XB_OK once sent, XB_NOT_SUPPORTED outside API mode, XB_BUFFER_OVERRUN if no
+                 *                          frame ID is free
+                 **/
+                XBStatus atCommandAsync(const char* command, const uint8_t* param, size_t paramLen, XBRequestHandle& handle,
+                    XBCompletionCallback callback = nullptr, void* context = nullptr, size_t timeout_mS = XB_ASYNC_TIMEOUT_mS);
+
+                /** Asynchronous Remote AT Command
+                 *  Sends a Remote AT Command (0x17) frame to another node. Completes with its Remote AT Command Response
+                 *  (0x97). See atCommandAsync() for the parameters shared with local commands.
+                 *
+                 *  @param[in]  address64   Target node
+                 *  @param[in]  address16   Target network address, XB_ADDRESS_16_UNKNOWN if not known
+                 *  @param[in]  options     Remote command options, e.g. XB_REMOTE_AT_APPLY_CHANGES
+                 **/
+                XBStatus remoteATCommandAsync(uint64_t address64, uint16_t address16, uint8_t options, const char* command,
+                    const uint8_t* param, size_t paramLen, XBRequestHandle& handle, XBCompletionCallback callback = nullptr,
+                    void* context = nullptr, size_t timeout_mS = XB_ASYNC_TIMEOUT_mS);
+
+                /** Asynchronous Transmit
+                 *  Sends a Transmit Request (0x10) frame. Completes with its Transmit Status (0x8B), which reports
+                 *  whether the data was delivered. See atCommandAsync() for the parameters shared with commands.
+                 *
+                 *  @param[in]  address64   Destination, XB_ADDRESS_64_COORDINATOR or XB_ADDRESS_64_BROADCAST
+                 *  @param[in]  address16   Destination network address, XB_ADDRESS_16_UNKNOWN if not known
+                 *  @param[in]  data        RF payload
+                 *  @param[in]  length      Number of payload bytes
+                 **/
+                XBStatus transmitAsync(uint64_t address64, uint16_t address16, const uint8_t* data, size_t length,
+                    XBRequestHandle& handle, XBCompletionCallback callback = nullptr, void* context = nullptr,
+                    size_t timeout_mS = XB_ASYNC_TIMEOUT_mS);
+
+                /** Same as above for a fixed-size payload, which is rejected at compile time if it can't fit in one
+                 *  Transmit Request. Payloads of run-time length over XB_TX_MAX_PAYLOAD fail with XB_INVALID_PARAM. */
+                template<size_t Length>
+                XBStatus transmitAsync(uint64_t address64, uint16_t address16, const uint8_t (&data)[Length],
+                    XBRequestHandle& handle, XBCompletionCallback callback = nullptr, void* context = nullptr,
+                    size_t timeout_mS = XB_ASYNC_TIMEOUT_mS)
+                {
+                    static_assert(Length <= XB_TX_MAX_PAYLOAD, "Payload is larger than a single Transmit Request carries");
+                    return transmitAsync(address64, address16, data, Length, handle, callback, context, timeout_mS);
+                }
+
+                /** Receive Dispatcher
+                 *  Decodes everything the module has sent and routes each frame: responses to outstanding requests
+                 *  complete them by frame ID, anything else goes to the frame handler. Requests past their deadline are
+                 *  completed with XB_TIMEOUT. Must be called regularly, or from a dedicated receive thread, while
+                 *  asynchronous requests are outstanding.
+                 *
+                 *  @param[in]  timeout_mS  How long to wait for the first frame
+                 *  @return     XBStatus    XB_OK if at least one frame was handled, XB_TIMEOUT if none arrived
+                 **/
+                XBStatus processIncoming(size_t timeout_mS = 0);
+
+                /** Runs the receive dispatcher until a request without a callback completes, then collects it
+                 *
+                 *  @param[in]  handle      The request
+                 *  @param[out] completion  The result
+                 *  @param[in]  timeout_mS  How long to wait. The request stays outstanding if this runs out first.
+                 *  @return     XBStatus    The request's status, XB_TIMEOUT if it's still outstanding, or
+                 *                          XB_INVALID_PARAM if the handle doesn't refer to a collectable request
+                 **/
+                XBStatus waitFor(const XBRequestHandle& handle, XBCompletion& completion, size_t timeout_mS = XB_ASYNC_TIMEOUT_mS);
+
+                /** True once a request without a callback has completed and can be collected */
+                bool isComplete(const XBRequestHandle& handle) { return requests.isComplete(handle); }
+
+                /** Number of asynchronous requests waiting on a response */
+                size_t pendingRequests() { return requests.pending(); }
+
+                /** Access to the frame ID table, e.g. for its completion and timeout counters */
+                XBRequestTable& requestTable() { return requests; }
+
+                /** Receives every frame the dispatcher doesn't route to a request or a frame type subscription */
+                void setFrameHandler(XBFrameCallback handler, void* context = nullptr);
+
+                /** Subscribes to one frame type, e.g. Receive Packets (0x90). Several subscribers may share a type.
+                 *  @return XB_OK, or XB_BUFFER_OVERRUN if XB_MAX_FRAME_HANDLERS subscriptions already exist */
+                XBStatus addFrameHandler(XBFrameType type, XBFrameCallback handler, void* context = nullptr);
+
+                /** Removes the subscriptions made with this handler and context */
+                void removeFrameHandler(XBFrameCallback handler, void* context = nullptr);
+
+                /** Frame pool that received frames are decoded into and pooled subscriptions are served from. The driver
+                 *  keeps one slot to decode into and only replaces it once a subscriber has held on to its frame. Must
+                 *  outlive the driver or be unset first. A frame that is partially received when the pool changes is
+                 *  dropped. */
+                void setFramePool(XBFramePool* pool);
+
+                /** Subscribes to one frame type with a pooled frame, for subscribers that keep frames after the call,
+                 *  e.g. to hand them to another thread. The frame is decoded straight into a pool slot, and every
+                 *  pooled subscriber shares it by copying the handle. If the pool was exhausted when the frame started
+                 *  arriving, the frame is copied into a slot once it is complete, or missed by the pooled subscribers
+                 *  if there still is none, which shows as exhausted in the pool's statistics.
+                 *
+                 *  @return XB_OK, XB_NOT_SUPPORTED without a frame pool, or XB_BUFFER_OVERRUN if
+                 *          XB_MAX_FRAME_HANDLERS subscriptions already exist */
+                XBStatus addFrameHandler(XBFrameType type, XBFrameRefCallback handler, void* context = nullptr);
+
+                /** Removes the pooled subscriptions made with this handler and context */
+                void removeFrameHandler(XBFrameRefCallback handler, void* context = nullptr);
+
+                /** Sends a frame built in a frame pool as it is, starting at the frame type. The frame ID isn't
+                 *  tracked, so any response goes to the frame handlers.
+                 *  @return XB_OK, XB_INVALID_PARAM for an empty handle, or XB_NOT_SUPPORTED outside API mode */
+                XBStatus sendFrame(const XBFrameRef& frame);
+
+                /** Node Discovery
+                 *  Sends ATND and records every node that answers in the node table, with its network address,
+                 *  identifier and device type. The receive dispatcher keeps running while the answers come in, so other
+                 *  traffic isn't held up. Requires API mode: in transparent mode the multi-line response doesn't fit the
+                 *  response buffer.
+                 *
+                 *  @param[in]  timeout_mS  How long to collect answers, 0 to use the module's ATNT
+                 *  @param[out] found       Number of nodes that answered, may be nullptr
+                 *  @return     XBStatus    XB_OK, XB_NOT_SUPPORTED outside API mode, or the error the module reported
+                 **/
+                XBStatus discoverNodes(size_t timeout_mS = 0, size_t* found = nullptr);
+
+                /** Resolves a node identifier (ATNI) to the node's addresses, asking the network with ATDN unless the
+                 *  node table already knows them
+                 *
+                 *  @param[in]  identifier  Node identifier, up to 20 characters
+                 *  @param[out] node        The node
+                 *  @param[in]  timeout_mS  How long to wait for the module's answer
+                 *  @return     XBStatus    XB_OK, XB_INVALID_PARAM for a bad identifier, or the error the module reported
+                 **/
+                XBStatus resolveNode(const char* identifier, XBNodeInfo& node, size_t timeout_mS = XB_ASYNC_TIMEOUT_mS);
+
+                /** Nodes seen through discovery or received frames. Transmit and remote AT requests without a network
+                 *  address take it from here, so the module doesn't have to discover it first. */
+                XBNodeTable& nodeTable() { return nodes; }
+
+                /** Source Routing
+                 *  When enabled, transmit and remote AT requests to a node with a cached route first hand that route to
+                 *  the module with Create Source Route (0x21), so the packet follows it instead of waiting for a route
+                 *  discovery. Meant for a coordinator with many-to-one routing (ATAR), whose routers report their path
+                 *  in Route Record Indicator (0xA1) frames. The module only keeps the latest source route, so it is
+                 *  sent again only when the destination or its route changes.
+                 **/
+                void setSourceRouting(bool enabled);
+                bool getSourceRouting() { return sourceRouting; }
+
+                /** Routes reported by Route Record Indicator (0xA1) frames, recorded whether or not source routing is
+                 *  enabled */
+                XBRouteCache& routeCache() { return routes; }
+
+                /** Selects how the driver waits for responses from the module
+                 *  In blocking mode the calling thread sleeps on the serial RX complete semaphore for the remaining timeout
+                 *  instead of polling every 10 mS, so responses are handled as soon as they arrive.
+                 *
+                 *  @param[in]  mode        The desired receive mode
+                 *  @return     XBStatus    XB_OK if the mode was set, XB_INVALID_PARAM if it isn't supported
+                 **/
+                XBStatus setRxMode(XBRxMode mode);
+
+                /** Returns the latency statistics collected by the receive path */
+                const XBLatency& getRxLatency() { return rxLatency; }
+
+                /** Clears the receive latency statistics */
+                void resetRxLatency();
+
+                /** Copies the driver statistics: outcome counts per status, per-command round trip histograms (AT mode,
+                 *  API and asynchronous requests alike), command mode entries and guard time, receive overruns and
+                 *  serial traffic. Everything is zero when built with XB_ENABLE_STATISTICS set to 0.
+                 *
+                 *  @param[out] stats       Snapshot of the counters since the last resetDriverStats()
+                 **/
+                void getDriverStats(XBDriverStats& stats);
+
+                /** Clears the driver statistics */
+                void resetDriverStats();
+
 
 				XBStatus goToCommandMode();
 
-				XBEEProS2(int serialChannel, Chimera::GPIO::Port rstPort, uint8_t rstPin);
-				~XBEEProS2();
+				#if !defined(XBEE_PLATFORM_POSIX)
+				XBEEProS2Driver(int serialChannel, Chimera::GPIO::Port rstPort, uint8_t rstPin);
+				#endif
+
+				/** Drives the module over an already opened transport, e.g. XbeePosixSerial on a host gateway. No reset
+				 *	pin is used and the transport isn't owned by the driver. baud is the rate the transport was opened at,
+				 *	if known. */
+				XBEEProS2Driver(Transport* transport, uint32_t baud = 0);
+				~XBEEProS2Driver();
+
+				/* The serial port and reset pin may live inside the object */
+				XBEEProS2Driver(const XBEEProS2Driver&) = delete;
+				XBEEProS2Driver& operator=(const XBEEProS2Driver&) = delete;
 
 
                 size_t guardTimeout_mS = 1000;
                 size_t atModeTimeout_mS = 5000;
+                size_t baudVerifyRounds = 8;        /**< Round trips used to verify a new baud rate */
+                size_t baudMaxErrors = 0;           /**< Failed round trips tolerated before falling back */
             
 
 			private:
-				Chimera::Serial::SerialClass* serial;
-				Chimera::GPIO::GPIOClass* reset;
+				typedef XBSerialIO<Transport> IO;
+
+				Transport* serial;
+				#if !defined(XBEE_PLATFORM_POSIX)
+				XbeeChimeraSerial* chimeraSerial = nullptr;
+				Chimera::GPIO::GPIOClass* reset = nullptr;
+
+				/* Storage for the port and pin the Chimera constructor creates, so the driver never touches the heap
+				 * and can be placed in static memory */
+				alignas(XbeeChimeraSerial) uint8_t chimeraSerialStorage[sizeof(XbeeChimeraSerial)];
+				alignas(Chimera::GPIO::GPIOClass) uint8_t resetStorage[sizeof(Chimera::GPIO::GPIOClass)];
+				#endif
 
 				bool device_attached = false;
+
+                XBResetCallback resetLine = nullptr;
+                void* resetLineContext = nullptr;
+
+                /** Drives whichever reset line is available. False if there is none. */
+                bool driveReset(bool asserted);
+
+                XBRegisterCache registers;
+
+                XBAPIMode apiMode = XB_API_DISABLED;
+                XBAPIDecoder apiDecoder;
+                XBRequestTable requests;
+                XBFrameCallback frameHandler = nullptr;
+                void* frameHandlerContext = nullptr;
+
+                struct XBFrameSubscription
+                {
+                    XBFrameType type;
+                    XBFrameCallback handler;
+                    XBFrameRefCallback refHandler;
+                    void* context;
+                };
+
+                XBFrameSubscription frameHandlers[XB_MAX_FRAME_HANDLERS] = {};
+                XBFramePool* framePool = nullptr;
+                XBFrameRef rxSlot;                  /**< Pool slot apiDecoder is decoding into, if any */
+
+                XBNodeTable nodes;
+                uint8_t discoveryFrameID = 0;       /**< Frame ID of the running ATND, whose answers go to the node table */
+                size_t discoveryAnswers = 0;
+                bool discoveryDone = false;
+                XBStatus discoveryStatus = XB_OK;
+
+                XBRouteCache routes;
+                bool sourceRouting = false;
+                bool routeInstalled = false;        /**< The module holds installedRoute */
+                XBSourceRoute installedRoute;
+
+                /** Outcome of an ATDN request, filled in by onNodeResolved() */
+                struct XBNodeQuery
+                {
+                    XBNodeInfo* node;
+                    XBStatus status;
+                };
+
+                /* Received bytes not yet pushed through apiDecoder. Decoding stops after each frame so nothing behind
+                 * it is lost. */
+                uint8_t apiChunk[XBEE_RX_BUFFER_SIZE];
+                size_t apiChunkPos = 0;
+                size_t apiChunkLen = 0;
 				
-                TickType_t lastCmdMode;
+                size_t lastCmdMode_mS = 0;
+                bool cmdModeActive = false;
+                XBRxMode rxMode = XB_RX_POLLING;
+                XBLatency rxLatency;
+                XBStatistics statistics;
+                size_t overrunBase = 0;         /**< Serial overrun count at the last resetDriverStats() */
+
+				#if !defined(XBEE_PLATFORM_POSIX)
 				SemaphoreHandle_t txComplete;
 				SemaphoreHandle_t rxComplete;
 				SemaphoreHandle_t txRxComplete;
+				#endif
+
+                uint32_t baudRate = 0;
+                XBLinkCheck linkCheck;
+                uint32_t lastKnownBaud = 0;
+                XBDiscoveryStats discoveryStats;
+                XBBootStats bootStats;
+                size_t discoveryHits[XB_DISCOVERY_RATE_COUNT] = {};
+                static const uint32_t discoveryRates[XB_DISCOVERY_RATE_COUNT];
+
+                size_t lastTx_mS = 0;           /**< When the last byte was handed to the serial port */
+                bool txActive = false;          /**< Anything has been sent at all, so lastTx_mS is meaningful */
 
                 template<typename T>
                 void write(T* data, size_t length)
                 {
-                    /* Make sure that the low level write function can infer type! */
-                    serial->write(data, length);
+                    /* The serial interface deals in raw bytes, whatever the caller's buffer type */
+                    IO::write(*serial, (uint8_t*)data, length);
+                    statistics.addBytesOut(length);
+                    lastTx_mS = currentTime_mS();
+                    txActive = true;
                 }
 
-				XBStatus readWithTimeout(uint8_t* data, size_t length, size_t timeout_mS);
+				XBStatus readWithTimeout(uint8_t* data, size_t length, size_t timeout_mS, size_t* bytesRead = nullptr);
+
+                /** Reads a single "\r" terminated response line into a NUL terminated buffer, however the bytes are chunked
+                 *  on the way in. Anything received after the delimiter stays in the serial port for the next read.
+                 *
+                 *  @param[out] line        Buffer for the line, including the delimiter
+                 *  @param[in]  length      Size of line
+                 *  @param[in]  timeout_mS  How long to wait for the complete line
+                 *  @return     XBStatus    XB_OK if a line was read, XB_BUFFER_OVERRUN if it didn't fit, XB_TIMEOUT
+                 **/
+                XBStatus readLineWithTimeout(char* line, size_t length, size_t timeout_mS);
+
+                /** Enters command mode, waiting up to timeout_mS for the "OK\r" */
+                XBStatus enterCommandMode(size_t timeout_mS);
+
+                /** Reads an exact response, failing on the first byte that doesn't match instead of waiting for a full line
+                 *  @return XB_OK, XB_BAD_RESPONSE on a mismatch, XB_TIMEOUT */
+                XBStatus readExpected(const char* expected, size_t timeout_mS);
+
+                /** Sends an ATVR AT Command frame and waits briefly for the response, to check for an API mode module */
+                XBStatus probeAPI();
+
+                /** Reads the firmware version baudVerifyRounds times and records the outcome in linkCheck
+                 *  @return XB_OK if no more than baudMaxErrors round trips failed */
+                XBStatus verifyLink();
+
+                /** Discards anything already received, including a partially decoded API frame */
+                void flushInput();
+
+                /** Waits until the serial port has data, polling or blocking depending on rxMode
+                 *  @return XB_OK once data is available, XB_TIMEOUT if timeout_mS passed since startTime */
+                XBStatus waitForData(size_t startTime, size_t timeout_mS);
+
+                /** Adds a read that started at startTime to the latency statistics */
+                void recordLatency(size_t startTime, XBStatus result);
+
+                /** Millisecond time base used for timeouts and latency measurements */
+                size_t currentTime_mS();
+
+                /** Restarts the tracked AT mode lifetime. Called whenever the module accepts a command. */
+                void refreshATMode();
+
+                /** Updates the register cache from the response to a command the module accepted */
+                void trackResponse(const char* command, bool hasParam, uint32_t param);
+
+                /** Updates the register cache from every answered command in a batch */
+                void trackBatch(const XBATBatch& batch);
+
+                template<typename Driver>
+                friend class XBBasicCommandSession;
+
+                /** Returns a frame ID for a synchronous request that no asynchronous request is using */
+                uint8_t nextFrameID();
+
+                /** API Command
+                 *  Sends a local AT Command (0x08) frame and waits for the matching AT Command Response (0x88). On success
+                 *  the response is rendered into the rxBuffer exactly as the module would report it in AT mode ("OK\r"
+                 *  for a register write, the hex value and "\r" for a read) so callers are agnostic to the mode in use.
+                 *
+                 *  @param[in]  command     The command to be used
+                 *  @param[in]  param       Big-endian parameter bytes, nullptr for none
+                 *  @param[in]  paramLen    Number of parameter bytes
+                 *  @param[in]  timeout_mS  How long to wait for the response
+                 *  @return     XBStatus    XB_OK if everything is alright, error code if not
+                 **/
+                XBStatus apiCommand(const char* command, const uint8_t* param, size_t paramLen, size_t timeout_mS);
+
+                /** Sends an API frame straight from the caller's buffers
+                 *  Unescaped frames go out as a gather write of prefix, header, payload and checksum, so the payload is never
+                 *  copied. Escaped frames are encoded through a small scratch buffer in chunks.
+                 *
+                 *  @param[in]  header      Leading part of the frame data, starting with the frame type
+                 *  @param[in]  headerLen   Number of bytes in header
+                 *  @param[in]  payload     Trailing part of the frame data
+                 *  @param[in]  payloadLen  Number of bytes in payload
+                 *  @return     XBStatus    XB_OK if the frame was sent
+                 **/
+                XBStatus writeAPIFrame(const uint8_t* header, size_t headerLen, const uint8_t* payload, size_t payloadLen);
+
+                /** Sends a local AT Command (0x08) frame. A frame ID of 0 suppresses the response. */
+                XBStatus writeATCommandFrame(uint8_t frameID, const char* command, const uint8_t* param, size_t paramLen);
+
+                /** Reads from the serial port until a frame of the given type and frame ID has been decoded. Every other
+                 *  frame received on the way is dispatched, so asynchronous completions are never lost.
+                 *
+                 *  @param[in]  type        The frame type to wait for
+                 *  @param[in]  frameID     The frame ID to match
+                 *  @param[in]  timeout_mS  How long to wait between received chunks before giving up
+                 *  @return     XBStatus    XB_OK if the frame is available in apiDecoder, XB_BAD_CHECKSUM if it
+                 *                          timed out after dropping a corrupted frame, error code if not
+                 **/
+                XBStatus readAPIFrame(XBFrameType type, uint8_t frameID, size_t timeout_mS);
+
+                /** Points apiDecoder at a pool slot no one else holds, between frames */
+                void claimRxSlot();
+
+                /** Decodes received bytes until a complete frame is available in apiDecoder
+                 *  @return XB_OK, or XB_TIMEOUT if timeout_mS passed without any data */
+                XBStatus readNextFrame(size_t timeout_mS);
+
+                /** Routes the frame in apiDecoder to its request, its subscribers or the frame handler */
+                void dispatchFrame();
+
+                /** Updates the node table from frames that carry a node's addresses
+                 *  @return True if the frame was an ATND answer, which isn't dispatched any further */
+                bool updateNodes(const uint8_t* frame, size_t length);
+
+                /** Sends the cached route to a destination with Create Source Route, unless the module already holds it.
+                 *  Fills in the network address from the route if it isn't known. */
+                void applySourceRoute(uint64_t address64, uint16_t& address16);
+
+                /** Completion callback of resolveNode(). The context is an XBNodeQuery. */
+                static void onNodeResolved(const XBCompletion& completion, void* context);
+
+                /** Request table observer, records every asynchronous round trip. The context is the driver. */
+                static void onCompletion(const XBCompletion& completion, void* context);
+
+                /** Registers a request and sends its frame. The header must leave room for the frame ID at index 1. */
+                XBStatus sendAsync(XBFrameType expected, uint8_t* header, size_t headerLen, const uint8_t* payload,
+                    size_t payloadLen, XBRequestHandle& handle, XBCompletionCallback callback, void* context,
+                    size_t timeout_mS);
+
+                /** Serializes a register value into the minimum number of big-endian bytes (at least one) */
+                template<typename T>
+                size_t serializeParam(T payload, uint8_t* out)
+                {
+                    uint8_t bytes[sizeof(T)];
+                    size_t length = 0;
+
+                    for (size_t i = 0; i < sizeof(T); i++)
+                    {
+                        bytes[sizeof(T) - 1 - i] = (uint8_t)(((uint64_t)payload) >> (8 * i));
+                    }
+
+                    size_t first = 0;
+                    while ((first < (sizeof(T) - 1)) && (bytes[first] == 0))
+                    {
+                        first++;
+                    }
+
+                    for (size_t i = first; i < sizeof(T); i++)
+                    {
+                        out[length++] = bytes[i];
+                    }
+
+                    return length;
+                }
 
 
                 char txBuffer[XBEE_TX_BUFFER_SIZE];
@@ -122,94 +829,149 @@ namespace libxbee
 
                 bool updateTimingParams();
 
-                char* strip(char* buffer, const char* chars);
 
                 /** Frame Builder
                  *  Generates a frame of data, written to the internal tx buffer, from a given command and optional payload
                  *  
                  *	@param[in]	command     The command to be used
-                 *  @param[in]  payload     If desired, data to be attached to the frame
-                 *	@return     int         The number of bytes written to the internal tx buffer
+                 *  @param[in]  hasParam    True to attach payload. Zero is a valid value, so it doesn't mean "none".
+                 *  @param[in]  payload     Data to be attached to the frame
+                 *	@return     int         The number of bytes written to the internal tx buffer, XB_BUFFER_TOO_SMALL if the
+                 *	                        command is invalid or doesn't fit
                  **/
                 template<typename T = uint16_t>
-                int frameBuilder(const char* command, T payload = 0)
+                int frameBuilder(const char* command, bool hasParam = false, T payload = 0)
                 {
                     if (!command)
                     {
                         return 0;
                     }
 
-                    memset(txBuffer, 0, XBEE_TX_BUFFER_SIZE);
-
-                    /* Write one of two formats depending on if a payload is present */
-                    int bytesWritten = 0;
-                    if (payload)
-                    {
-                        /* We have a payload and are writing a register on the XBEE */
-                        bytesWritten = snprintf(txBuffer, XBEE_TX_BUFFER_SIZE, "%s %x%s", command, payload, XB_DELIMITER);
-                    }
-                    else
-                    {
-                        /* No payload. We are requesting data or acknowledging something. */
-                        bytesWritten = snprintf(txBuffer, XBEE_TX_BUFFER_SIZE, "%s%s", command, XB_DELIMITER);
-                    }
+                    /* Assembled in place with no formatting library and without clearing the rest of the buffer. The
+                     * result is not NUL terminated. */
+                    size_t bytesWritten = encodeATCommand(txBuffer, XBEE_TX_BUFFER_SIZE, command, hasParam, (uint32_t)payload);
 
                     /* Force a very conspicuous integer to signal the buffer overrun condition */
-                    if (bytesWritten > XBEE_TX_BUFFER_SIZE)
+                    if (!bytesWritten)
                     {
-                        bytesWritten = XB_BUFFER_TOO_SMALL;
+                        return XB_BUFFER_TOO_SMALL;
                     }
 
-                    return bytesWritten;
+                    return (int)bytesWritten;
                 }
 
                 /** Transmit Frame
                  *	Transmits a single command to the Xbee. If the device was not in command (AT) mode it will be placed 
                  *  into it. By default, the data for both transmit and receive are written to the internal tx/rx buffers.
+                 *  Without a payload the command reads the register (or executes it, e.g. AC); with one it is a write,
+                 *  including a payload of zero ("ATBD 0").
                  *
                  *	@param[in]	command     The command to be used
-                 *  @param[in]  payload     If desired, data to be attached to the frame
+                 *  @param[in]  payload     Data to be written to the register
                  *	@return     XBStatus    XB_OK if everything is alright, error code if not
                  **/
-                template<typename T = uint16_t>
-                XBStatus txFrame(const char* command, T payload = 0)
+                XBStatus txFrame(const char* command)
+                {
+                    return txCommand(command, false, (uint16_t)0);
+                }
+
+                template<typename T>
+                XBStatus txFrame(const char* command, T payload)
+                {
+                    return txCommand(command, true, payload);
+                }
+
+                /** Transmit Frame with Result
+                 *	Transmits a single command to the Xbee and returns back whatever response was given. If the device was
+                 *	not in command (AT) mode it will be placed into it. By default, the data for both transmit and receive 
+                 *  are written to the internal tx/rx buffers. This function will not return until the data has been read,
+                 *  or the timeout has occured. As with txFrame(), passing a payload makes the command a write.
+                 *
+                 *	@param[in]	command     The command to be used
+                 *  @param[in]  payload     Data to be written to the register
+                 *	@param[in]	timeout	    How long to wait (in mS) for a response before erroring out
+                 *	@return     XBStatus    XB_OK if everything is alright, error code if not
+                 **/
+                XBStatus txFrameWithResult(const char* command)
+                {
+                    return txCommandWithResult(command, false, (uint16_t)0, XB_DEFAULT_TIMEOUT_mS);
+                }
+
+                template<typename T>
+                XBStatus txFrameWithResult(const char* command, T payload, size_t timeout_mS = XB_DEFAULT_TIMEOUT_mS)
+                {
+                    return txCommandWithResult(command, true, payload, timeout_mS);
+                }
+
+                /** Transmits a read (hasParam false) or a write of payload. Backs txFrame(). */
+                template<typename T>
+                XBStatus txCommand(const char* command, bool hasParam, T payload)
                 {
                     if (!command)
                     {
                         return XB_INVALID_PARAM;
                     }
 
+                    /* API mode has no command mode to enter. A zero frame ID tells the module not to respond. */
+                    if (apiMode != XB_API_DISABLED)
+                    {
+                        uint8_t param[sizeof(T)];
+                        size_t paramLen = hasParam ? serializeParam(payload, param) : 0;
+
+                        return writeATCommandFrame(0, command, param, paramLen);
+                    }
+
+                    /* Built first, so a command that can't be encoded doesn't cost a trip into command mode */
+                    int bytesWritten = frameBuilder(command, hasParam, payload);
+                    if (bytesWritten <= 0)
+                    {
+                        return bytesWritten ? static_cast<XBStatus>(bytesWritten) : XB_INVALID_PARAM;
+                    }
+
                     if (!isATMode() && (goToCommandMode() != XB_OK))
                     {
                         return XB_FAILED_COMMAND_MODE;
                     }
 
-                    int bytesWritten = frameBuilder(command, payload);
-                    write(txBuffer, bytesWritten);
+                    write(txBuffer, (size_t)bytesWritten);
+
+                    /* Any valid command restarts the module's command mode timeout */
+                    refreshATMode();
                     return XB_OK;
                 }
 
-                /** Transmit Frame with Result
-                 *	Transmits a single command to the Xbee and returns back whatever response was given. If the device was
-                 *	not in command (AT) mode it will be placed into it. By default, the data for both transmit and receive 
-                 *  are written to the internal tx/rx buffers. This function will not return until the data has been read,
-                 *  or the timeout has occured.
-                 *
-                 *	@param[in]	command     The command to be used
-                 *  @param[in]  payload     If desired, data to be attached to the frame
-                 *	@param[in]	timeout	    How long to wait (in mS) for a response before erroring out
-                 *	@return     XBStatus    XB_OK if everything is alright, error code if not
-                 **/
-                template<typename T = uint16_t>
-                XBStatus txFrameWithResult(const char* command, T payload = 0, size_t timeout_mS = XB_DEFAULT_TIMEOUT_mS)
+                /** Transmits a read or write and waits for the response. Backs txFrameWithResult(). */
+                template<typename T>
+                XBStatus txCommandWithResult(const char* command, bool hasParam, T payload, size_t timeout_mS)
                 {
-                    memset(rxBuffer, 0, XBEE_RX_BUFFER_SIZE);
-                    
-                    XBStatus result = txFrame(command, payload);
+                    XBStatus result = XB_OK;
+
+                    if (apiMode != XB_API_DISABLED)
+                    {
+                        uint8_t param[sizeof(T)];
+                        size_t paramLen = hasParam ? serializeParam(payload, param) : 0;
+
+                        result = apiCommand(command, paramLen ? param : nullptr, paramLen, timeout_mS);
+                    }
+                    else
+                    {
+                        memset(rxBuffer, 0, XBEE_RX_BUFFER_SIZE);
+
+                        /* Timed from before txFrame(), so entering command mode counts against the command */
+                        size_t startTime = currentTime_mS();
+                        result = txCommand(command, hasParam, payload);
+
+                        if (result == XB_OK)
+                        {
+                            result = readLineWithTimeout(rxBuffer, XBEE_RX_BUFFER_SIZE, timeout_mS);
+                        }
+
+                        statistics.recordCommand(XB_FRAME_AT_COMMAND, command, result, currentTime_mS() - startTime);
+                    }
 
                     if (result == XB_OK)
                     {
-                        result = readWithTimeout((uint8_t*)rxBuffer, XBEE_RX_BUFFER_SIZE, timeout_mS);
+                        trackResponse(command, hasParam, (uint32_t)payload);
                     }
 
                     return result;
@@ -234,16 +996,15 @@ namespace libxbee
 
                     if (result == XB_OK)
                     {
-                        /* Convert the expected value into a string for easy comparison */
-                        memset(txBuffer, 0, XBEE_TX_BUFFER_SIZE);
-                        int bytesWritten = snprintf(txBuffer, XBEE_TX_BUFFER_SIZE, "%s", expected);
+                        /* Compare numerically so leading zeros and letter case don't matter */
+                        uint32_t actual = 0;
 
-                        if (memcmp(rxBuffer, txBuffer, bytesWritten) != 0)
+                        if (!decodeHex(rxBuffer, XBEE_RX_BUFFER_SIZE, actual) || (actual != (uint32_t)expected))
                         {
                             result = XB_FAILED_COMPARE;
 
                             #ifdef DEBUG
-                            Chimera::Logging::Console.log(Chimera::Logging::Level::ERROR, "XBEE: Param compare [%s] doesn't match [%s]\r\n", rxBuffer, txBuffer);
+                            XB_LOG(ERROR, "XBEE: Param compare [%s] doesn't match [%X]\r\n", rxBuffer, (uint32_t)expected);
                             #endif
                         }
                     }
@@ -251,11 +1012,2214 @@ namespace libxbee
                     return result;
                 }
 
+                /** Validates that the register holds the expected response text */
+                XBStatus verifyParameter(const char* command, const char* expected);
+
                 bool isRxBufferEqual(const char* data);
                 
 			};
 
-            
+            /** Driver over the virtual transport interface, as used by the Chimera constructor and most applications */
+            typedef XBEEProS2Driver<> XBEEProS2;
+
+            /** Command Mode Session
+             *  Holds the module in AT command mode across a burst of commands so the "+++" sequence and its guard times
+             *  are paid at most once. The session relies on the lifetime tracked by the driver: every command restarts the
+             *  module's ATCT timer, so command mode is only re-entered if the burst stalls for longer than atModeTimeout_mS.
+             *  On close the session either exits with ATCN (applying queued changes) or leaves the module to time out.
+             *  In API mode there is no command mode, so the session simply forwards commands.
+             *
+             *  @code
+             *  XBCommandSession session(xbee);
+             *  session.open();
+             *  session.command(XB_CMD_MODE_TIMEOUT, 0x64);
+             *  session.command(XB_SET_GUARD_TIME, 0x32);
+             *  session.close();
+             *  @endcode
+             *
+             *  @tparam Driver      Driver instance the session issues commands through
+             **/
+            template<typename Driver = XBEEProS2>
+            class XBBasicCommandSession
+            {
+            public:
+                /** Enters command mode if the module isn't already known to be in it
+                 *  @return     XBStatus    XB_OK if commands can be issued, error code if not */
+                XBStatus open();
+
+                /** Sends a command and waits for the response, which is available through response(). Without a
+                 *  payload the register is read (or the command executed); with one it is written, even if it is zero.
+                 *
+                 *  @param[in]  command     The command to be used
+                 *  @param[in]  payload     Data to be written to the register
+                 *  @param[in]  timeout_mS  How long to wait (in mS) for a response before erroring out
+                 *  @return     XBStatus    XB_OK if everything is alright, error code if not
+                 **/
+                XBStatus command(const char* command)
+                {
+                    return counted(opened ? device.txFrameWithResult(command) : XB_FAILED_COMMAND_MODE);
+                }
+
+                template<typename T>
+                XBStatus command(const char* command, T payload, size_t timeout_mS = Driver::XB_DEFAULT_TIMEOUT_mS)
+                {
+                    return counted(opened ? device.txFrameWithResult(command, payload, timeout_mS) : XB_FAILED_COMMAND_MODE);
+                }
+
+                /** Ends the session. Exits command mode with ATCN if the session was created with exitOnClose.
+                 *  @return     XBStatus    XB_OK if everything is alright, error code if not */
+                XBStatus close();
+
+                /** Remaining AT mode lifetime before the module drops out on its own */
+                size_t remaining_mS();
+
+                /** Response text of the last command */
+                const char* response();
+
+                size_t commands = 0;            /**< Commands successfully issued in this session */
+                size_t entries = 0;             /**< How many times "+++" had to be sent to get into command mode */
+
+                XBBasicCommandSession(Driver& device, bool exitOnClose = true);
+                ~XBBasicCommandSession();
+
+            private:
+                Driver& device;
+                bool exitOnClose;
+                bool opened = false;
+
+                /** Counts a successful command and passes the result through */
+                XBStatus counted(XBStatus result)
+                {
+                    if (result == XB_OK)
+                    {
+                        commands++;
+                    }
+
+                    return result;
+                }
+            };
+
+            typedef XBBasicCommandSession<XBEEProS2> XBCommandSession;
+
+			#if !defined(XBEE_PLATFORM_POSIX)
+			template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+			XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::XBEEProS2Driver(int serialChannel, Chimera::GPIO::Port rstPort, uint8_t rst_pin)
+			{
+				static_assert(std::is_base_of<Transport, XbeeChimeraSerial>::value,
+					"The Chimera constructor needs a transport XbeeChimeraSerial derives from");
+
+				using namespace Chimera::GPIO;
+				using namespace Chimera::Serial;
+
+				txComplete = xSemaphoreCreateCounting(32, 0);
+				rxComplete = xSemaphoreCreateBinary();
+				txRxComplete = xSemaphoreCreateBinary();
+
+				chimeraSerial = new (chimeraSerialStorage) XbeeChimeraSerial(serialChannel);
+				serial = chimeraSerial;
+				reset = new (resetStorage) GPIOClass(rstPort, rst_pin);
+
+				/* Reset is active low, so make sure the pin is high on startup */
+				reset->mode(Chimera::GPIO::Mode::OUTPUT_PUSH_PULL);
+				reset->write(Chimera::GPIO::State::HIGH);
+
+				/* Use this as a default starting point. Will likely change later in user code */
+				chimeraSerial->initialize(BaudRate::SERIAL_BAUD_115200, Modes::BLOCKING, Modes::INTERRUPT);
+				baudRate = BaudRate::SERIAL_BAUD_115200;
+				chimeraSerial->driver()->attachThreadTrigger(TX_COMPLETE, &txComplete);
+				chimeraSerial->driver()->attachThreadTrigger(RX_COMPLETE, &rxComplete);
+				chimeraSerial->driver()->attachThreadTrigger(TXRX_COMPLETE, &txRxComplete);
+
+				requests.setObserver(&XBEEProS2Driver::onCompletion, this);
+
+				/* Give the Xbee a little bit to stabilize from the possible reset event, unless hardwareReset() will be
+				 * used to wait for it instead */
+				if (XB_STARTUP_DELAY_mS)
+				{
+					platform::delayMilliseconds(XB_STARTUP_DELAY_mS);
+				}
+			}
+			#endif
+
+			template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+			XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::XBEEProS2Driver(Transport* transport, uint32_t baud)
+			{
+				/* The caller owns the transport and has already opened it at the expected baud rate */
+				serial = transport;
+				baudRate = baud;
+				requests.setObserver(&XBEEProS2Driver::onCompletion, this);
+			}
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::~XBEEProS2Driver()
+            {
+                #if !defined(XBEE_PLATFORM_POSIX)
+                /* Both were constructed in place, so only their destructors are run */
+                if (reset)
+                {
+                    reset->~GPIOClass();
+                }
+
+                if (chimeraSerial)
+                {
+                    chimeraSerial->~XbeeChimeraSerial();
+                }
+                #endif
+            }
+
+            /* Candidate rates in order of how likely a module is to be found at them: the rate this driver configures by
+             * default, the factory default, then the remaining standard rates from the most to least commonly used. */
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            const uint32_t XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::discoveryRates[XB_DISCOVERY_RATE_COUNT] = {
+                115200u, 9600u, 57600u, 230400u, 460800u, 921600u, 38400u, 19200u
+            };
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::discover(uint32_t baud)
+			{
+				XB_LOG(INFO, "Starting XBEE Discovery...\r\n");
+				size_t startTime = currentTime_mS();
+				discoveryStats = XBDiscoveryStats();
+
+				/* Requested rate first, then wherever the module was last seen, then the rest by likelihood. Rates
+				 * that have produced a module before in this session move ahead of the fixed ordering. */
+				uint32_t candidates[XB_DISCOVERY_RATE_COUNT + 2];
+				size_t candidateCount = 0;
+
+				auto addCandidate = [&](uint32_t rate)
+				{
+					for (size_t i = 0; i < candidateCount; i++)
+					{
+						if (candidates[i] == rate)
+						{
+							return;
+						}
+					}
+
+					if (rate)
+					{
+						candidates[candidateCount++] = rate;
+					}
+				};
+
+				addCandidate(baud);
+				addCandidate(lastKnownBaud);
+
+				size_t order[XB_DISCOVERY_RATE_COUNT];
+				for (size_t i = 0; i < XB_DISCOVERY_RATE_COUNT; i++)
+				{
+					/* Stable insertion sort on hit count, so ties keep the likelihood ordering */
+					size_t j = i;
+					while ((j > 0) && (discoveryHits[order[j - 1]] < discoveryHits[i]))
+					{
+						order[j] = order[j - 1];
+						j--;
+					}
+
+					order[j] = i;
+				}
+
+				for (size_t i = 0; i < XB_DISCOVERY_RATE_COUNT; i++)
+				{
+					addCandidate(discoveryRates[order[i]]);
+				}
+
+				/* In API mode a single AT Command frame answers within a few milliseconds, so sweep every rate with
+				 * that before paying guard times. Either way each probe only waits as long as a real answer takes,
+				 * and bytes that can't be the start of the expected answer fail it straight away. */
+				XBStatus result = XB_NOT_FOUND;
+				bool apiPass = (apiMode != XB_API_DISABLED);
+
+				for (int pass = apiPass ? 0 : 1; (pass < 2) && (result != XB_OK); pass++)
+				{
+					for (size_t i = 0; (i < candidateCount) && (result != XB_OK); i++)
+					{
+						#ifdef DEBUG
+						XB_LOG(INFO, "Pinging XBEE at baud: %d\r\n", (int)candidates[i]);
+						#endif
+
+						/* A rate the port can't produce can't be probed either */
+						if (!serial->setBaud(candidates[i]))
+						{
+							continue;
+						}
+
+						discoveryStats.probes++;
+
+						if (pass == 0)
+						{
+							result = probeAPI();
+						}
+						else
+						{
+							result = enterCommandMode(guardTimeout_mS + XB_PROBE_MARGIN_mS);
+						}
+
+						if (result == XB_OK)
+						{
+							discoveryStats.baud = candidates[i];
+						}
+					}
+				}
+
+				discoveryStats.elapsed_mS = currentTime_mS() - startTime;
+
+				if (result != XB_OK)
+				{
+					/* Leave the port where the caller asked for it */
+					serial->setBaud(baud);
+					baudRate = baud;
+					XB_LOG(WARN, "XBEE not found with standard baud rates at 8N1.\r\n");
+					return XB_NOT_FOUND;
+				}
+
+				baudRate = discoveryStats.baud;
+				discoveryStats.lastKnownHit = (discoveryStats.baud == lastKnownBaud);
+				lastKnownBaud = discoveryStats.baud;
+
+				for (size_t i = 0; i < XB_DISCOVERY_RATE_COUNT; i++)
+				{
+					if (discoveryRates[i] == discoveryStats.baud)
+					{
+						discoveryHits[i]++;
+					}
+				}
+
+				XB_LOG(INFO, "Found XBEE at baud: %d in %d mS\r\n", (int)discoveryStats.baud, (int)discoveryStats.elapsed_mS);
+
+				#ifdef DEBUG
+				if (discoveryStats.baud != baud)
+				{
+					XB_LOG(WARN, "Discovered baud rate [%d] doesn't match expected [%d]\r\n", (int)discoveryStats.baud, (int)baud);
+				}
+				#endif
+
+				return XB_OK;
+			}
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::probeAPI()
+            {
+                flushInput();
+
+                uint8_t frameID = nextFrameID();
+                XBStatus result = writeATCommandFrame(frameID, XB_FIRMWARE_VER, nullptr, 0);
+
+                if (result == XB_OK)
+                {
+                    result = readAPIFrame(XB_FRAME_AT_RESPONSE, frameID, XB_API_PROBE_TIMEOUT_mS);
+                }
+
+                return result;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::flushInput()
+            {
+                uint8_t discard[XBEE_RX_BUFFER_SIZE];
+                size_t count = 0;
+                while ((count = IO::read(*serial, discard, sizeof(discard))) != 0)
+                {
+                    statistics.addBytesIn(count);
+                }
+
+                apiDecoder.reset();
+                apiChunkPos = 0;
+                apiChunkLen = 0;
+            }
+
+			template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+			libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::initialize(const Config& config)
+			{   
+                if (!updateTimingParams())
+                {
+                    #ifdef DEBUG
+                    XB_LOG(ERROR, "XBEE: Failed updating timing info!\r\n");
+                    #endif
+
+                    return XB_BAD_RESULT;
+                }
+
+                /* First change the baud rate to the desired value and make sure we can talk */
+                
+
+                /* Then update the rest of the parameters. Zeroed fields keep the defaults. */
+
+                size_t result = setATModeTimeout(config.commandModeTimeout ? config.commandModeTimeout : 6000, true);
+                XB_LOG(INFO, "Set to [%d]\r\n", (int)result);
+
+                if (config.guardTime)
+                {
+                    guardTime(config.guardTime, true);
+                }
+
+                /* keep the setting changes here minimal. We want the user to take advantage of the API 
+                 * and build their own functions to write commands. 
+                 */
+
+                /* Finally, apply all the changes */
+
+                return applyChanges(true);
+			}
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::applyChanges(bool onlyIfDirty)
+            {
+                if (onlyIfDirty && !registers.needsApply())
+                {
+                    return XB_OK;
+                }
+
+                txFrameWithResult(XB_APPLY_CHANGES);
+
+                if (isRxBufferEqual(XB_DEFAULT_RESPONSE))
+                {
+                    /* A new guard time or command mode timeout is in force from here on */
+                    updateTimingParams();
+                    return XB_OK;
+                } 
+                else
+                {
+                    return XB_FAILED_COMMAND;
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::updateNonVolatileMemory(bool onlyIfDirty)
+            {
+                /* The EM250 has a limited number of flash write cycles, so don't burn one rewriting identical values */
+                if (onlyIfDirty && !registers.needsPersist())
+                {
+                    return XB_OK;
+                }
+
+                txFrameWithResult(XB_WRITE_MEMORY);
+
+                if (isRxBufferEqual(XB_DEFAULT_RESPONSE))
+                {
+                    return XB_OK;
+                }
+                else
+                {
+                    return XB_FAILED_COMMAND;
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::readRegister(const char* command, uint32_t& value, bool useCache)
+            {
+                if (useCache && registers.get(command, value))
+                {
+                    return XB_OK;
+                }
+
+                XBStatus result = txFrameWithResult(command);
+
+                if ((result == XB_OK) && !decodeHex(rxBuffer, XBEE_RX_BUFFER_SIZE, value))
+                {
+                    result = XB_BAD_RESPONSE;
+                }
+
+                return result;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::writeRegister(const char* command, uint32_t value)
+            {
+                return registers.set(command, value);
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::commitRegisters(bool persist)
+            {
+                XBATBatch batch;
+                XBStatus result = registers.buildFlush(batch, persist);
+
+                if ((result == XB_OK) && batch.size())
+                {
+                    result = txBatch(batch);
+                }
+
+                return result;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setBaudRate(uint32_t baud, bool applyChange)
+            {
+                uint32_t bd = baudToRegister(baud);
+                if (!baud || !commands::BaudRate::inRange(bd))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                uint32_t previous = baudRate;
+
+                XBStatus result = txFrameWithResult(XB_BAUD_RATE, bd);
+                if ((result == XB_OK) && !isRxBufferEqual(XB_DEFAULT_RESPONSE))
+                {
+                    result = XB_FAILED_COMMAND;
+                }
+
+                if ((result != XB_OK) || !applyChange)
+                {
+                    return result;
+                }
+
+                /* The OK to AC still comes back at the old rate. The module switches right after sending it. */
+                result = txFrameWithResult(XB_APPLY_CHANGES);
+                if ((result == XB_OK) && !isRxBufferEqual(XB_DEFAULT_RESPONSE))
+                {
+                    result = XB_FAILED_COMMAND;
+                }
+
+                if (result != XB_OK)
+                {
+                    return result;
+                }
+
+                /* The module has already moved, so a port that can't follow falls back below like a bad link would */
+                if (serial->setBaud(baud))
+                {
+                    baudRate = baud;
+                }
+
+                if ((baudRate == baud) && (verifyLink() == XB_OK))
+                {
+                    return XB_OK;
+                }
+
+                if (!previous || (previous == baud))
+                {
+                    /* Nothing known to fall back to */
+                    return XB_FAILED_COMPARE;
+                }
+
+                XB_LOG(WARN, "XBEE: Link unreliable at [%d] baud (%d/%d errors), falling back to [%d]\r\n", (int)baud,
+                    (int)linkCheck.errors, (int)linkCheck.rounds, (int)previous);
+
+                /* The module may still understand the host even if its answers are getting lost, so ask it to go back
+                 * from the new rate. Either way, check from the old rate afterwards. */
+                txFrameWithResult(XB_BAUD_RATE, baudToRegister(previous));
+                txFrameWithResult(XB_APPLY_CHANGES);
+
+                serial->setBaud(previous);
+                baudRate = previous;
+
+                if (verifyLink() == XB_OK)
+                {
+                    return XB_FAILED_COMPARE;
+                }
+
+                /* Nobody knows where the module ended up, including the register cache */
+                registers.invalidate();
+                cmdModeActive = false;
+
+                return (discover(previous) == XB_OK) ? XB_FAILED_COMPARE : XB_NOT_FOUND;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            uint32_t XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::getBuadRate()
+            {
+                return baudRate;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setFlowControl(bool enabled)
+            {
+                if (enabled && !serial->setFlowControl(true))
+                {
+                    return XB_NOT_SUPPORTED;
+                }
+
+                uint32_t value = enabled ? XB_DIO_FLOW_CONTROL : XB_DIO_DISABLED;
+
+                XBStatus result = writeRegister(XB_RTS_FLOW_CONTROL, value);
+                if (result == XB_OK)
+                {
+                    result = writeRegister(XB_CTS_FLOW_CONTROL, value);
+                }
+
+                if (result == XB_OK)
+                {
+                    result = commitRegisters();
+                }
+
+                if (result != XB_OK)
+                {
+                    /* The module is in an unknown state, so only undo the local side of a failed enable */
+                    if (enabled)
+                    {
+                        serial->setFlowControl(false);
+                    }
+
+                    return result;
+                }
+
+                if (!enabled)
+                {
+                    serial->setFlowControl(false);
+                }
+
+                return XB_OK;
+            }
+
+            #if !defined(XBEE_PLATFORM_POSIX)
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::attachFlowControlPins(Chimera::GPIO::Port ctsPort, uint8_t ctsPin, Chimera::GPIO::Port rtsPort,
+                uint8_t rtsPin)
+            {
+                chimeraSerial->attachFlowControlPins(ctsPort, ctsPin, rtsPort, rtsPin);
+            }
+            #endif
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::verifyLink()
+            {
+                linkCheck = XBLinkCheck();
+                linkCheck.baud = baudRate;
+
+                for (size_t i = 0; i < baudVerifyRounds; i++)
+                {
+                    uint32_t value = 0;
+                    linkCheck.rounds++;
+
+                    if (readRegister(XB_FIRMWARE_VER, value, false) != XB_OK)
+                    {
+                        linkCheck.errors++;
+
+                        /* Don't let the remains of a garbled answer poison the next round */
+                        flushInput();
+                    }
+                }
+
+                return (linkCheck.errors > baudMaxErrors) ? XB_FAILED_COMPARE : XB_OK;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            size_t XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setATModeTimeout(size_t atTimeout_mS, bool verify)
+            {
+                /* Some quick boundary checking... */
+                uint16_t registerValue = (uint16_t)commands::CommandModeTimeout::clamp(atTimeout_mS / XB_AT_TIMEOUT_MULT);
+
+                /* Make sure the OK response is captured before moving on. Skip the write if the module already holds it. */
+                uint32_t cached = 0;
+                if (!registers.get(XB_CMD_MODE_TIMEOUT, cached) || (cached != registerValue))
+                {
+                    txFrameWithResult(XB_CMD_MODE_TIMEOUT, registerValue);
+                }
+                else
+                {
+                    registers.writesAvoided++;
+                }
+
+                if (verify)
+                {
+                    verifyParameter(XB_CMD_MODE_TIMEOUT, registerValue);
+
+                    /* Convert the actual value back into milliseconds. The result of verifyParameter
+                     * is stored in the rxBuffer as a hex string. */
+                    uint32_t tmp = 0;
+                    decodeHex(rxBuffer, XBEE_RX_BUFFER_SIZE, tmp);
+                    return (size_t)(tmp * XB_AT_TIMEOUT_MULT);
+                }
+                else
+                {
+                    return atTimeout_mS;
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            size_t XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::guardTime(size_t guardTime_mS, bool verify)
+            {
+                uint16_t registerValue = (uint16_t)commands::GuardTime::clamp(guardTime_mS);
+
+                /* First write the data to the XBEE, unless it already holds the value */
+                uint32_t cached = 0;
+                if (!registers.get(XB_SET_GUARD_TIME, cached) || (cached != registerValue))
+                {
+                    txFrameWithResult(XB_SET_GUARD_TIME, registerValue);
+                }
+                else
+                {
+                    registers.writesAvoided++;
+                }
+
+                /* If needed, verify that the expected value matches the actual */
+                if (verify)
+                {
+                    verifyParameter(XB_SET_GUARD_TIME, registerValue);
+
+                    uint32_t tmp = 0;
+                    decodeHex(rxBuffer, XBEE_RX_BUFFER_SIZE, tmp);
+                    return (size_t)tmp;
+                }
+                else
+                {
+                    return guardTime_mS;
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            bool XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::isATMode()
+            {
+                /* The module leaves AT mode after atModeTimeout_mS without a valid command. Every command restarts that
+                 * timer, so the remaining lifetime can be tracked locally instead of probing the module. A small margin
+                 * keeps a command from racing the module's own expiry. */
+                return atModeRemaining_mS() > XB_AT_MODE_MARGIN_mS;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            size_t XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::atModeRemaining_mS()
+            {
+                if (!cmdModeActive)
+                {
+                    return 0;
+                }
+
+                size_t elapsed = currentTime_mS() - lastCmdMode_mS;
+                if (elapsed >= atModeTimeout_mS)
+                {
+                    cmdModeActive = false;
+                    return 0;
+                }
+
+                return atModeTimeout_mS - elapsed;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::refreshATMode()
+            {
+                lastCmdMode_mS = currentTime_mS();
+                cmdModeActive = true;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::txBatch(XBATBatch& batch, size_t timeout_mS)
+            {
+                batch.rewind();
+
+                if (apiMode != XB_API_DISABLED)
+                {
+                    for (size_t i = 0; i < batch.size(); i++)
+                    {
+                        const XBBatchEntry& entry = batch[i];
+                        char command[] = { entry.code[0], entry.code[1], 0 };
+                        uint8_t param[sizeof(entry.param)];
+                        size_t paramLen = entry.hasParam ? serializeParam(entry.param, param) : 0;
+
+                        /* The API response is rendered as AT text, so it demultiplexes the same way */
+                        XBStatus result = apiCommand(command, paramLen ? param : nullptr, paramLen, timeout_mS);
+                        if (result == XB_OK)
+                        {
+                            batch.parseResponse(rxBuffer, strlen(rxBuffer));
+                        }
+                        else
+                        {
+                            trackBatch(batch);
+                            return result;
+                        }
+                    }
+
+                    trackBatch(batch);
+                    return batch.result();
+                }
+
+                if (!isATMode() && (goToCommandMode() != XB_OK))
+                {
+                    return XB_FAILED_COMMAND_MODE;
+                }
+
+                size_t next = 0;
+                while (next < batch.size())
+                {
+                    size_t placed = 0;
+                    size_t bytes = batch.buildFrame(next, txBuffer, XBEE_TX_BUFFER_SIZE, placed);
+
+                    if (!bytes)
+                    {
+                        return XB_BUFFER_TOO_SMALL;
+                    }
+
+                    write(txBuffer, bytes);
+                    refreshATMode();
+                    next += placed;
+
+                    /* Wait until every command in this line has been answered */
+                    while (batch.responses() < next)
+                    {
+                        size_t bytesRead = 0;
+                        memset(rxBuffer, 0, XBEE_RX_BUFFER_SIZE);
+
+                        XBStatus result = readWithTimeout((uint8_t*)rxBuffer, XBEE_RX_BUFFER_SIZE, timeout_mS, &bytesRead);
+                        if (result != XB_OK)
+                        {
+                            trackBatch(batch);
+                            return result;
+                        }
+
+                        batch.parseResponse(rxBuffer, bytesRead);
+                    }
+                }
+
+                trackBatch(batch);
+                return batch.result();
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::trackResponse(const char* command, bool hasParam, uint32_t param)
+            {
+                if (hasParam)
+                {
+                    if (isRxBufferEqual(XB_DEFAULT_RESPONSE))
+                    {
+                        registers.updateFromWrite(command, param);
+                    }
+                }
+                else if (isRxBufferEqual(XB_DEFAULT_RESPONSE))
+                {
+                    registers.executed(command);
+                }
+                else if (registers.find(command))
+                {
+                    uint32_t value = 0;
+
+                    if (decodeHex(rxBuffer, XBEE_RX_BUFFER_SIZE, value))
+                    {
+                        registers.updateFromRead(command, value);
+                    }
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::trackBatch(const XBATBatch& batch)
+            {
+                for (size_t i = 0; i < batch.size(); i++)
+                {
+                    const XBBatchEntry& entry = batch[i];
+                    char command[] = { entry.code[0], entry.code[1], 0 };
+
+                    if (!entry.responded || (entry.status != XB_OK))
+                    {
+                        continue;
+                    }
+
+                    if (entry.hasParam)
+                    {
+                        registers.updateFromWrite(command, entry.param);
+                    }
+                    else if (entry.hasValue)
+                    {
+                        registers.updateFromRead(command, entry.value);
+                    }
+                    else
+                    {
+                        registers.executed(command);
+                    }
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::exitCommandMode()
+            {
+                if ((apiMode != XB_API_DISABLED) || !isATMode())
+                {
+                    cmdModeActive = false;
+                    return XB_OK;
+                }
+
+                XBStatus result = txFrameWithResult(XB_CMD_MODE_EXIT);
+
+                if ((result == XB_OK) && !isRxBufferEqual(XB_DEFAULT_RESPONSE))
+                {
+                    result = XB_FAILED_COMMAND;
+                }
+
+                /* Even on failure the module is no longer trusted to be in command mode */
+                cmdModeActive = false;
+                return result;
+            }
+
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::hardwareReset(size_t timeout_mS)
+            {
+                bootStats = XBBootStats();
+
+                if (!driveReset(true))
+                {
+                    return XB_NOT_SUPPORTED;
+                }
+
+                /* Held in reset the module is silent, so anything still queued belongs to its previous life */
+                platform::delayMilliseconds(XB_RESET_PULSE_mS);
+                flushInput();
+                driveReset(false);
+
+                size_t startTime = currentTime_mS();
+                XBStatus result = XB_NO_RESPONSE;
+
+                /* The module is back on its saved configuration */
+                registers.invalidate();
+                cmdModeActive = false;
+
+                if (apiMode != XB_API_DISABLED)
+                {
+                    /* It announces itself with a Modem Status once it's up, but any valid frame proves the same */
+                    if (readNextFrame(timeout_mS) == XB_OK)
+                    {
+                        bootStats.modemStatus = (apiDecoder.frameType() == XB_FRAME_MODEM_STATUS) &&
+                            (apiDecoder.frameLength() >= 2);
+                        bootStats.status = bootStats.modemStatus ? apiDecoder.frameData()[1] : 0;
+                        result = XB_OK;
+
+                        dispatchFrame();
+                    }
+                }
+                else
+                {
+                    /* Nothing is said in transparent mode. The line has been quiet since reset was released, so "+++"
+                     * goes out one guard time later and again until the module has finished booting and answers. */
+                    lastTx_mS = startTime;
+                    txActive = true;
+
+                    while (result != XB_OK)
+                    {
+                        size_t elapsed = currentTime_mS() - startTime;
+                        if ((elapsed + guardTimeout_mS) >= timeout_mS)
+                        {
+                            break;
+                        }
+
+                        size_t remaining = timeout_mS - elapsed - guardTimeout_mS;
+                        size_t probe_mS = guardTimeout_mS + XB_PROBE_MARGIN_mS;
+
+                        bootStats.probes++;
+                        result = enterCommandMode((probe_mS < remaining) ? probe_mS : remaining);
+                    }
+                }
+
+                bootStats.elapsed_mS = currentTime_mS() - startTime;
+
+                if (result != XB_OK)
+                {
+                    #ifdef DEBUG
+                    XB_LOG(ERROR, "XBEE: No answer %d mS after reset!\r\n", (int)bootStats.elapsed_mS);
+                    #endif
+
+                    return XB_NO_RESPONSE;
+                }
+
+                return XB_OK;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setResetLine(XBResetCallback line, void* context)
+            {
+                resetLine = line;
+                resetLineContext = context;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            bool XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::driveReset(bool asserted)
+            {
+                if (resetLine)
+                {
+                    resetLine(asserted, resetLineContext);
+                    return true;
+                }
+
+                #if !defined(XBEE_PLATFORM_POSIX)
+                if (reset)
+                {
+                    /* Active low */
+                    reset->write(asserted ? Chimera::GPIO::State::LOW : Chimera::GPIO::State::HIGH);
+                    return true;
+                }
+                #endif
+
+                return false;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::goToCommandMode()
+			{
+				return enterCommandMode(XB_ENTER_AT_TIMEOUT_mS);
+			}
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::enterCommandMode(size_t timeout_mS)
+			{
+				/* The sequence is only recognized after a full guard time of silence on the line. The extra
+				 * millisecond covers the resolution of the time base. */
+				size_t quiet_mS = currentTime_mS() - lastTx_mS;
+				size_t guard_mS = 0;
+				if (txActive && (quiet_mS <= guardTimeout_mS))
+				{
+					guard_mS = guardTimeout_mS - quiet_mS + 1;
+					platform::delayMilliseconds(guard_mS);
+				}
+
+				/* Stale bytes would otherwise be taken as a bad answer */
+				flushInput();
+				write(XB_ENTER_AT_MODE, strlen(XB_ENTER_AT_MODE));
+
+				/* The module only answers once the trailing guard time has passed, so it's ready for commands as soon
+				 * as the OK arrives. */
+				XBStatus result = readExpected(XB_DEFAULT_RESPONSE, timeout_mS);
+				statistics.recordCommandMode(result, guard_mS);
+
+				if (result == XB_OK)
+				{
+                    /* Keep track of the time at which we entered AT mode. This helps later with determining if 
+                     * we have timed out of AT mode.*/
+                    refreshATMode();
+				}
+				else if (result == XB_TIMEOUT)
+				{
+					result = XB_NO_RESPONSE;
+				}
+
+                #ifdef DEBUG
+                if (result != XB_OK)
+                {
+                    XB_LOG(ERROR, "XBEE: Failed to enter AT mode!\r\n");
+                }
+                #endif
+
+				return result;
+			}
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::readExpected(const char* expected, size_t timeout_mS)
+            {
+                size_t startTime = currentTime_mS();
+                size_t length = strlen(expected);
+                size_t pos = 0;
+                XBStatus result = XB_OK;
+                memset(rxBuffer, 0, XBEE_RX_BUFFER_SIZE);
+
+                while ((pos < length) && (result == XB_OK))
+                {
+                    uint8_t byte = 0;
+
+                    if (!IO::read(*serial, &byte, 1))
+                    {
+                        result = waitForData(startTime, timeout_mS);
+                        continue;
+                    }
+
+                    statistics.addBytesIn(1);
+
+                    if (pos < (XBEE_RX_BUFFER_SIZE - 1))
+                    {
+                        rxBuffer[pos] = (char)byte;
+                    }
+
+                    /* At the wrong baud rate the first byte is already garbage, so there's no point waiting longer */
+                    if (byte != (uint8_t)expected[pos])
+                    {
+                        result = XB_BAD_RESPONSE;
+                        break;
+                    }
+
+                    pos++;
+                }
+
+                recordLatency(startTime, result);
+                return result;
+            }
+
+			template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+			libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::readWithTimeout(uint8_t* data, size_t length, size_t timeout_mS, size_t* bytesRead)
+			{
+				size_t startTime = currentTime_mS();
+				XBStatus result = waitForData(startTime, timeout_mS);
+
+				if (result == XB_OK)
+				{
+					size_t count = IO::read(*serial, data, length);
+					statistics.addBytesIn(count);
+
+					if (bytesRead)
+					{
+						*bytesRead = count;
+					}
+				}
+
+				recordLatency(startTime, result);
+				return result;
+			}
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::readLineWithTimeout(char* line, size_t length, size_t timeout_mS)
+            {
+                if (!line || (length < 2))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                size_t startTime = currentTime_mS();
+                size_t pos = 0;
+                XBStatus result = XB_OK;
+                memset(line, 0, length);
+
+                while (result == XB_OK)
+                {
+                    /* One byte at a time so nothing past the delimiter is consumed */
+                    uint8_t byte = 0;
+
+                    if (!IO::read(*serial, &byte, 1))
+                    {
+                        result = waitForData(startTime, timeout_mS);
+                        continue;
+                    }
+
+                    statistics.addBytesIn(1);
+
+                    if (pos >= (length - 1))
+                    {
+                        result = XB_BUFFER_OVERRUN;
+                        break;
+                    }
+
+                    line[pos++] = (char)byte;
+
+                    if (byte == XB_DELIMITER[0])
+                    {
+                        break;
+                    }
+                }
+
+                recordLatency(startTime, result);
+                return result;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::waitForData(size_t startTime, size_t timeout_mS)
+            {
+				size_t recheckDelay_mS = 10;
+
+                while (!IO::available(*serial))
+                {
+                    size_t elapsed = currentTime_mS() - startTime;
+                    if (elapsed >= timeout_mS)
+                    {
+                        return XB_TIMEOUT;
+                    }
+
+                    #ifdef USING_FREERTOS
+                    if (rxMode == XB_RX_BLOCKING)
+                    {
+                        /* Sleep until the serial driver signals a completed reception. A give left over from an
+                         * earlier packet only causes one extra pass through the loop. */
+                        xSemaphoreTake(rxComplete, pdMS_TO_TICKS(timeout_mS - elapsed));
+                        continue;
+                    }
+                    #elif defined(XBEE_PLATFORM_POSIX)
+                    if (rxMode == XB_RX_BLOCKING)
+                    {
+                        /* The host transport sleeps in epoll until the tty is readable */
+                        IO::waitForData(*serial, timeout_mS - elapsed);
+                        continue;
+                    }
+                    #endif
+
+                    platform::delayMilliseconds(recheckDelay_mS);
+                }
+
+                return XB_OK;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::recordLatency(size_t startTime, XBStatus result)
+            {
+                size_t elapsed = currentTime_mS() - startTime;
+                rxLatency.last_mS = elapsed;
+
+                if (result == XB_OK)
+                {
+                    rxLatency.total_mS += elapsed;
+                    rxLatency.samples++;
+
+                    if ((rxLatency.samples == 1) || (elapsed < rxLatency.min_mS))
+                    {
+                        rxLatency.min_mS = elapsed;
+                    }
+
+                    if (elapsed > rxLatency.max_mS)
+                    {
+                        rxLatency.max_mS = elapsed;
+                    }
+                }
+                else if (result == XB_TIMEOUT)
+                {
+                    rxLatency.timeouts++;
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setRxMode(XBRxMode mode)
+            {
+                #if !defined(USING_FREERTOS) && !defined(XBEE_PLATFORM_POSIX)
+                if (mode == XB_RX_BLOCKING)
+                {
+                    /* There is nothing to block on without the RTOS semaphores or a host transport */
+                    return XB_INVALID_PARAM;
+                }
+                #endif
+
+                rxMode = mode;
+                return XB_OK;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::resetRxLatency()
+            {
+                rxLatency = XBLatency();
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::getDriverStats(XBDriverStats& stats)
+            {
+                statistics.snapshot(stats);
+
+                #if XB_ENABLE_STATISTICS
+                /* The serial backend counts overruns since it was opened */
+                stats.rxOverruns = serial->rxStats().overruns - overrunBase;
+                #endif
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::resetDriverStats()
+            {
+                statistics.reset();
+                overrunBase = serial->rxStats().overruns;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::onCompletion(const XBCompletion& completion, void* context)
+            {
+                XBEEProS2Driver* driver = static_cast<XBEEProS2Driver*>(context);
+
+                /* Filed under the request type, so local AT commands share an entry whichever path sent them */
+                XBFrameType type = XB_FRAME_TRANSMIT_REQUEST;
+                if (completion.type == XB_FRAME_AT_RESPONSE)
+                {
+                    type = XB_FRAME_AT_COMMAND;
+                }
+                else if (completion.type == XB_FRAME_REMOTE_AT_RESPONSE)
+                {
+                    type = XB_FRAME_REMOTE_AT_COMMAND;
+                }
+
+                driver->statistics.recordCommand(type, completion.command, completion.status, completion.elapsed_mS);
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            size_t XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::currentTime_mS()
+            {
+                return platform::millis();
+            }
+
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setAPIMode(XBAPIMode mode)
+            {
+                XBStatus result = XB_OK;
+
+                if (mode == apiMode)
+                {
+                    return result;
+                }
+
+                if (apiMode == XB_API_DISABLED)
+                {
+                    /* Write AP in command mode, then exit with ATCN which also applies the change */
+                    result = txFrameWithResult(XB_API_ENABLE, (uint8_t)mode);
+
+                    if ((result == XB_OK) && isRxBufferEqual(XB_DEFAULT_RESPONSE))
+                    {
+                        result = exitCommandMode();
+                    }
+                    else if (result == XB_OK)
+                    {
+                        result = XB_FAILED_COMMAND;
+                    }
+                }
+                else
+                {
+                    /* The response still arrives in the current framing, so only switch the decoder afterwards */
+                    uint8_t param = (uint8_t)mode;
+                    result = apiCommand(XB_API_ENABLE, &param, sizeof(param), XB_DEFAULT_TIMEOUT_mS);
+
+                    if (result == XB_OK)
+                    {
+                        result = apiCommand(XB_APPLY_CHANGES, nullptr, 0, XB_DEFAULT_TIMEOUT_mS);
+                    }
+                }
+
+                if (result == XB_OK)
+                {
+                    apiMode = mode;
+                    apiDecoder.setMode(mode);
+                }
+
+                #ifdef DEBUG
+                if (result != XB_OK)
+                {
+                    XB_LOG(ERROR, "XBEE: Failed to change API mode to [%d]\r\n", mode);
+                }
+                #endif
+
+                return result;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            uint8_t XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::nextFrameID()
+            {
+                return requests.reserveTransient();
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::apiCommand(const char* command, const uint8_t* param, size_t paramLen, size_t timeout_mS)
+            {
+                command = commandCode(command);
+                if (!command)
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                uint8_t frameID = nextFrameID();
+                if (!frameID)
+                {
+                    return XB_BUFFER_OVERRUN;
+                }
+
+                size_t startTime = currentTime_mS();
+                XBStatus result = writeATCommandFrame(frameID, command, param, paramLen);
+
+                if (result == XB_OK)
+                {
+                    result = readAPIFrame(XB_FRAME_AT_RESPONSE, frameID, timeout_mS);
+                }
+
+                /* AT Command Response: [type][frame id][cmd 0][cmd 1][status][data...] */
+                const uint8_t* frame = apiDecoder.frameData();
+                size_t dataLen = apiDecoder.frameLength() - 5;
+
+                if (result == XB_OK)
+                {
+                    result = atResponseStatus(frame[4]);
+                }
+
+                statistics.recordCommand(XB_FRAME_AT_COMMAND, command, result, currentTime_mS() - startTime);
+
+                if (result != XB_OK)
+                {
+                    return result;
+                }
+
+                /* Render the response the same way the module would in AT mode */
+                memset(rxBuffer, 0, XBEE_RX_BUFFER_SIZE);
+
+                if (dataLen == 0)
+                {
+                    memcpy(rxBuffer, XB_DEFAULT_RESPONSE, strlen(XB_DEFAULT_RESPONSE));
+                }
+                else
+                {
+                    static const char hex[] = "0123456789ABCDEF";
+                    size_t pos = 0;
+                    bool leading = true;
+
+                    for (size_t i = 0; i < dataLen; i++)
+                    {
+                        for (int shift = 4; shift >= 0; shift -= 4)
+                        {
+                            uint8_t nibble = (frame[5 + i] >> shift) & 0x0F;
+                            if (leading && (nibble == 0) && !((i == (dataLen - 1)) && (shift == 0)))
+                            {
+                                continue;
+                            }
+
+                            leading = false;
+                            if (pos >= (XBEE_RX_BUFFER_SIZE - 2))
+                            {
+                                return XB_BUFFER_OVERRUN;
+                            }
+
+                            rxBuffer[pos++] = hex[nibble];
+                        }
+                    }
+
+                    rxBuffer[pos] = XB_DELIMITER[0];
+                }
+
+                return XB_OK;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::writeAPIFrame(const uint8_t* header, size_t headerLen, const uint8_t* payload, size_t payloadLen)
+            {
+                if (apiMode == XB_API_ESCAPED)
+                {
+                    /* Escaping changes the bytes on the wire, so run the frame through a scratch buffer in pieces */
+                    uint8_t scratch[XB_SERIAL_GATHER_BUFFER_SIZE];
+                    size_t used = 0;
+                    size_t frameLength = headerLen + payloadLen;
+                    uint8_t checksum = apiChecksum(payload, payloadLen, (uint8_t)(XB_API_CHECKSUM_VALID - apiChecksum(header, headerLen)));
+
+                    if ((frameLength == 0) || (frameLength > 0xFFFF))
+                    {
+                        return XB_INVALID_PARAM;
+                    }
+
+                    const uint8_t length[] = { (uint8_t)(frameLength >> 8), (uint8_t)(frameLength & 0xFF) };
+                    const XBSpan spans[] = { { length, sizeof(length) }, { header, headerLen }, { payload, payloadLen }, { &checksum, 1 } };
+
+                    scratch[used++] = XB_API_START_DELIMITER;
+
+                    for (size_t i = 0; i < (sizeof(spans) / sizeof(spans[0])); i++)
+                    {
+                        for (size_t j = 0; j < spans[i].length; j++)
+                        {
+                            /* Worst case a byte expands to two, so flush with room to spare */
+                            if ((used + 2) > sizeof(scratch))
+                            {
+                                IO::write(*serial, scratch, used);
+                                statistics.addBytesOut(used);
+                                used = 0;
+                            }
+
+                            uint8_t byte = spans[i].data[j];
+                            if (apiNeedsEscape(byte))
+                            {
+                                scratch[used++] = XB_API_ESCAPE;
+                                byte ^= XB_API_ESCAPE_XOR;
+                            }
+
+                            scratch[used++] = byte;
+                        }
+                    }
+
+                    IO::write(*serial, scratch, used);
+                    statistics.addBytesOut(used);
+                    statistics.addFrameOut();
+                    return XB_OK;
+                }
+
+                XBAPIFrameParts parts;
+                if (!prepareAPIFrameParts(header, headerLen, payload, payloadLen, parts))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                const XBSpan spans[] = {
+                    { parts.prefix, sizeof(parts.prefix) },
+                    { header, headerLen },
+                    { payload, payloadLen },
+                    { &parts.checksum, 1 }
+                };
+
+                IO::writev(*serial, spans, sizeof(spans) / sizeof(spans[0]));
+                statistics.addBytesOut(sizeof(parts.prefix) + headerLen + payloadLen + 1);
+                statistics.addFrameOut();
+                return XB_OK;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::writeATCommandFrame(uint8_t frameID, const char* command, const uint8_t* param, size_t paramLen)
+            {
+                command = commandCode(command);
+
+                if (!command)
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                const uint8_t header[] = { XB_FRAME_AT_COMMAND, frameID, (uint8_t)command[0], (uint8_t)command[1] };
+                return writeAPIFrame(header, sizeof(header), param, paramLen);
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::readAPIFrame(XBFrameType type, uint8_t frameID, size_t timeout_mS)
+            {
+                XBStatus result = XB_TIMEOUT;
+                size_t checksumErrors = apiDecoder.checksumErrors;
+
+                while ((result = readNextFrame(timeout_mS)) == XB_OK)
+                {
+                    const uint8_t* frame = apiDecoder.frameData();
+                    if ((apiDecoder.frameType() == type) && (apiDecoder.frameLength() >= 5) && (frame[1] == frameID))
+                    {
+                        return XB_OK;
+                    }
+
+                    dispatchFrame();
+                }
+
+                /* A frame that failed its checksum while waiting was most likely the response, so say so */
+                if ((result == XB_TIMEOUT) && (apiDecoder.checksumErrors != checksumErrors))
+                {
+                    result = XB_BAD_CHECKSUM;
+                }
+
+                return result;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setFramePool(XBFramePool* pool)
+            {
+                /* The slot being decoded into belongs to the old pool */
+                apiDecoder.setBuffer(nullptr);
+                rxSlot.release();
+                framePool = pool;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::claimRxSlot()
+            {
+                if (!framePool || !apiDecoder.idle())
+                {
+                    return;
+                }
+
+                /* Nobody kept the last frame, so the slot can take the next one */
+                if (rxSlot.valid() && (rxSlot.references() == 1))
+                {
+                    return;
+                }
+
+                /* Without a free slot frames go to the decoder's own storage until one comes back */
+                rxSlot = framePool->allocate();
+                apiDecoder.setBuffer(rxSlot.valid() ? rxSlot.data() : nullptr);
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::readNextFrame(size_t timeout_mS)
+            {
+                /* The caller is done with the previous frame by now */
+                claimRxSlot();
+
+                while (true)
+                {
+                    while (apiChunkPos < apiChunkLen)
+                    {
+                        if (apiDecoder.push(apiChunk[apiChunkPos++]) == XB_DECODE_COMPLETE)
+                        {
+                            statistics.addFrameIn();
+                            return XB_OK;
+                        }
+                    }
+
+                    apiChunkPos = 0;
+                    apiChunkLen = 0;
+
+                    XBStatus result = readWithTimeout(apiChunk, sizeof(apiChunk), timeout_mS, &apiChunkLen);
+                    if (result != XB_OK)
+                    {
+                        return result;
+                    }
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::dispatchFrame()
+            {
+                const uint8_t* frame = apiDecoder.frameData();
+                size_t length = apiDecoder.frameLength();
+
+                /* ATND answers come first, since its request is kept pending to hold on to the frame ID */
+                if (updateNodes(frame, length) || requests.dispatch(frame, length, currentTime_mS()))
+                {
+                    return;
+                }
+
+                bool handled = false;
+                XBFrameRef pooled;
+                bool copied = false;
+
+                for (size_t i = 0; i < XB_MAX_FRAME_HANDLERS; i++)
+                {
+                    if (frameHandlers[i].type != frame[0])
+                    {
+                        continue;
+                    }
+
+                    if (frameHandlers[i].handler)
+                    {
+                        frameHandlers[i].handler(frame, length, frameHandlers[i].context);
+                        handled = true;
+                    }
+                    else if (frameHandlers[i].refHandler)
+                    {
+                        /* Shared by every pooled subscriber. A frame that arrived while the pool was empty gets one attempt
+                         * at a copy. */
+                        if (!copied && framePool)
+                        {
+                            if (rxSlot.valid() && (rxSlot.data() == frame))
+                            {
+                                rxSlot.setLength(length);
+                                pooled = rxSlot;
+                            }
+                            else
+                            {
+                                pooled = framePool->copy(frame, length);
+                            }
+
+                            copied = true;
+                        }
+
+                        if (pooled.valid())
+                        {
+                            frameHandlers[i].refHandler(pooled, frameHandlers[i].context);
+                        }
+
+                        handled = true;
+                    }
+                }
+
+                if (!handled && frameHandler)
+                {
+                    frameHandler(frame, length, frameHandlerContext);
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::addFrameHandler(XBFrameType type, XBFrameCallback handler, void* context)
+            {
+                if (!handler)
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                for (size_t i = 0; i < XB_MAX_FRAME_HANDLERS; i++)
+                {
+                    if (!frameHandlers[i].handler && !frameHandlers[i].refHandler)
+                    {
+                        frameHandlers[i].type = type;
+                        frameHandlers[i].handler = handler;
+                        frameHandlers[i].refHandler = nullptr;
+                        frameHandlers[i].context = context;
+                        return XB_OK;
+                    }
+                }
+
+                return XB_BUFFER_OVERRUN;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::removeFrameHandler(XBFrameCallback handler, void* context)
+            {
+                for (size_t i = 0; i < XB_MAX_FRAME_HANDLERS; i++)
+                {
+                    if (frameHandlers[i].handler && (frameHandlers[i].handler == handler) &&
+                        (frameHandlers[i].context == context))
+                    {
+                        frameHandlers[i].handler = nullptr;
+                    }
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::addFrameHandler(XBFrameType type, XBFrameRefCallback handler, void* context)
+            {
+                if (!handler)
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                if (!framePool)
+                {
+                    return XB_NOT_SUPPORTED;
+                }
+
+                for (size_t i = 0; i < XB_MAX_FRAME_HANDLERS; i++)
+                {
+                    if (!frameHandlers[i].handler && !frameHandlers[i].refHandler)
+                    {
+                        frameHandlers[i].type = type;
+                        frameHandlers[i].handler = nullptr;
+                        frameHandlers[i].refHandler = handler;
+                        frameHandlers[i].context = context;
+                        return XB_OK;
+                    }
+                }
+
+                return XB_BUFFER_OVERRUN;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::removeFrameHandler(XBFrameRefCallback handler, void* context)
+            {
+                for (size_t i = 0; i < XB_MAX_FRAME_HANDLERS; i++)
+                {
+                    if (frameHandlers[i].refHandler && (frameHandlers[i].refHandler == handler) &&
+                        (frameHandlers[i].context == context))
+                    {
+                        frameHandlers[i].refHandler = nullptr;
+                    }
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::sendFrame(const XBFrameRef& frame)
+            {
+                if (!frame.valid() || !frame.length())
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                if (apiMode == XB_API_DISABLED)
+                {
+                    return XB_NOT_SUPPORTED;
+                }
+
+                return writeAPIFrame(frame.data(), frame.length(), nullptr, 0);
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            bool XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::updateNodes(const uint8_t* frame, size_t length)
+            {
+                XBNodeInfo node;
+
+                switch (frame[0])
+                {
+                /* [type][frame id]['N']['D'][status][node record] */
+                case XB_FRAME_AT_RESPONSE:
+                    if (!discoveryFrameID || (length < 5) || (frame[1] != discoveryFrameID) || (frame[2] != 'N') ||
+                        (frame[3] != 'D'))
+                    {
+                        return false;
+                    }
+
+                    /* Some firmware ends the discovery with an empty answer */
+                    if ((frame[4] != XB_AT_STATUS_OK) || (length == 5))
+                    {
+                        discoveryStatus = atResponseStatus(frame[4]);
+                        discoveryDone = true;
+                    }
+                    else if (decodeNodeRecord(&frame[5], length - 5, node))
+                    {
+                        nodes.update(node, currentTime_mS());
+                        discoveryAnswers++;
+                    }
+                    return true;
+
+                /* [type][64-bit source][16-bit source][...] */
+                case XB_FRAME_RECEIVE_PACKET:
+                case XB_FRAME_EXPLICIT_RECEIVE:
+                case XB_FRAME_IO_SAMPLE:
+                case XB_FRAME_NODE_IDENTIFICATION:
+                case XB_FRAME_ROUTE_RECORD:
+                    if (length >= XB_RECEIVE_HEADER_SIZE)
+                    {
+                        uint64_t address64 = 0;
+                        for (size_t i = 0; i < 8; i++)
+                        {
+                            address64 = (address64 << 8) | frame[1 + i];
+                        }
+
+                        nodes.update(address64, (uint16_t)((frame[9] << 8) | frame[10]), currentTime_mS());
+                    }
+
+                    if (frame[0] == XB_FRAME_ROUTE_RECORD)
+                    {
+                        routes.record(frame, length, currentTime_mS());
+                    }
+
+                    /* A node announcing itself: [...][options][node record] */
+                    if ((frame[0] == XB_FRAME_NODE_IDENTIFICATION) && (length > XB_RECEIVE_HEADER_SIZE) &&
+                        decodeNodeRecord(&frame[XB_RECEIVE_HEADER_SIZE], length - XB_RECEIVE_HEADER_SIZE, node))
+                    {
+                        nodes.update(node, currentTime_mS());
+                    }
+                    return false;
+
+                default:
+                    return false;
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setSourceRouting(bool enabled)
+            {
+                sourceRouting = enabled;
+                routeInstalled = false;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::applySourceRoute(uint64_t address64, uint16_t& address16)
+            {
+                if (apiMode == XB_API_DISABLED)
+                {
+                    return;
+                }
+
+                const XBSourceRoute* route = routes.lookup(address64, currentTime_mS());
+                if (!route)
+                {
+                    return;
+                }
+
+                if (address16 == XB_ADDRESS_16_UNKNOWN)
+                {
+                    address16 = route->address16;
+                }
+
+                /* A neighbor is reached directly, and the module may still hold the route from last time. Routers keep
+                 * reporting the same path, so only a different one is sent again. */
+                if (!route->hops || (routeInstalled && (installedRoute.address64 == address64) &&
+                    (installedRoute.address16 == route->address16) && (installedRoute.hops == route->hops) &&
+                    !memcmp(installedRoute.path, route->path, 2 * (size_t)route->hops)))
+                {
+                    return;
+                }
+
+                uint8_t header[XB_SOURCE_ROUTE_HEADER_SIZE];
+                encodeSourceRouteHeader(address64, route->address16, route->hops, header);
+
+                /* Without the route the transmission still gets through, just after a route discovery */
+                routeInstalled = (writeAPIFrame(header, sizeof(header), route->path, 2 * (size_t)route->hops) == XB_OK);
+                installedRoute = *route;
+
+                if (routeInstalled)
+                {
+                    routes.installs++;
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::discoverNodes(size_t timeout_mS, size_t* found)
+            {
+                if (apiMode == XB_API_DISABLED)
+                {
+                    return XB_NOT_SUPPORTED;
+                }
+
+                if (!timeout_mS)
+                {
+                    /* Fall back to the module's default of 6 seconds */
+                    uint32_t nt = 0x3C;
+                    readRegister(XB_NODE_DISCOVER_TIMEOUT, nt);
+                    timeout_mS = nt * XB_NT_MULT;
+                }
+
+                /* The request is never completed by the answers, it only keeps the frame ID from being handed out */
+                XBRequestHandle handle;
+                XBStatus result = atCommandAsync(XB_NODE_DISCOVER, nullptr, 0, handle, nullptr, nullptr,
+                    timeout_mS + XB_DEFAULT_TIMEOUT_mS);
+
+                if (result != XB_OK)
+                {
+                    return result;
+                }
+
+                discoveryFrameID = handle.frameID;
+                discoveryAnswers = 0;
+                discoveryDone = false;
+                discoveryStatus = XB_OK;
+
+                size_t startTime = currentTime_mS();
+                while (!discoveryDone)
+                {
+                    size_t elapsed = currentTime_mS() - startTime;
+                    if (elapsed >= timeout_mS)
+                    {
+                        break;
+                    }
+
+                    processIncoming(timeout_mS - elapsed);
+                }
+
+                discoveryFrameID = 0;
+                requests.cancel(handle);
+
+                if (found)
+                {
+                    *found = discoveryAnswers;
+                }
+
+                return discoveryStatus;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::onNodeResolved(const XBCompletion& completion, void* context)
+            {
+                XBNodeQuery* query = static_cast<XBNodeQuery*>(context);
+                query->status = completion.status;
+
+                /* [type][frame id]['D']['N'][status][MY][SH][SL] */
+                if (completion.status == XB_OK)
+                {
+                    if (!completion.frame || (completion.dataLength < 10))
+                    {
+                        query->status = XB_BAD_RESPONSE;
+                        return;
+                    }
+
+                    const uint8_t* data = &completion.frame[5];
+                    query->node->address16 = (uint16_t)((data[0] << 8) | data[1]);
+
+                    for (size_t i = 0; i < 8; i++)
+                    {
+                        query->node->address64 = (query->node->address64 << 8) | data[2 + i];
+                    }
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::resolveNode(const char* identifier, XBNodeInfo& node, size_t timeout_mS)
+            {
+                size_t idLength = identifier ? strlen(identifier) : 0;
+                if (!idLength || (idLength >= XB_NODE_ID_SIZE))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                XBNodeInfo* known = nodes.findByIdentifier(identifier);
+                if (known && (known->address16 != XB_ADDRESS_16_UNKNOWN))
+                {
+                    node = *known;
+                    return XB_OK;
+                }
+
+                memset(&node, 0, sizeof(node));
+                node.parent16 = XB_ADDRESS_16_UNKNOWN;
+                node.deviceType = XB_DEVICE_UNKNOWN;
+                memcpy(node.identifier, identifier, idLength);
+
+                XBNodeQuery query = { &node, XB_TIMEOUT };
+                XBRequestHandle handle;
+                XBStatus result = atCommandAsync(XB_DESTINATION_NODE, reinterpret_cast<const uint8_t*>(identifier),
+                    idLength, handle, &XBEEProS2Driver::onNodeResolved, &query, timeout_mS);
+
+                if (result != XB_OK)
+                {
+                    return result;
+                }
+
+                /* The request times itself out, so this always ends */
+                while (requests.isPending(handle))
+                {
+                    processIncoming(timeout_mS);
+                }
+
+                if (query.status == XB_OK)
+                {
+                    XBNodeInfo* entry = nodes.update(node, currentTime_mS());
+                    node = *entry;
+                }
+
+                return query.status;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            void XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::setFrameHandler(XBFrameCallback handler, void* context)
+            {
+                frameHandler = handler;
+                frameHandlerContext = context;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::sendAsync(XBFrameType expected, uint8_t* header, size_t headerLen,
+                const uint8_t* payload, size_t payloadLen, XBRequestHandle& handle, XBCompletionCallback callback,
+                void* context, size_t timeout_mS)
+            {
+                if (apiMode == XB_API_DISABLED)
+                {
+                    return XB_NOT_SUPPORTED;
+                }
+
+                /* The command code sits behind the addressing fields of a Remote AT Command Request */
+                const char* command = nullptr;
+                if (header[0] == XB_FRAME_AT_COMMAND)
+                {
+                    command = (const char*)&header[2];
+                }
+                else if (header[0] == XB_FRAME_REMOTE_AT_COMMAND)
+                {
+                    command = (const char*)&header[13];
+                }
+
+                XBStatus result = requests.allocate(expected, command, currentTime_mS(), timeout_mS, callback, context,
+                    handle);
+                if (result != XB_OK)
+                {
+                    return result;
+                }
+
+                header[1] = handle.frameID;
+                result = writeAPIFrame(header, headerLen, payload, payloadLen);
+
+                if (result != XB_OK)
+                {
+                    requests.cancel(handle);
+                    handle = XBRequestHandle();
+                }
+
+                return result;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::atCommandAsync(const char* command, const uint8_t* param, size_t paramLen,
+                XBRequestHandle& handle, XBCompletionCallback callback, void* context, size_t timeout_mS)
+            {
+                command = commandCode(command);
+                if (!command)
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                uint8_t header[] = { XB_FRAME_AT_COMMAND, 0, (uint8_t)command[0], (uint8_t)command[1] };
+                XBStatus result = sendAsync(XB_FRAME_AT_RESPONSE, header, sizeof(header), param, paramLen, handle, callback,
+                    context, timeout_mS);
+
+                /* The write may be applied before anyone looks at its response, so stop trusting the cached value now */
+                if ((result == XB_OK) && paramLen)
+                {
+                    registers.writeIssued(command);
+                }
+
+                return result;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::remoteATCommandAsync(uint64_t address64, uint16_t address16, uint8_t options,
+                const char* command, const uint8_t* param, size_t paramLen, XBRequestHandle& handle,
+                XBCompletionCallback callback, void* context, size_t timeout_mS)
+            {
+                if ((address16 == XB_ADDRESS_16_UNKNOWN) && (address64 != XB_ADDRESS_64_BROADCAST))
+                {
+                    nodes.lookup16(address64, address16);
+                }
+
+                if (sourceRouting && (address64 != XB_ADDRESS_64_BROADCAST))
+                {
+                    applySourceRoute(address64, address16);
+                }
+
+                uint8_t header[XB_REMOTE_AT_HEADER_SIZE];
+                if (!encodeRemoteATHeader(0, address64, address16, options, command, header))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                return sendAsync(XB_FRAME_REMOTE_AT_RESPONSE, header, sizeof(header), param, paramLen, handle, callback,
+                    context, timeout_mS);
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::transmitAsync(uint64_t address64, uint16_t address16, const uint8_t* data,
+                size_t length, XBRequestHandle& handle, XBCompletionCallback callback, void* context, size_t timeout_mS)
+            {
+                if (!data || !length || (length > XB_TX_MAX_PAYLOAD))
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                /* A known network address saves the module an address discovery broadcast */
+                if ((address16 == XB_ADDRESS_16_UNKNOWN) && (address64 != XB_ADDRESS_64_BROADCAST))
+                {
+                    nodes.lookup16(address64, address16);
+                }
+
+                if (sourceRouting && (address64 != XB_ADDRESS_64_BROADCAST))
+                {
+                    applySourceRoute(address64, address16);
+                }
+
+                uint8_t header[XB_TRANSMIT_HEADER_SIZE];
+                encodeTransmitHeader(0, address64, address16, 0, 0, header);
+
+                return sendAsync(XB_FRAME_TRANSMIT_STATUS, header, sizeof(header), data, length, handle, callback, context,
+                    timeout_mS);
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::processIncoming(size_t timeout_mS)
+            {
+                size_t handled = 0;
+                XBStatus result = readNextFrame(timeout_mS);
+
+                while (result == XB_OK)
+                {
+                    dispatchFrame();
+                    handled++;
+
+                    /* Only keep going while more data is already here, the wait was for the first frame only */
+                    if ((apiChunkPos >= apiChunkLen) && !IO::available(*serial))
+                    {
+                        break;
+                    }
+
+                    result = readNextFrame(0);
+                }
+
+                requests.expire(currentTime_mS());
+                return handled ? XB_OK : XB_TIMEOUT;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            libxbee::XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::waitFor(const XBRequestHandle& handle, XBCompletion& completion, size_t timeout_mS)
+            {
+                size_t startTime = currentTime_mS();
+
+                while (true)
+                {
+                    if (requests.take(handle, completion))
+                    {
+                        return completion.status;
+                    }
+
+                    if (!requests.isPending(handle))
+                    {
+                        return XB_INVALID_PARAM;
+                    }
+
+                    size_t elapsed = currentTime_mS() - startTime;
+                    if (elapsed >= timeout_mS)
+                    {
+                        return XB_TIMEOUT;
+                    }
+
+                    processIncoming(timeout_mS - elapsed);
+                }
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            bool XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::updateTimingParams()
+            {
+                #ifdef DEBUG
+                XB_LOG(INFO, "XBEE: Initializing timing info\r\n");
+                #endif
+
+                /* Whatever isn't already cached is read in a single round trip */
+                uint32_t guardTime = 0;
+                uint32_t cmdTimeout = 0;
+                XBATBatch batch;
+
+                if (!registers.get(XB_SET_GUARD_TIME, guardTime))
+                {
+                    batch.add(XB_SET_GUARD_TIME);
+                }
+
+                if (!registers.get(XB_CMD_MODE_TIMEOUT, cmdTimeout))
+                {
+                    batch.add(XB_CMD_MODE_TIMEOUT);
+                }
+
+                if (batch.size() && (txBatch(batch) != XB_OK))
+                {
+                    return false;
+                }
+
+                const XBRegister* gt = registers.find(XB_SET_GUARD_TIME);
+                const XBRegister* ct = registers.find(XB_CMD_MODE_TIMEOUT);
+
+                if (!gt->valid || !ct->valid)
+                {
+                    return false;
+                }
+
+                guardTimeout_mS = (uint16_t)gt->value;
+                atModeTimeout_mS = ((uint16_t)ct->value) * XB_AT_TIMEOUT_MULT;
+                return true;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            XBStatus XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::verifyParameter(const char* command, const char* expected)
+            {
+                if (!command)
+                {
+                    return XB_INVALID_PARAM;
+                }
+
+                XBStatus result = txFrameWithResult(command);
+
+                if (result == XB_OK && (memcmp(rxBuffer, expected, strlen(expected)) != 0))
+                {
+                    result = XB_FAILED_COMPARE;
+
+                    #ifdef DEBUG
+                    XB_LOG(ERROR, "XBEE: Param compare [%s] doesn't match [%s]", rxBuffer, txBuffer);
+                    #endif
+                }
+
+                return result;
+            }
+
+            template<typename Driver>
+            XBBasicCommandSession<Driver>::XBBasicCommandSession(Driver& device, bool exitOnClose) : device(device), exitOnClose(exitOnClose)
+            {
+            }
+
+            template<typename Driver>
+            XBBasicCommandSession<Driver>::~XBBasicCommandSession()
+            {
+                close();
+            }
+
+            template<typename Driver>
+            libxbee::XBStatus XBBasicCommandSession<Driver>::open()
+            {
+                XBStatus result = XB_OK;
+
+                if ((device.getAPIMode() == XB_API_DISABLED) && !device.isATMode())
+                {
+                    result = device.goToCommandMode();
+                    if (result == XB_OK)
+                    {
+                        entries++;
+                    }
+                }
+
+                opened = (result == XB_OK);
+                return result;
+            }
+
+            template<typename Driver>
+            libxbee::XBStatus XBBasicCommandSession<Driver>::close()
+            {
+                XBStatus result = XB_OK;
+
+                if (opened && exitOnClose)
+                {
+                    result = device.exitCommandMode();
+                }
+
+                opened = false;
+                return result;
+            }
+
+            template<typename Driver>
+            size_t XBBasicCommandSession<Driver>::remaining_mS()
+            {
+                return (device.getAPIMode() == XB_API_DISABLED) ? device.atModeRemaining_mS() : 0;
+            }
+
+            template<typename Driver>
+            const char* XBBasicCommandSession<Driver>::response()
+            {
+                return device.rxBuffer;
+            }
+
+            template<typename Transport, size_t TxCapacity, size_t RxCapacity>
+            bool XBEEProS2Driver<Transport, TxCapacity, RxCapacity>::isRxBufferEqual(const char* data)
+            {
+                bool result = true;
+
+                if (memcmp(rxBuffer, data, strlen(data)) != 0)
+                {
+                    result = false;
+                }
+
+                return result; 
+            }
+
+            /* The default driver is instantiated once in xbpros2.cpp */
+            extern template class XBEEProS2Driver<>;
+            extern template class XBBasicCommandSession<XBEEProS2>;
 		}
         
     }
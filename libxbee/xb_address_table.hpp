@@ -0,0 +1,239 @@
+/**
+ * @file xb_address_table.hpp
+ */
+
+#ifndef XBEE_ADDRESS_TABLE_HPP
+#define XBEE_ADDRESS_TABLE_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+namespace libxbee
+{
+    /** Fixed Hash Table Keyed by 64-bit Address
+     *  Open addressing with linear probing and backward shift deletion, so lookups take constant time, removals leave
+     *  no tombstones behind and no memory is allocated. At most three quarters of the slots are used; beyond that the
+     *  entry that was updated longest ago makes room for the new one.
+     *
+     *  @tparam Entry   Stored type. Needs a uint64_t address64 key and a size_t lastSeen_mS used for eviction.
+     *  @tparam Size    Number of slots. Must be a power of two.
+     **/
+    template<typename Entry, size_t Size>
+    class XBAddressTable
+    {
+        static_assert((Size >= 4) && ((Size & (Size - 1)) == 0), "Address table size must be a power of two");
+
+    public:
+        typedef void (*Visitor)(const Entry& entry, void* context);
+
+        /** Looks up an entry
+         *  @return The entry, or nullptr if the address isn't in the table */
+        Entry* find(uint64_t address64)
+        {
+            size_t index = indexOf(address64);
+            return (index < Size) ? &slots[index].entry : nullptr;
+        }
+
+        /** Finds the address's entry, or adds a value-initialized one for it
+         *
+         *  @param[in]  address64   Key
+         *  @param[out] created     True if the entry is new
+         *  @return     Entry*      The entry
+         **/
+        Entry* insert(uint64_t address64, bool& created)
+        {
+            size_t index = indexOf(address64);
+            created = (index >= Size);
+
+            if (!created)
+            {
+                return &slots[index].entry;
+            }
+
+            if (count >= capacity())
+            {
+                evictOldest();
+            }
+
+            index = home(address64);
+            while (slots[index].used)
+            {
+                index = (index + 1) & (Size - 1);
+            }
+
+            slots[index].used = true;
+            slots[index].entry = Entry();
+            slots[index].entry.address64 = address64;
+            count++;
+
+            return &slots[index].entry;
+        }
+
+        /** Removes an entry
+         *  @return False if the address wasn't in the table */
+        bool remove(uint64_t address64)
+        {
+            size_t index = indexOf(address64);
+            if (index >= Size)
+            {
+                return false;
+            }
+
+            erase(index);
+            return true;
+        }
+
+        /** Removes every entry that hasn't been updated for maxAge_mS
+         *  @return Number of entries removed */
+        size_t expire(size_t now_mS, size_t maxAge_mS)
+        {
+            size_t removed = 0;
+            size_t index = 0;
+
+            while (index < Size)
+            {
+                /* erase() may shift an entry that wasn't visited yet into this slot, so look at it again */
+                if (slots[index].used && ((now_mS - slots[index].entry.lastSeen_mS) >= maxAge_mS))
+                {
+                    erase(index);
+                    removed++;
+                    continue;
+                }
+                index++;
+            }
+
+            return removed;
+        }
+
+        /** Calls the visitor for every entry, in no particular order. The table must not be changed meanwhile. */
+        void forEach(Visitor visitor, void* context = nullptr)
+        {
+            if (!visitor)
+            {
+                return;
+            }
+
+            for (const Slot& slot : slots)
+            {
+                if (slot.used)
+                {
+                    visitor(slot.entry, context);
+                }
+            }
+        }
+
+        /** Entry in a slot, or nullptr if the slot is empty. For walking the table by index up to Size. */
+        Entry* at(size_t index)
+        {
+            return ((index < Size) && slots[index].used) ? &slots[index].entry : nullptr;
+        }
+
+        /** Number of entries in the table */
+        size_t size() { return count; }
+
+        /** Most entries the table holds before it starts evicting */
+        static constexpr size_t capacity() { return (Size * 3) / 4; }
+
+        void clear()
+        {
+            for (Slot& slot : slots)
+            {
+                slot.used = false;
+            }
+            count = 0;
+        }
+
+        size_t evictions = 0;           /**< Entries dropped to make room for new ones */
+
+    private:
+        struct Slot
+        {
+            bool used = false;
+            Entry entry;
+        };
+
+        Slot slots[Size];
+        size_t count = 0;
+
+        /** Slot the address hashes to, before probing */
+        static size_t home(uint64_t address64)
+        {
+            /* Nodes from one vendor share the upper half of their address, so mix every bit into the index */
+            address64 ^= address64 >> 33;
+            address64 *= 0xFF51AFD7ED558CCDull;
+            address64 ^= address64 >> 33;
+            return (size_t)address64 & (Size - 1);
+        }
+
+        /** Index of the address's slot, or Size if it isn't in the table */
+        size_t indexOf(uint64_t address64)
+        {
+            size_t index = home(address64);
+
+            /* The table is never full, so an empty slot always ends the probe */
+            while (slots[index].used)
+            {
+                if (slots[index].entry.address64 == address64)
+                {
+                    return index;
+                }
+                index = (index + 1) & (Size - 1);
+            }
+
+            return Size;
+        }
+
+        void evictOldest()
+        {
+            size_t oldest = Size;
+
+            for (size_t i = 0; i < Size; i++)
+            {
+                if (slots[i].used && ((oldest == Size) ||
+                    ((long)(slots[i].entry.lastSeen_mS - slots[oldest].entry.lastSeen_mS) < 0)))
+                {
+                    oldest = i;
+                }
+            }
+
+            if (oldest < Size)
+            {
+                erase(oldest);
+                evictions++;
+            }
+        }
+
+        /** Empties a slot and pulls later members of its probe sequence back so lookups never hit a gap */
+        void erase(size_t index)
+        {
+            slots[index].used = false;
+            count--;
+
+            /* Backward shift: move any later entry whose home slot lies at or before the gap into it */
+            size_t gap = index;
+            size_t next = index;
+
+            while (true)
+            {
+                next = (next + 1) & (Size - 1);
+                if (!slots[next].used)
+                {
+                    return;
+                }
+
+                size_t want = home(slots[next].entry.address64);
+                bool movable = (gap <= next) ? ((want <= gap) || (want > next)) : ((want <= gap) && (want > next));
+
+                if (movable)
+                {
+                    slots[gap] = slots[next];
+                    slots[next].used = false;
+                    gap = next;
+                }
+            }
+        }
+    };
+}
+
+#endif /* !XBEE_ADDRESS_TABLE_HPP */
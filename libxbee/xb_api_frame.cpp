@@ -0,0 +1,335 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_api_frame.hpp>
+
+
+namespace libxbee
+{
+    /** Appends a byte to the output, escaping it if the mode requires. Returns false if out of space. */
+    static inline bool putByte(uint8_t byte, uint8_t* out, size_t outSize, size_t& pos, XBAPIMode mode)
+    {
+        if ((mode == XB_API_ESCAPED) && apiNeedsEscape(byte))
+        {
+            if ((pos + 2) > outSize)
+            {
+                return false;
+            }
+
+            out[pos++] = XB_API_ESCAPE;
+            out[pos++] = byte ^ XB_API_ESCAPE_XOR;
+        }
+        else
+        {
+            if ((pos + 1) > outSize)
+            {
+                return false;
+            }
+
+            out[pos++] = byte;
+        }
+
+        return true;
+    }
+
+    uint8_t apiChecksum(const uint8_t* data, size_t length, uint8_t seed)
+    {
+        uint8_t sum = seed;
+
+        for (size_t i = 0; i < length; i++)
+        {
+            sum += data[i];
+        }
+
+        return (uint8_t)(XB_API_CHECKSUM_VALID - sum);
+    }
+
+    size_t encodeAPIFrame(const uint8_t* header, size_t headerLen, const uint8_t* payload, size_t payloadLen,
+        uint8_t* out, size_t outSize, XBAPIMode mode)
+    {
+        size_t frameLength = headerLen + payloadLen;
+
+        if (!out || (frameLength == 0) || (frameLength > 0xFFFF) || (outSize < (frameLength + XB_API_FRAME_OVERHEAD)))
+        {
+            return 0;
+        }
+
+        size_t pos = 0;
+        uint8_t sum = 0;
+
+        /* The start delimiter is the only byte that is never escaped */
+        out[pos++] = XB_API_START_DELIMITER;
+
+        bool fits = putByte((uint8_t)(frameLength >> 8), out, outSize, pos, mode) &&
+                    putByte((uint8_t)(frameLength & 0xFF), out, outSize, pos, mode);
+
+        for (size_t i = 0; fits && (i < headerLen); i++)
+        {
+            sum += header[i];
+            fits = putByte(header[i], out, outSize, pos, mode);
+        }
+
+        for (size_t i = 0; fits && (i < payloadLen); i++)
+        {
+            sum += payload[i];
+            fits = putByte(payload[i], out, outSize, pos, mode);
+        }
+
+        if (!fits || !putByte((uint8_t)(XB_API_CHECKSUM_VALID - sum), out, outSize, pos, mode))
+        {
+            return 0;
+        }
+
+        return pos;
+    }
+
+    bool prepareAPIFrameParts(const uint8_t* header, size_t headerLen, const uint8_t* payload, size_t payloadLen,
+        XBAPIFrameParts& parts)
+    {
+        size_t frameLength = headerLen + payloadLen;
+
+        if ((frameLength == 0) || (frameLength > 0xFFFF))
+        {
+            return false;
+        }
+
+        parts.prefix[0] = XB_API_START_DELIMITER;
+        parts.prefix[1] = (uint8_t)(frameLength >> 8);
+        parts.prefix[2] = (uint8_t)(frameLength & 0xFF);
+
+        uint8_t sum = (uint8_t)(XB_API_CHECKSUM_VALID - apiChecksum(header, headerLen));
+        parts.checksum = apiChecksum(payload, payloadLen, sum);
+        return true;
+    }
+
+    size_t encodeATCommandFrame(uint8_t frameID, const char* command, const uint8_t* param, size_t paramLen,
+        uint8_t* out, size_t outSize, XBAPIMode mode)
+    {
+        /* API frames only carry the two character code, so drop the "AT" prefix if the text form was given */
+        command = commandCode(command);
+        if (!command)
+        {
+            return 0;
+        }
+
+        uint8_t header[] = { XB_FRAME_AT_COMMAND, frameID, (uint8_t)command[0], (uint8_t)command[1] };
+        return encodeAPIFrame(header, sizeof(header), param, paramLen, out, outSize, mode);
+    }
+
+    static void encodeAddresses(uint64_t address64, uint16_t address16, uint8_t* out)
+    {
+        for (size_t i = 0; i < 8; i++)
+        {
+            out[i] = (uint8_t)(address64 >> (8 * (7 - i)));
+        }
+
+        out[8] = (uint8_t)(address16 >> 8);
+        out[9] = (uint8_t)(address16 & 0xFF);
+    }
+
+    size_t encodeTransmitHeader(uint8_t frameID, uint64_t address64, uint16_t address16, uint8_t radius, uint8_t options,
+        uint8_t* out)
+    {
+        /* [type][frame id][64-bit dest][16-bit dest][radius][options] */
+        out[0] = XB_FRAME_TRANSMIT_REQUEST;
+        out[1] = frameID;
+        encodeAddresses(address64, address16, &out[2]);
+        out[12] = radius;
+        out[13] = options;
+
+        return XB_TRANSMIT_HEADER_SIZE;
+    }
+
+    size_t encodeRemoteATHeader(uint8_t frameID, uint64_t address64, uint16_t address16, uint8_t options,
+        const char* command, uint8_t* out)
+    {
+        command = commandCode(command);
+        if (!command)
+        {
+            return 0;
+        }
+
+        /* [type][frame id][64-bit dest][16-bit dest][options][cmd 0][cmd 1] */
+        out[0] = XB_FRAME_REMOTE_AT_COMMAND;
+        out[1] = frameID;
+        encodeAddresses(address64, address16, &out[2]);
+        out[12] = options;
+        out[13] = (uint8_t)command[0];
+        out[14] = (uint8_t)command[1];
+
+        return XB_REMOTE_AT_HEADER_SIZE;
+    }
+
+    size_t encodeSourceRouteHeader(uint64_t address64, uint16_t address16, uint8_t hops, uint8_t* out)
+    {
+        /* [type][frame id, always 0][64-bit dest][16-bit dest][route options][number of hops] */
+        out[0] = XB_FRAME_CREATE_SOURCE_ROUTE;
+        out[1] = 0;
+        encodeAddresses(address64, address16, &out[2]);
+        out[12] = 0;
+        out[13] = hops;
+
+        return XB_SOURCE_ROUTE_HEADER_SIZE;
+    }
+
+    XBStatus atResponseStatus(uint8_t status)
+    {
+        switch (status)
+        {
+        case XB_AT_STATUS_OK:
+            return XB_OK;
+
+        case XB_AT_STATUS_INVALID_COMMAND:
+        case XB_AT_STATUS_INVALID_PARAMETER:
+            return XB_INVALID_PARAM;
+
+        case XB_AT_STATUS_TX_FAILURE:
+            return XB_NO_RESPONSE;
+
+        case XB_AT_STATUS_ERROR:
+        default:
+            return XB_FAILED_COMMAND;
+        }
+    }
+
+    XBStatus transmitStatus(uint8_t status)
+    {
+        switch (status)
+        {
+        case XB_DELIVERY_SUCCESS:
+            return XB_OK;
+
+        case XB_DELIVERY_SELF_ADDRESSED:
+        case XB_DELIVERY_ADDRESS_NOT_FOUND:
+        case XB_DELIVERY_ROUTE_NOT_FOUND:
+        case XB_DELIVERY_INVALID_ENDPOINT:
+            return XB_INVALID_ADDRESS;
+
+        case XB_DELIVERY_PAYLOAD_TOO_LARGE:
+            return XB_BUFFER_OVERRUN;
+
+        default:
+            return XB_NO_RESPONSE;
+        }
+    }
+
+    XBAPIDecoder::XBAPIDecoder(XBAPIMode mode) : mode(mode)
+    {
+    }
+
+    void XBAPIDecoder::reset()
+    {
+        state = WAIT_DELIMITER;
+        escapeNext = false;
+        index = 0;
+        sum = 0;
+    }
+
+    void XBAPIDecoder::setBuffer(uint8_t* buffer)
+    {
+        if (state != WAIT_DELIMITER)
+        {
+            reset();
+        }
+
+        this->buffer = buffer ? buffer : frame;
+    }
+
+    void XBAPIDecoder::setMode(XBAPIMode mode)
+    {
+        this->mode = mode;
+        reset();
+    }
+
+    XBDecodeResult XBAPIDecoder::push(uint8_t byte)
+    {
+        /* A start delimiter can never appear inside an escaped frame, so it always marks a new frame. In
+         * unescaped mode 0x7E is legal data and only resynchronizes while waiting for a frame. */
+        if ((byte == XB_API_START_DELIMITER) && ((mode == XB_API_ESCAPED) || (state == WAIT_DELIMITER)))
+        {
+            reset();
+            state = LENGTH_MSB;
+            return XB_DECODE_IN_PROGRESS;
+        }
+
+        if (state == WAIT_DELIMITER)
+        {
+            return XB_DECODE_IN_PROGRESS;
+        }
+
+        if (mode == XB_API_ESCAPED)
+        {
+            if (byte == XB_API_ESCAPE)
+            {
+                escapeNext = true;
+                return XB_DECODE_IN_PROGRESS;
+            }
+
+            if (escapeNext)
+            {
+                byte ^= XB_API_ESCAPE_XOR;
+                escapeNext = false;
+            }
+        }
+
+        XBDecodeResult result = XB_DECODE_IN_PROGRESS;
+
+        switch (state)
+        {
+        case LENGTH_MSB:
+            length = (uint16_t)(byte << 8);
+            state = LENGTH_LSB;
+            break;
+
+        case LENGTH_LSB:
+            length |= byte;
+
+            if (length == 0)
+            {
+                state = WAIT_DELIMITER;
+            }
+            else if (length > XB_API_MAX_FRAME_DATA)
+            {
+                overruns++;
+                result = XB_DECODE_OVERRUN;
+                state = WAIT_DELIMITER;
+            }
+            else
+            {
+                state = FRAME_DATA;
+            }
+            break;
+
+        case FRAME_DATA:
+            buffer[index++] = byte;
+            sum += byte;
+
+            if (index == length)
+            {
+                state = CHECKSUM;
+            }
+            break;
+
+        case CHECKSUM:
+            state = WAIT_DELIMITER;
+
+            if ((uint8_t)(sum + byte) == XB_API_CHECKSUM_VALID)
+            {
+                result = XB_DECODE_COMPLETE;
+            }
+            else
+            {
+                checksumErrors++;
+                result = XB_DECODE_BAD_CHECKSUM;
+            }
+            break;
+
+        default:
+            state = WAIT_DELIMITER;
+            break;
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,289 @@
+/**
+ * @file xb_api_frame.hpp
+ */
+
+#ifndef XBEE_API_FRAME_HPP
+#define XBEE_API_FRAME_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+
+namespace libxbee
+{
+    #define XB_API_START_DELIMITER  ((uint8_t)0x7E)
+    #define XB_API_ESCAPE           ((uint8_t)0x7D)
+    #define XB_API_XON              ((uint8_t)0x11)
+    #define XB_API_XOFF             ((uint8_t)0x13)
+    #define XB_API_ESCAPE_XOR       ((uint8_t)0x20)
+
+    #define XB_API_HEADER_SIZE      ((size_t)3)     /**< Start delimiter + 16-bit length */
+    #define XB_API_FRAME_OVERHEAD   ((size_t)4)     /**< Header + checksum */
+    #define XB_API_CHECKSUM_VALID   ((uint8_t)0xFF) /**< Sum of frame data + checksum for a valid frame */
+
+    /** Largest frame data section (type + payload) the decoder will hold, and the size of every frame buffer */
+    #ifndef XB_API_MAX_FRAME_DATA
+    #define XB_API_MAX_FRAME_DATA   ((size_t)128)
+    #endif
+
+    #define XB_TRANSMIT_HEADER_SIZE     ((size_t)14)    /**< Transmit Request (0x10) frame data ahead of the payload */
+    #define XB_REMOTE_AT_HEADER_SIZE    ((size_t)15)    /**< Remote AT Command (0x17) frame data ahead of the parameter */
+    #define XB_RECEIVE_HEADER_SIZE      ((size_t)12)    /**< Receive Packet (0x90) frame data ahead of the payload */
+    #define XB_SOURCE_ROUTE_HEADER_SIZE ((size_t)14)    /**< Create Source Route (0x21) frame data ahead of the hops */
+    #define XB_ROUTE_RECORD_HEADER_SIZE ((size_t)13)    /**< Route Record Indicator (0xA1) frame data ahead of the hops */
+    #define XB_IO_SAMPLE_HEADER_SIZE    ((size_t)12)    /**< IO Data Sample RX Indicator (0x92) frame data ahead of the sample */
+
+    /** Largest RF payload a single Transmit Request carries. Matches ATNP on an XBee Pro S2 without encryption. */
+    #ifndef XB_TX_MAX_PAYLOAD
+    #define XB_TX_MAX_PAYLOAD 84
+    #endif
+
+    static_assert((XB_TRANSMIT_HEADER_SIZE + XB_TX_MAX_PAYLOAD) <= XB_API_MAX_FRAME_DATA,
+        "A full transmit payload doesn't fit in XB_API_MAX_FRAME_DATA, raise it along with XB_TX_MAX_PAYLOAD");
+
+    #define XB_ADDRESS_64_COORDINATOR   ((uint64_t)0x0000000000000000)
+    #define XB_ADDRESS_64_BROADCAST     ((uint64_t)0x000000000000FFFF)
+    #define XB_ADDRESS_16_UNKNOWN       ((uint16_t)0xFFFE)  /**< Lets the module resolve the network address itself */
+
+    #define XB_REMOTE_AT_APPLY_CHANGES  ((uint8_t)0x02) /**< Remote AT option: apply the change without a separate AC */
+
+    /** Frame type identifiers used in the frame data section of an API frame */
+    enum XBFrameType : uint8_t
+    {
+        XB_FRAME_AT_COMMAND             = 0x08,
+        XB_FRAME_AT_COMMAND_QUEUE       = 0x09,
+        XB_FRAME_TRANSMIT_REQUEST       = 0x10,
+        XB_FRAME_EXPLICIT_TRANSMIT      = 0x11,
+        XB_FRAME_REMOTE_AT_COMMAND      = 0x17,
+        XB_FRAME_CREATE_SOURCE_ROUTE    = 0x21,
+        XB_FRAME_AT_RESPONSE            = 0x88,
+        XB_FRAME_MODEM_STATUS           = 0x8A,
+        XB_FRAME_TRANSMIT_STATUS        = 0x8B,
+        XB_FRAME_RECEIVE_PACKET         = 0x90,
+        XB_FRAME_EXPLICIT_RECEIVE       = 0x91,
+        XB_FRAME_IO_SAMPLE              = 0x92,
+        XB_FRAME_NODE_IDENTIFICATION    = 0x95,
+        XB_FRAME_REMOTE_AT_RESPONSE     = 0x97,
+        XB_FRAME_ROUTE_RECORD           = 0xA1,
+    };
+
+    /** Status byte reported in AT Command Response (0x88) and Remote AT Command Response (0x97) frames */
+    enum XBATResponseStatus : uint8_t
+    {
+        XB_AT_STATUS_OK                 = 0,
+        XB_AT_STATUS_ERROR              = 1,
+        XB_AT_STATUS_INVALID_COMMAND    = 2,
+        XB_AT_STATUS_INVALID_PARAMETER  = 3,
+        XB_AT_STATUS_TX_FAILURE         = 4,
+    };
+
+    /** Delivery status byte reported in Transmit Status (0x8B) frames */
+    enum XBDeliveryStatus : uint8_t
+    {
+        XB_DELIVERY_SUCCESS             = 0x00,
+        XB_DELIVERY_MAC_ACK_FAILURE     = 0x01,
+        XB_DELIVERY_CCA_FAILURE         = 0x02,
+        XB_DELIVERY_INVALID_ENDPOINT    = 0x15,
+        XB_DELIVERY_NETWORK_ACK_FAILURE = 0x21,
+        XB_DELIVERY_NOT_JOINED          = 0x22,
+        XB_DELIVERY_SELF_ADDRESSED      = 0x23,
+        XB_DELIVERY_ADDRESS_NOT_FOUND   = 0x24,
+        XB_DELIVERY_ROUTE_NOT_FOUND     = 0x25,
+        XB_DELIVERY_PAYLOAD_TOO_LARGE   = 0x74,
+    };
+
+    enum XBDecodeResult : uint8_t
+    {
+        XB_DECODE_IN_PROGRESS,          /**< More bytes are needed before a frame is available */
+        XB_DECODE_COMPLETE,             /**< A full, checksum-verified frame is available */
+        XB_DECODE_BAD_CHECKSUM,         /**< A frame was received but failed the checksum */
+        XB_DECODE_OVERRUN,              /**< The frame length exceeded the decoder's capacity */
+    };
+
+    /** True if the byte has to be escaped in AP=2 mode */
+    inline bool apiNeedsEscape(uint8_t byte)
+    {
+        return (byte == XB_API_START_DELIMITER) || (byte == XB_API_ESCAPE) || (byte == XB_API_XON) || (byte == XB_API_XOFF);
+    }
+
+    /** Computes the API frame checksum over the frame data section
+     *
+     *  @param[in]  data        Frame data (frame type onwards)
+     *  @param[in]  length      Number of bytes in data
+     *  @param[in]  seed        Running sum from a previous call, used when the frame data is split across buffers
+     *  @return     uint8_t     0xFF minus the 8-bit sum of the frame data
+     **/
+    uint8_t apiChecksum(const uint8_t* data, size_t length, uint8_t seed = 0);
+
+    /** Encodes a complete API frame into a caller supplied buffer
+     *  The frame data is given in two parts so that a small header (frame type, frame ID, command) can be combined
+     *  with a larger payload without first copying them together. Either part may be empty.
+     *
+     *  @param[in]  header      Leading part of the frame data, starting with the frame type
+     *  @param[in]  headerLen   Number of bytes in header
+     *  @param[in]  payload     Trailing part of the frame data
+     *  @param[in]  payloadLen  Number of bytes in payload
+     *  @param[out] out         Buffer to write the encoded frame into
+     *  @param[in]  outSize     Size of out
+     *  @param[in]  mode        XB_API_ESCAPED applies AP=2 escaping to everything after the start delimiter
+     *  @return     size_t      Number of bytes written to out, or 0 if out is too small
+     **/
+    size_t encodeAPIFrame(const uint8_t* header, size_t headerLen, const uint8_t* payload, size_t payloadLen,
+        uint8_t* out, size_t outSize, XBAPIMode mode = XB_API_ENABLED);
+
+    /** Delimiter/length prefix and checksum of an unescaped frame, used to send a frame as spans without copying */
+    struct XBAPIFrameParts
+    {
+        uint8_t prefix[XB_API_HEADER_SIZE];
+        uint8_t checksum;
+    };
+
+    /** Computes the prefix and checksum for an unescaped (AP=1) frame. The frame is then sent as the spans prefix, header,
+     *  payload, checksum. Escaped frames have to be encoded with encodeAPIFrame instead.
+     *
+     *  @param[in]  header      Leading part of the frame data, starting with the frame type
+     *  @param[in]  headerLen   Number of bytes in header
+     *  @param[in]  payload     Trailing part of the frame data
+     *  @param[in]  payloadLen  Number of bytes in payload
+     *  @param[out] parts       Prefix and checksum
+     *  @return     bool        False if the frame data is empty or too long
+     **/
+    bool prepareAPIFrameParts(const uint8_t* header, size_t headerLen, const uint8_t* payload, size_t payloadLen,
+        XBAPIFrameParts& parts);
+
+    /** Encodes a local AT Command (0x08) frame
+     *
+     *  @param[in]  frameID     Non-zero to request an AT Command Response, zero to suppress it
+     *  @param[in]  command     Command string. Either the two character code ("CT") or the full text form ("ATCT")
+     *  @param[in]  param       Big-endian parameter bytes, or nullptr when reading a register
+     *  @param[in]  paramLen    Number of bytes in param
+     *  @param[out] out         Buffer to write the encoded frame into
+     *  @param[in]  outSize     Size of out
+     *  @param[in]  mode        API operating mode of the module
+     *  @return     size_t      Number of bytes written to out, or 0 on failure
+     **/
+    size_t encodeATCommandFrame(uint8_t frameID, const char* command, const uint8_t* param, size_t paramLen,
+        uint8_t* out, size_t outSize, XBAPIMode mode = XB_API_ENABLED);
+
+    /** Writes the frame data header of a Transmit Request (0x10). The RF payload follows it.
+     *
+     *  @param[in]  frameID     Non-zero to request a Transmit Status
+     *  @param[in]  address64   Destination, XB_ADDRESS_64_COORDINATOR or XB_ADDRESS_64_BROADCAST
+     *  @param[in]  address16   Destination network address, XB_ADDRESS_16_UNKNOWN if not known
+     *  @param[in]  radius      Maximum hops for a broadcast, 0 for the network maximum
+     *  @param[in]  options     Transmit options bit field
+     *  @param[out] out         At least XB_TRANSMIT_HEADER_SIZE bytes
+     *  @return     size_t      XB_TRANSMIT_HEADER_SIZE
+     **/
+    size_t encodeTransmitHeader(uint8_t frameID, uint64_t address64, uint16_t address16, uint8_t radius, uint8_t options,
+        uint8_t* out);
+
+    /** Writes the frame data header of a Remote AT Command (0x17). The parameter follows it.
+     *
+     *  @param[in]  frameID     Non-zero to request a Remote AT Command Response
+     *  @param[in]  address64   Target node
+     *  @param[in]  address16   Target network address, XB_ADDRESS_16_UNKNOWN if not known
+     *  @param[in]  options     Remote command options, e.g. XB_REMOTE_AT_APPLY_CHANGES
+     *  @param[in]  command     Either the two character code ("D6") or the full text form ("ATD6")
+     *  @param[out] out         At least XB_REMOTE_AT_HEADER_SIZE bytes
+     *  @return     size_t      XB_REMOTE_AT_HEADER_SIZE, or 0 if the command is invalid
+     **/
+    size_t encodeRemoteATHeader(uint8_t frameID, uint64_t address64, uint16_t address16, uint8_t options,
+        const char* command, uint8_t* out);
+
+    /** Writes the frame data header of a Create Source Route (0x21). The hops follow it as big-endian network
+     *  addresses, starting with the destination's neighbor. The module doesn't answer this frame.
+     *
+     *  @param[in]  address64   Destination the route leads to
+     *  @param[in]  address16   Destination network address
+     *  @param[in]  hops        Number of intermediate routers
+     *  @param[out] out         At least XB_SOURCE_ROUTE_HEADER_SIZE bytes
+     *  @return     size_t      XB_SOURCE_ROUTE_HEADER_SIZE
+     **/
+    size_t encodeSourceRouteHeader(uint64_t address64, uint16_t address16, uint8_t hops, uint8_t* out);
+
+    /** Converts the status byte of an AT Command Response into the library status codes */
+    XBStatus atResponseStatus(uint8_t status);
+
+    /** Converts the delivery status of a Transmit Status frame into the library status codes */
+    XBStatus transmitStatus(uint8_t status);
+
+    /** Streaming API Frame Decoder
+     *  Consumes the serial stream one byte at a time and reassembles API frames into a fixed internal buffer.
+     *  No memory is allocated and any amount of data may be pushed between calls, so the decoder can be fed
+     *  straight from an interrupt-filled buffer. Bytes outside of a frame are discarded, and a start delimiter
+     *  always resynchronizes the decoder so a corrupted frame never swallows the one following it.
+     **/
+    class XBAPIDecoder
+    {
+    public:
+        /** Pushes a single byte from the serial stream into the decoder
+         *
+         *  @param[in]  byte            The next received byte
+         *  @return     XBDecodeResult  XB_DECODE_COMPLETE once a valid frame is available
+         **/
+        XBDecodeResult push(uint8_t byte);
+
+        /** Drops any partially received frame and waits for the next start delimiter */
+        void reset();
+
+        /** Sets the API mode used to interpret escape sequences. Resets the decoder. */
+        void setMode(XBAPIMode mode);
+
+        /** Decodes the following frames into buffer instead of the decoder's own storage, e.g. a frame pool slot, so
+         *  they never have to be copied out. nullptr goes back to the own storage. A partially received frame is
+         *  dropped, so this is best called while idle().
+         *
+         *  @param[in]  buffer      At least XB_API_MAX_FRAME_DATA bytes, or nullptr
+         **/
+        void setBuffer(uint8_t* buffer);
+
+        /** True while no frame is partially received */
+        bool idle() const { return state == WAIT_DELIMITER; }
+
+        /** Frame type of the last completed frame */
+        XBFrameType frameType() const { return static_cast<XBFrameType>(buffer[0]); }
+
+        /** Frame data (frame type onwards) of the last completed frame */
+        const uint8_t* frameData() const { return buffer; }
+
+        /** Number of bytes in the frame data of the last completed frame */
+        size_t frameLength() const { return length; }
+
+        size_t checksumErrors = 0;      /**< Frames dropped because the checksum didn't match */
+        size_t overruns = 0;            /**< Frames dropped because they exceeded XB_API_MAX_FRAME_DATA */
+
+        XBAPIDecoder(XBAPIMode mode = XB_API_ENABLED);
+        ~XBAPIDecoder() = default;
+
+        /* buffer may point into the decoder itself */
+        XBAPIDecoder(const XBAPIDecoder&) = delete;
+        XBAPIDecoder& operator=(const XBAPIDecoder&) = delete;
+
+    private:
+        enum State : uint8_t
+        {
+            WAIT_DELIMITER,
+            LENGTH_MSB,
+            LENGTH_LSB,
+            FRAME_DATA,
+            CHECKSUM
+        };
+
+        XBAPIMode mode;
+        State state = WAIT_DELIMITER;
+        bool escapeNext = false;
+
+        uint16_t length = 0;
+        uint16_t index = 0;
+        uint8_t sum = 0;
+
+        uint8_t frame[XB_API_MAX_FRAME_DATA];
+        uint8_t* buffer = frame;        /**< Where frame data is decoded to, frame unless setBuffer() was used */
+    };
+}
+
+#endif /* !XBEE_API_FRAME_HPP */
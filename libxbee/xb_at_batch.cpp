@@ -0,0 +1,192 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_at_batch.hpp>
+#include <libxbee/include/xb_command.hpp>
+
+
+namespace libxbee
+{
+    XBStatus XBATBatch::add(const char* command)
+    {
+        /* Only the two character code is kept. The "AT" prefix is added once per line when the frame is built. */
+        command = commandCode(command);
+        if (!command)
+        {
+            return XB_INVALID_PARAM;
+        }
+
+        if (count >= XB_AT_BATCH_MAX_COMMANDS)
+        {
+            return XB_BUFFER_TOO_SMALL;
+        }
+
+        XBBatchEntry& entry = entries[count++];
+        memset(&entry, 0, sizeof(entry));
+        entry.code[0] = command[0];
+        entry.code[1] = command[1];
+        entry.status = XB_NO_RESPONSE;
+
+        return XB_OK;
+    }
+
+    XBStatus XBATBatch::add(const char* command, uint32_t param)
+    {
+        XBStatus result = add(command);
+
+        if (result == XB_OK)
+        {
+            entries[count - 1].hasParam = true;
+            entries[count - 1].param = param;
+        }
+
+        return result;
+    }
+
+    void XBATBatch::clear()
+    {
+        count = 0;
+        rewind();
+    }
+
+    void XBATBatch::rewind()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            entries[i].responded = false;
+            entries[i].status = XB_NO_RESPONSE;
+            entries[i].hasValue = false;
+            entries[i].value = 0;
+        }
+
+        responded = 0;
+        lineLength = 0;
+    }
+
+    size_t XBATBatch::buildFrame(size_t first, char* out, size_t outSize, size_t& placed)
+    {
+        placed = 0;
+
+        /* "AT" + "\r" always surround the chained commands */
+        if (!out || (first >= count) || (outSize < 3))
+        {
+            return 0;
+        }
+
+        size_t pos = 0;
+        out[pos++] = 'A';
+        out[pos++] = 'T';
+
+        for (size_t i = first; i < count; i++)
+        {
+            const XBBatchEntry& entry = entries[i];
+            char digits[XB_MAX_HEX_DIGITS];
+            size_t digitCount = entry.hasParam ? encodeHex(entry.param, digits) : 0;
+
+            /* [","] + code + [" " + digits], leaving room for the delimiter */
+            size_t length = (placed ? 1 : 0) + 2 + (entry.hasParam ? (1 + digitCount) : 0);
+            if ((pos + length + 1) > outSize)
+            {
+                break;
+            }
+
+            if (placed)
+            {
+                out[pos++] = ',';
+            }
+
+            out[pos++] = entry.code[0];
+            out[pos++] = entry.code[1];
+
+            if (entry.hasParam)
+            {
+                out[pos++] = ' ';
+                memcpy(out + pos, digits, digitCount);
+                pos += digitCount;
+            }
+
+            placed++;
+
+            /* Nothing may follow WR on the wire until the module has answered it */
+            if ((entry.code[0] == 'W') && (entry.code[1] == 'R'))
+            {
+                break;
+            }
+        }
+
+        if (!placed)
+        {
+            return 0;
+        }
+
+        out[pos++] = XB_DELIMITER[0];
+        return pos;
+    }
+
+    size_t XBATBatch::parseResponse(const char* data, size_t length)
+    {
+        size_t matched = 0;
+
+        for (size_t i = 0; i < length; i++)
+        {
+            char c = data[i];
+
+            if (c == XB_DELIMITER[0])
+            {
+                if (responded < count)
+                {
+                    assignLine();
+                    matched++;
+                }
+
+                lineLength = 0;
+            }
+            else if ((c != '\n') && (c != '\0') && (lineLength < (XB_AT_BATCH_MAX_LINE - 1)))
+            {
+                line[lineLength++] = c;
+            }
+        }
+
+        return matched;
+    }
+
+    void XBATBatch::assignLine()
+    {
+        XBBatchEntry& entry = entries[responded++];
+        line[lineLength] = 0;
+        entry.responded = true;
+
+        if (strcmp(line, "OK") == 0)
+        {
+            entry.status = XB_OK;
+        }
+        else if (strcmp(line, XB_ERROR_RESPONSE) == 0)
+        {
+            entry.status = XB_FAILED_COMMAND;
+        }
+        else if (entry.hasParam || (lineLength == 0))
+        {
+            /* A register write only ever answers "OK" or "ERROR" */
+            entry.status = XB_BAD_RESPONSE;
+        }
+        else
+        {
+            entry.hasValue = decodeHex(line, lineLength, entry.value);
+            entry.status = entry.hasValue ? XB_OK : XB_BAD_RESPONSE;
+        }
+    }
+
+    XBStatus XBATBatch::result()
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            if (entries[i].status != XB_OK)
+            {
+                return entries[i].status;
+            }
+        }
+
+        return XB_OK;
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ * @file xb_at_batch.hpp
+ */
+
+#ifndef XBEE_AT_BATCH_HPP
+#define XBEE_AT_BATCH_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+
+namespace libxbee
+{
+    #define XB_AT_BATCH_MAX_COMMANDS    16      /**< Maximum number of commands a single batch can hold */
+    #define XB_AT_BATCH_MAX_LINE        16      /**< Longest response line the demultiplexer will buffer */
+    #define XB_ERROR_RESPONSE           "ERROR"
+
+    struct XBBatchEntry
+    {
+        char code[2];                   /**< Two character command code, without the "AT" prefix */
+        bool hasParam;                  /**< True if the command writes a register */
+        uint32_t param;                 /**< Value to write when hasParam is set */
+
+        bool responded;                 /**< True once a response line has been matched to this entry */
+        XBStatus status;                /**< Result reported by the module for this command */
+        bool hasValue;                  /**< True if the module answered with a register value instead of "OK" */
+        uint32_t value;                 /**< Register value when hasValue is set */
+    };
+
+    /** AT Command Batch
+     *  Packs several AT commands into comma-chained lines ("ATCT 3C,GT 64,AC\r") so the module handles them in a single
+     *  round trip, then maps the response lines ("OK\r", "ERROR\r" or a hex value per command, in order) back onto each
+     *  command. Only commands with single line responses may be batched, which excludes ND, AS and similar.
+     **/
+    class XBATBatch
+    {
+    public:
+        /** Queues a register read or execution command
+         *
+         *  @param[in]  command     Command string, either "CT" or "ATCT"
+         *  @return     XBStatus    XB_OK if queued, XB_BUFFER_TOO_SMALL if the batch is full
+         **/
+        XBStatus add(const char* command);
+
+        /** Queues a register write
+         *
+         *  @param[in]  command     Command string, either "CT" or "ATCT"
+         *  @param[in]  param       Register value to write
+         *  @return     XBStatus    XB_OK if queued, XB_BUFFER_TOO_SMALL if the batch is full
+         **/
+        XBStatus add(const char* command, uint32_t param);
+
+        /** Queues ATAC so all preceding writes are applied */
+        XBStatus applyChanges() { return add(XB_APPLY_CHANGES); }
+
+        /** Queues ATWR so all preceding writes are persisted */
+        XBStatus writeChanges() { return add(XB_WRITE_MEMORY); }
+
+        /** Removes all commands and responses */
+        void clear();
+
+        /** Forgets any responses so the same commands can be sent again */
+        void rewind();
+
+        /** Builds one text line holding as many commands as fit, starting at the given entry
+         *
+         *  @param[in]  first       Index of the first command to place in the line
+         *  @param[out] out         Buffer for the line, including the trailing "\r"
+         *  @param[in]  outSize     Size of out
+         *  @param[out] placed      Number of commands placed in the line
+         *  @return     size_t      Number of bytes written, 0 if not even one command fits
+         **/
+        size_t buildFrame(size_t first, char* out, size_t outSize, size_t& placed);
+
+        /** Feeds response text from the module. Partial lines are kept until the rest arrives.
+         *
+         *  @param[in]  data        Received bytes
+         *  @param[in]  length      Number of bytes in data
+         *  @return     size_t      Number of response lines matched to commands by this call
+         **/
+        size_t parseResponse(const char* data, size_t length);
+
+        /** Returns the overall result: the first failing command's status, or XB_OK if all succeeded */
+        XBStatus result();
+
+        /** Number of commands queued */
+        size_t size() const { return count; }
+
+        /** Number of commands that have been matched with a response */
+        size_t responses() const { return responded; }
+
+        /** True once every command has a response */
+        bool complete() const { return responded == count; }
+
+        const XBBatchEntry& operator[](size_t index) const { return entries[index]; }
+
+        XBATBatch() = default;
+        ~XBATBatch() = default;
+
+    private:
+        XBBatchEntry entries[XB_AT_BATCH_MAX_COMMANDS];
+        size_t count = 0;
+        size_t responded = 0;
+
+        char line[XB_AT_BATCH_MAX_LINE];
+        size_t lineLength = 0;
+
+        void assignLine();
+    };
+}
+
+#endif /* !XBEE_AT_BATCH_HPP */
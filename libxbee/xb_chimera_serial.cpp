@@ -1,18 +1,26 @@
 #include <libxbee/include/xb_chimera_serial.hpp>
+#include <libxbee/include/xb_platform.hpp>
 
 
 namespace libxbee
 {
 	using namespace Chimera::Serial;
 
-	XbeeChimeraSerial::XbeeChimeraSerial(uint32_t channel)
+	XbeeChimeraSerial::XbeeChimeraSerial(uint32_t channel, XBChimeraRxPath rxPath) : rxPath(rxPath)
 	{
-		this->serial = new Chimera::Serial::SerialClass(channel);
+		this->serial = new (serialStorage) Chimera::Serial::SerialClass(channel);
+	}
+
+	XbeeChimeraSerial::~XbeeChimeraSerial()
+	{
+		releaseFlowControlPins();
+		serial->~SerialClass();
 	}
 
 	void XbeeChimeraSerial::initialize(uint32_t baud, Modes tx_mode, Modes rx_mode)
 	{
 		serial->begin(baud, tx_mode, rx_mode);
+		txMode = tx_mode;
 
 
 		initialized = true;
@@ -20,12 +28,243 @@ namespace libxbee
 
 	void XbeeChimeraSerial::write(uint8_t* data, size_t length)
 	{
+		if (flowControl)
+		{
+			writeGated(data, length);
+			return;
+		}
+
 		serial->write(data, length);
 	}
 
-	void XbeeChimeraSerial::read(uint8_t* data, size_t length)
+	void XbeeChimeraSerial::writev(const XBSpan* spans, size_t count)
+	{
+		if (txMode != Modes::BLOCKING)
+		{
+			XBEESerial::writev(spans, count);
+			return;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (spans[i].length)
+			{
+				write(const_cast<uint8_t*>(spans[i].data), spans[i].length);
+			}
+		}
+	}
+
+	size_t XbeeChimeraSerial::read(uint8_t* data, size_t length)
+	{
+		pullPackets();
+		size_t count = rxRing.pop(data, length);
+
+		updateRTS();
+		return count;
+	}
+
+	size_t XbeeChimeraSerial::available()
+	{
+		pullPackets();
+		return rxRing.size();
+	}
+
+	bool XbeeChimeraSerial::setBaud(uint32_t baud)
+	{
+		return serial->setBaud(baud) == Status::SERIAL_OK;
+	}
+
+	size_t XbeeChimeraSerial::onReceive(const uint8_t* data, size_t length)
+	{
+		/* A second producer would race pullPackets() over the ring's head */
+		assert(rxPath == XB_RX_ON_RECEIVE);
+		if (rxPath != XB_RX_ON_RECEIVE)
+		{
+			return 0;
+		}
+
+		/* RTS belongs to the consumer side, so the ISR never races read() over the pin and rtsAsserted */
+		return rxRing.push(data, length);
+	}
+
+	void XbeeChimeraSerial::flush()
+	{
+		pullPackets();
+		rxRing.flush();
+		updateRTS();
+	}
+
+	void XbeeChimeraSerial::attachFlowControlPins(Chimera::GPIO::Port ctsPort, uint8_t ctsPin, Chimera::GPIO::Port rtsPort,
+		uint8_t rtsPin)
+	{
+		/* Attaching again replaces the previous pins */
+		flowControl = false;
+		releaseFlowControlPins();
+
+		cts = new (ctsStorage) Chimera::GPIO::GPIOClass(ctsPort, ctsPin);
+		cts->mode(Chimera::GPIO::Mode::INPUT);
+
+		/* Start out ready to receive */
+		rts = new (rtsStorage) Chimera::GPIO::GPIOClass(rtsPort, rtsPin);
+		rts->mode(Chimera::GPIO::Mode::OUTPUT_PUSH_PULL);
+		rts->write(Chimera::GPIO::State::LOW);
+		rtsAsserted = true;
+	}
+
+	void XbeeChimeraSerial::releaseFlowControlPins()
+	{
+		/* Both were constructed in place, so only their destructors are run */
+		if (cts)
+		{
+			cts->~GPIOClass();
+			cts = nullptr;
+		}
+
+		if (rts)
+		{
+			rts->~GPIOClass();
+			rts = nullptr;
+		}
+	}
+
+	bool XbeeChimeraSerial::setFlowControl(bool enabled)
+	{
+		if (enabled && (!cts || !rts))
+		{
+			return false;
+		}
+
+		flowControl = enabled;
+
+		/* With flow control off the module ignores RTS, but leave it asserted in case DIO6 is still configured */
+		if (!enabled && rts)
+		{
+			rts->write(Chimera::GPIO::State::LOW);
+			rtsAsserted = true;
+		}
+
+		return true;
+	}
+
+	XBFlowStats XbeeChimeraSerial::flowStats()
+	{
+		return flow;
+	}
+
+	void XbeeChimeraSerial::resetFlowStats()
 	{
+		flow.throttleEvents = 0;
+		flow.throttled_mS = 0;
+		flow.rxHoldoffs = 0;
+		flow.txDropped = 0;
+	}
+
+	void XbeeChimeraSerial::writeGated(uint8_t* data, size_t length)
+	{
+		while (length)
+		{
+			size_t chunk = (length < XB_SERIAL_CTS_CHUNK_SIZE) ? length : XB_SERIAL_CTS_CHUNK_SIZE;
+
+			waitForClearToSend();
+			serial->write(data, chunk);
+
+			data += chunk;
+			length -= chunk;
+		}
+	}
+
+	void XbeeChimeraSerial::waitForClearToSend()
+	{
+		if (cts->read() == Chimera::GPIO::State::LOW)
+		{
+			return;
+		}
+
+		flow.throttleEvents++;
+		size_t start = platform::millis();
+
+		/* Give up eventually so a module that lost its DIO7 setting can't hang the writer for good */
+		while ((cts->read() != Chimera::GPIO::State::LOW) && ((platform::millis() - start) < XB_SERIAL_CTS_TIMEOUT_mS))
+		{
+			platform::delayMilliseconds(1);
+		}
+
+		flow.throttled_mS += platform::millis() - start;
+	}
+
+	void XbeeChimeraSerial::updateRTS()
+	{
+		if (!flowControl)
+		{
+			return;
+		}
+
+		bool room = (rxRing.capacity() - rxRing.size()) >= XB_SERIAL_RTS_HEADROOM;
+
+		if (room == rtsAsserted)
+		{
+			return;
+		}
+
+		if (!room)
+		{
+			flow.rxHoldoffs++;
+		}
+
+		rts->write(room ? Chimera::GPIO::State::LOW : Chimera::GPIO::State::HIGH);
+		rtsAsserted = room;
+	}
+
+	XBSerialRxStats XbeeChimeraSerial::rxStats()
+	{
+		XBSerialRxStats stats;
+		stats.highWaterMark = rxRing.highWaterMark();
+		stats.overruns = rxRing.overruns() + truncated;
+		stats.packetErrors = packetErrors;
+		return stats;
+	}
+
+	void XbeeChimeraSerial::resetRxStats()
+	{
+		rxRing.resetStats();
+		packetErrors = 0;
+		truncated = 0;
+	}
+
+	void XbeeChimeraSerial::pullPackets()
+	{
+		/* onReceive() is the only producer, but the consumer still owns RTS */
+		if (rxPath != XB_RX_PULL_PACKETS)
+		{
+			updateRTS();
+			return;
+		}
+
+		while (serial->availablePackets())
+		{
+			size_t packetSize = serial->nextPacketSize();
+			size_t length = (packetSize < sizeof(packetBuffer)) ? packetSize : sizeof(packetBuffer);
+
+			/* Leave a packet in the driver until the reader has made room for it, but only if it could ever fit.
+			 * One larger than the ring would otherwise block everything behind it for good. */
+			if (((rxRing.capacity() - rxRing.size()) < length) && (length <= rxRing.capacity()))
+			{
+				break;
+			}
+
+			/* A failed read may not have consumed the packet, so retrying here could spin. Try again next call. */
+			if (serial->readPacket(packetBuffer, sizeof(packetBuffer)) != Status::SERIAL_OK)
+			{
+				packetErrors++;
+				break;
+			}
+
+			/* Whatever doesn't fit the scratch buffer or the ring is lost, and counted as an overrun */
+			truncated += packetSize - length;
+			rxRing.push(packetBuffer, length);
+		}
 
+		updateRTS();
 	}
 
 	bool XbeeChimeraSerial::isInitialized()
@@ -4,15 +4,60 @@
 /* C/C++ Includes */
 #include <stdlib.h>
 #include <stdint.h>
+#include <assert.h>
+#include <new>
 
 /* LibXBEE Includes */
 #include <libxbee/include/xb_serial.hpp>
+#include <libxbee/include/xb_ring_buffer.hpp>
 
 /* Chimera Includes */
 #include <Chimera/serial.hpp>
+#include <Chimera/gpio.hpp>
+
+/** Size of the receive ring. Must be a power of two. */
+#ifndef XB_SERIAL_RX_RING_SIZE
+#define XB_SERIAL_RX_RING_SIZE 256
+#endif
+
+/** Size of the scratch buffer used to pull packets out of the Chimera driver */
+#ifndef XB_SERIAL_PACKET_BUFFER_SIZE
+#define XB_SERIAL_PACKET_BUFFER_SIZE 64
+#endif
+
+/** Most bytes sent per CTS check. The module deasserts CTS with 17 bytes of room left in its input buffer. */
+#ifndef XB_SERIAL_CTS_CHUNK_SIZE
+#define XB_SERIAL_CTS_CHUNK_SIZE 16
+#endif
+
+/** Longest a write waits on a deasserted CTS before sending anyway */
+#ifndef XB_SERIAL_CTS_TIMEOUT_mS
+#define XB_SERIAL_CTS_TIMEOUT_mS 100
+#endif
+
+/** RTS is deasserted once fewer than this many bytes are free in the receive ring */
+#ifndef XB_SERIAL_RTS_HEADROOM
+#define XB_SERIAL_RTS_HEADROOM 64
+#endif
 
 namespace libxbee
 {
+    /** Which side fills the receive ring of an XbeeChimeraSerial */
+    enum XBChimeraRxPath : uint8_t
+    {
+        XB_RX_PULL_PACKETS,     /**< read() and available() pull completed Chimera packets */
+        XB_RX_ON_RECEIVE,       /**< An RX interrupt or DMA callback pushes bytes through onReceive() */
+    };
+
+    /** Chimera Serial Backend
+     *  Received bytes are kept in a lock-free single producer/single consumer ring so the parser can consume them as they
+     *  arrive, independent of how the hardware chunked them. The ring has exactly one producer, fixed at construction:
+     *
+     *  1. XB_RX_ON_RECEIVE: an RX interrupt or DMA complete callback calls onReceive() with the new bytes, and read()
+     *     never touches the Chimera driver's packets.
+     *  2. XB_RX_PULL_PACKETS: without such a hook, read() and available() pull any completed Chimera packets into the
+     *     ring on demand. onReceive() must not be called.
+     **/
     class XbeeChimeraSerial : public XBEESerial 
     {
     public:
@@ -22,17 +67,93 @@ namespace libxbee
 			Chimera::Serial::Modes rx_mode = Chimera::Serial::Modes::BLOCKING);
 
         void write(uint8_t* data, size_t length) override;
-        void read(uint8_t* data, size_t length) override;
+
+		/** In blocking TX mode each span is handed straight to the driver, which sends them back to back without any
+		 *	copy. Interrupt and DMA transfers need one contiguous buffer, so those fall back to coalescing. */
+        void writev(const XBSpan* spans, size_t count) override;
+        size_t read(uint8_t* data, size_t length) override;
+        size_t available() override;
+        bool setBaud(uint32_t baud) override;
+
+		/** Producer entry point for interrupt/DMA driven reception. Safe to call from an ISR. RTS is only updated
+		 *	by the reading thread, so XB_SERIAL_RTS_HEADROOM has to cover what arrives between two reads. Only
+		 *	allowed on an instance built with XB_RX_ON_RECEIVE. Anywhere else it asserts, or drops the bytes when
+		 *	assertions are compiled out.
+		 *	@return Number of bytes that fit in the ring */
+		size_t onReceive(const uint8_t* data, size_t length);
+
+		/** Assigns the GPIOs wired to the module's CTS (DIO7) and RTS (DIO6) lines. Both are active low. The serial
+		 *	peripheral has no hardware flow control of its own, so CTS is polled between chunks of a write and RTS is
+		 *	driven from the fill level of the receive ring. */
+		void attachFlowControlPins(Chimera::GPIO::Port ctsPort, uint8_t ctsPin, Chimera::GPIO::Port rtsPort, uint8_t rtsPin);
+
+		/** Only succeeds in enabling flow control once the pins have been attached */
+		bool setFlowControl(bool enabled) override;
+
+		/** Snapshot of the flow control statistics */
+		XBFlowStats flowStats() override;
+		void resetFlowStats() override;
+
+		/** Discards all received data that hasn't been read yet */
+		void flush();
+
+		/** Snapshot of the receive statistics */
+		XBSerialRxStats rxStats() override;
+
+		/** Clears the receive statistics */
+		void resetRxStats();
+
+		/** Access to the underlying Chimera driver, e.g. for attaching thread triggers */
+		Chimera::Serial::SerialClass* driver() { return serial; }
 
 		bool isInitialized();
 
-		XbeeChimeraSerial(uint32_t channel);
-		~XbeeChimeraSerial() = default;
+		XbeeChimeraSerial(uint32_t channel, XBChimeraRxPath rxPath = XB_RX_PULL_PACKETS);
+		~XbeeChimeraSerial();
+
+		/* The driver and pins live inside the object */
+		XbeeChimeraSerial(const XbeeChimeraSerial&) = delete;
+		XbeeChimeraSerial& operator=(const XbeeChimeraSerial&) = delete;
     
 	private:
 		Chimera::Serial::SerialClass* serial;
 
+		/* Storage for the Chimera driver, built in place by the constructor */
+		alignas(Chimera::Serial::SerialClass) uint8_t serialStorage[sizeof(Chimera::Serial::SerialClass)];
+
 		bool initialized = false;
+		const XBChimeraRxPath rxPath;
+		Chimera::Serial::Modes txMode = Chimera::Serial::Modes::BLOCKING;
+
+		XBRingBuffer<XB_SERIAL_RX_RING_SIZE> rxRing;
+		uint8_t packetBuffer[XB_SERIAL_PACKET_BUFFER_SIZE];
+		size_t packetErrors = 0;
+		size_t truncated = 0;			/**< Bytes of packets larger than packetBuffer that were cut off */
+
+		Chimera::GPIO::GPIOClass* cts = nullptr;
+		Chimera::GPIO::GPIOClass* rts = nullptr;
+
+		/* Storage for the flow control pins, built in place so attaching them never touches the heap */
+		alignas(Chimera::GPIO::GPIOClass) uint8_t ctsStorage[sizeof(Chimera::GPIO::GPIOClass)];
+		alignas(Chimera::GPIO::GPIOClass) uint8_t rtsStorage[sizeof(Chimera::GPIO::GPIOClass)];
+		bool flowControl = false;
+		bool rtsAsserted = true;
+		XBFlowStats flow = { 0, 0, 0, 0 };
+
+		/** Moves completed Chimera packets into the ring */
+		void pullPackets();
+
+		/** Sends one buffer, pausing whenever the module deasserts CTS */
+		void writeGated(uint8_t* data, size_t length);
+
+		/** Blocks until CTS is asserted or XB_SERIAL_CTS_TIMEOUT_mS expires */
+		void waitForClearToSend();
+
+		/** Destroys the flow control pins, if attached */
+		void releaseFlowControlPins();
+
+		/** Deasserts RTS when the ring is about to fill up and reasserts it once there's room again. Consumer side only. */
+		void updateRTS();
 
 	};
 }
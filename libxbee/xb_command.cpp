@@ -0,0 +1,144 @@
+/* LibXBEE Includes */
+#include <libxbee/include/xb_command.hpp>
+
+
+namespace libxbee
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    static const uint32_t standardBaudRates[XB_STANDARD_BAUD_COUNT] = {
+        1200u, 2400u, 4800u, 9600u, 19200u, 38400u, 57600u, 115200u
+    };
+
+    size_t encodeHex(uint32_t value, char* out)
+    {
+        /* Find the most significant non-zero nibble, keeping at least one digit */
+        int shift = (XB_MAX_HEX_DIGITS - 1) * 4;
+        while ((shift > 0) && (((value >> shift) & 0x0F) == 0))
+        {
+            shift -= 4;
+        }
+
+        size_t length = 0;
+        for (; shift >= 0; shift -= 4)
+        {
+            out[length++] = hexDigits[(value >> shift) & 0x0F];
+        }
+
+        return length;
+    }
+
+    bool decodeHex(const char* text, size_t maxLength, uint32_t& value)
+    {
+        if (!text)
+        {
+            return false;
+        }
+
+        uint32_t result = 0;
+        size_t digits = 0;
+
+        for (size_t i = 0; i < maxLength; i++)
+        {
+            char c = text[i];
+            uint8_t nibble = 0;
+
+            if ((c == XB_DELIMITER[0]) || (c == 0))
+            {
+                break;
+            }
+            else if ((c >= '0') && (c <= '9'))
+            {
+                nibble = (uint8_t)(c - '0');
+            }
+            else if ((c >= 'A') && (c <= 'F'))
+            {
+                nibble = (uint8_t)(c - 'A' + 10);
+            }
+            else if ((c >= 'a') && (c <= 'f'))
+            {
+                nibble = (uint8_t)(c - 'a' + 10);
+            }
+            else
+            {
+                return false;
+            }
+
+            if (++digits > XB_MAX_HEX_DIGITS)
+            {
+                return false;
+            }
+
+            result = (result << 4) | nibble;
+        }
+
+        if (!digits)
+        {
+            return false;
+        }
+
+        value = result;
+        return true;
+    }
+
+    uint32_t baudToRegister(uint32_t baud)
+    {
+        for (uint32_t i = 0; i < XB_STANDARD_BAUD_COUNT; i++)
+        {
+            if (standardBaudRates[i] == baud)
+            {
+                return i;
+            }
+        }
+
+        return baud;
+    }
+
+    uint32_t registerToBaud(uint32_t value)
+    {
+        return (value < XB_STANDARD_BAUD_COUNT) ? standardBaudRates[value] : value;
+    }
+
+    size_t encodeATCommand(char* out, size_t outSize, char code0, char code1, bool hasParam, uint32_t param)
+    {
+        /* Worst case is "AT" + code + " " + 8 digits + "\r" */
+        char digits[XB_MAX_HEX_DIGITS];
+        size_t digitCount = hasParam ? encodeHex(param, digits) : 0;
+        size_t length = 5 + (hasParam ? (1 + digitCount) : 0);
+
+        if (!out || (outSize < length))
+        {
+            return 0;
+        }
+
+        size_t pos = 0;
+        out[pos++] = 'A';
+        out[pos++] = 'T';
+        out[pos++] = code0;
+        out[pos++] = code1;
+
+        if (hasParam)
+        {
+            out[pos++] = ' ';
+            for (size_t i = 0; i < digitCount; i++)
+            {
+                out[pos++] = digits[i];
+            }
+        }
+
+        out[pos++] = XB_DELIMITER[0];
+        return pos;
+    }
+
+    size_t encodeATCommand(char* out, size_t outSize, const char* command, bool hasParam, uint32_t param)
+    {
+        command = commandCode(command);
+
+        if (!command)
+        {
+            return 0;
+        }
+
+        return encodeATCommand(out, outSize, command[0], command[1], hasParam, param);
+    }
+}
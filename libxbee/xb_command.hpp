@@ -0,0 +1,127 @@
+/**
+ * @file xb_command.hpp
+ */
+
+#ifndef XBEE_COMMAND_HPP
+#define XBEE_COMMAND_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+
+namespace libxbee
+{
+    #define XB_MAX_HEX_DIGITS       8       /**< Hex digits needed for the largest (32-bit) register value */
+
+    /** Compile-time description of an AT command
+     *  Each command is its own type so that the code, parameter width and valid range are all available to the compiler.
+     *  Constant register values can then be range checked with XBCheckedParam before a single byte is sent.
+     *
+     *  @tparam C0, C1      Two character command code
+     *  @tparam Width       Parameter width in bytes, 0 for commands that take no parameter
+     *  @tparam Min, Max    Valid parameter range
+     *  @tparam ReadOnly    True if the register can only be read
+     **/
+    template<char C0, char C1, uint8_t Width, uint32_t Min = 0, uint32_t Max = 0, bool ReadOnly = false>
+    struct XBCommandDescriptor
+    {
+        static constexpr char code0 = C0;
+        static constexpr char code1 = C1;
+        static constexpr uint8_t width = Width;
+        static constexpr uint32_t min = Min;
+        static constexpr uint32_t max = Max;
+        static constexpr bool readOnly = ReadOnly;
+
+        static constexpr bool inRange(uint32_t value)
+        {
+            return (value >= Min) && (value <= Max);
+        }
+
+        static constexpr uint32_t clamp(uint32_t value)
+        {
+            return (value < Min) ? Min : ((value > Max) ? Max : value);
+        }
+    };
+
+    /** Rejects out of range constant register values at compile time
+     *
+     *  @code
+     *  xbee.writeRegister<commands::CommandModeTimeout, 0x64>();      // Fine
+     *  xbee.writeRegister<commands::CommandModeTimeout, 0x1000>();    // Doesn't compile
+     *  @endcode
+     **/
+    template<typename Command, uint32_t Value>
+    struct XBCheckedParam
+    {
+        static_assert(!Command::readOnly, "Register is read-only");
+        static_assert(Command::inRange(Value), "Register value is out of range for this command");
+
+        static constexpr uint32_t value = Value;
+    };
+
+    namespace commands
+    {
+        using FirmwareVersion       = XBCommandDescriptor<'V', 'R', 2, 0, 0xFFFF, true>;
+        using HardwareVersion       = XBCommandDescriptor<'H', 'V', 2, 0, 0xFFFF, true>;
+        using CommandModeTimeout    = XBCommandDescriptor<'C', 'T', 2, XB_MIN_AT_TIMEOUT_HEX, XB_MAX_AT_TIMEOUT_HEX>;
+        using GuardTime             = XBCommandDescriptor<'G', 'T', 2, XB_MIN_GUARD_TIME_HEX, XB_MAX_GUARD_TIME_HEX>;
+        using CommandSequenceChar   = XBCommandDescriptor<'C', 'C', 1, 0, 0xFF>;
+        using APIEnable             = XBCommandDescriptor<'A', 'P', 1, XB_API_DISABLED, XB_API_ESCAPED>;
+        using BaudRate              = XBCommandDescriptor<'B', 'D', 4, 0, XB_MAX_BAUD_HEX>;
+        using RTSConfig             = XBCommandDescriptor<'D', '6', 1, XB_DIO_DISABLED, XB_MAX_D6_HEX>;
+        using CTSConfig             = XBCommandDescriptor<'D', '7', 1, XB_DIO_DISABLED, XB_MAX_D7_HEX>;
+        using ExitCommandMode       = XBCommandDescriptor<'C', 'N', 0>;
+        using ApplyChanges          = XBCommandDescriptor<'A', 'C', 0>;
+        using WriteMemory           = XBCommandDescriptor<'W', 'R', 0>;
+    }
+
+    /** Writes a value as uppercase hex without leading zeros, the same way the module reports registers
+     *
+     *  @param[in]  value       Value to encode
+     *  @param[out] out         Buffer with room for at least XB_MAX_HEX_DIGITS characters. Not NUL terminated.
+     *  @return     size_t      Number of characters written (1-8)
+     **/
+    size_t encodeHex(uint32_t value, char* out);
+
+    /** Parses a hex register value as sent by the module. Parsing stops at "\r", NUL or maxLength.
+     *
+     *  @param[in]  text        Text to parse
+     *  @param[in]  maxLength   Maximum number of characters to look at
+     *  @param[out] value       Parsed value
+     *  @return     bool        True if at least one and at most XB_MAX_HEX_DIGITS hex digits were found and nothing else
+     **/
+    bool decodeHex(const char* text, size_t maxLength, uint32_t& value);
+
+    /** Converts a baud rate into the value written to ATBD: the index for a standard rate, otherwise the rate itself */
+    uint32_t baudToRegister(uint32_t baud);
+
+    /** Converts an ATBD register value back into a baud rate */
+    uint32_t registerToBaud(uint32_t value);
+
+    /** Assembles an AT mode command line ("ATCT 3C\r" or "ATCT\r") without any libc formatting
+     *
+     *  @param[out] out         Buffer for the command line. Not NUL terminated.
+     *  @param[in]  outSize     Size of out
+     *  @param[in]  code0       First character of the command code
+     *  @param[in]  code1       Second character of the command code
+     *  @param[in]  hasParam    True to append param
+     *  @param[in]  param       Register value to write
+     *  @return     size_t      Number of bytes written, 0 if out is too small
+     **/
+    size_t encodeATCommand(char* out, size_t outSize, char code0, char code1, bool hasParam, uint32_t param);
+
+    /** Same as above, taking the command as a string ("CT" or "ATCT"). Returns 0 for an invalid command. */
+    size_t encodeATCommand(char* out, size_t outSize, const char* command, bool hasParam, uint32_t param);
+
+    /** Same as above, taking the command from its descriptor */
+    template<typename Command>
+    size_t encodeATCommand(char* out, size_t outSize, bool hasParam, uint32_t param)
+    {
+        return encodeATCommand(out, outSize, Command::code0, Command::code1, hasParam, param);
+    }
+}
+
+#endif /* !XBEE_COMMAND_HPP */
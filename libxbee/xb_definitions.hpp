@@ -16,6 +16,8 @@
 #define XBEE_DEFINITIONS_HPP
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 namespace libxbee
 {   
@@ -111,6 +113,66 @@ namespace libxbee
 	 **/
 	#define XB_SET_CMD_SEQ_CHAR		"ATCC"
 
+	/** API Enable
+	 *	Set the API mode of the module. In API mode all configuration and data traffic is carried in binary
+	 *	frames, so no guard time or command mode sequence is needed to reach the command registers.
+	 *
+	 *	Parameter Range: 0-2 (see XBAPIMode)\n
+	 *	Parameter Default: 0 (only on AT firmware)
+	 **/
+	#define XB_API_ENABLE			"ATAP"
+
+	/** Interface Data Rate
+	 *	Set/Read the serial interface data rate. Values 0-7 select the standard rates from 1200 to 115200, anything
+	 *	larger is taken as the rate itself. The module keeps using the old rate until changes are applied, and the
+	 *	response to the AC/CN command still goes out at the old rate.
+	 *
+	 *	Parameter Range: 0-7 (standard), 0x80-0xE1000 (non-standard)\n
+	 *	Parameter Default: 3 (9600)
+	 **/
+	#define XB_BAUD_RATE			"ATBD"
+    #define XB_MAX_BAUD_HEX         (0xE1000)
+    #define XB_STANDARD_BAUD_COUNT  8           /**< BD values 0-7 index the standard rates */
+
+	/** DIO6 Configuration
+	 *	Set/Read the DIO6/RTS line function. With RTS flow control the module only sends serial data while the host
+	 *	holds RTS low.
+	 *
+	 *	Parameter Range: 0, 1, 3-5\n
+	 *	Parameter Default: 0 (disabled)
+	 **/
+	#define XB_RTS_FLOW_CONTROL		"ATD6"
+
+	/** DIO7 Configuration
+	 *	Set/Read the DIO7/CTS line function. With CTS flow control the module drives CTS high once its serial input
+	 *	buffer is nearly full, and the host has to stop sending until it goes low again.
+	 *
+	 *	Parameter Range: 0, 1, 3-7\n
+	 *	Parameter Default: 1 (CTS flow control)
+	 **/
+	#define XB_CTS_FLOW_CONTROL		"ATD7"
+    #define XB_DIO_DISABLED         (0x00)
+    #define XB_DIO_FLOW_CONTROL     (0x01)      /**< D6 = RTS, D7 = CTS */
+    #define XB_MAX_D6_HEX           (0x05)
+    #define XB_MAX_D7_HEX           (0x07)
+
+	/** Maximum RF Payload Bytes
+	 *	Read the largest payload a single transmission can carry. The value depends on the network settings, such as
+	 *	encryption and source routing, so it should be read once the module has joined.
+	 *
+	 *	Parameter Range: read-only
+	 **/
+	#define XB_MAX_PAYLOAD_BYTES	"ATNP"
+
+	/** Node Discover Timeout
+	 *	Set/Read how long node discovery (ATND) runs. Remote nodes answer after a random delay within this time.
+	 *
+	 *	Parameter Range: 0x20 - 0xFF (x 100 mS)
+	 *	Parameter Default: 0x3C (6 seconds)
+	 **/
+	#define XB_NODE_DISCOVER_TIMEOUT	"ATNT"
+    #define XB_NT_MULT              ((size_t)100)
+
 	/** @} */ /* !ATCommandOptions */
 
     /**
@@ -143,10 +205,22 @@ namespace libxbee
     
     #define XB_COMMISSION_BTN_PRESS "ATCB"
     
+    /** Node Discover
+     *  Discovers every node on the network within ATNT. In API mode each node answers with its own AT Command Response
+     *  carrying [MY][SH][SL][NI][parent][device type][status][profile][manufacturer]. An optional NI parameter limits
+     *  the search to that node.
+     **/
     #define XB_NODE_DISCOVER        "ATND"
     
+    /** Destination Node
+     *  Resolves a node identifier (NI parameter). In API mode the response carries the node's [MY][SH][SL].
+     **/
     #define XB_DESTINATION_NODE     "ATDN"
     
+    /** Force Sample
+     *  Reads every enabled digital and analog IO line at once. The response carries one sample set in the same layout
+     *  as an IO Data Sample RX Indicator (0x92) frame, see decodeIOSample().
+     **/
     #define XB_FORCE_SAMPLE         "ATIS"
     
     #define XB_ACTIVE_SCAN          "ATAS"
@@ -172,9 +246,19 @@ namespace libxbee
         XB_FAILED_COMPARE,
 
 
+        /* API mode */
+        XB_BAD_CHECKSUM,            /**< A frame failed its checksum */
+        XB_NOT_SUPPORTED,           /**< The operation isn't available in the current mode or configuration */
 		XB_NUMBER_OF_STATUS_KEYS
 	};
 
+    enum XBAPIMode : uint8_t
+    {
+        XB_API_DISABLED = 0,                    /**< Transparent/AT mode. Registers are reached through "+++" */
+        XB_API_ENABLED  = 1,                    /**< API mode without escaping */
+        XB_API_ESCAPED  = 2,                    /**< API mode with 0x7E, 0x7D, 0x11, 0x13 escaped */
+    };
+
     enum XBCommandCategory : uint8_t
     {
         GENERIC,
@@ -182,6 +266,24 @@ namespace libxbee
 
     };
 
+    /** Returns the two character code of a command, skipping the "AT" prefix if the text form ("ATCT") was given.
+     *  Returns nullptr if the command isn't a valid two character code. */
+    inline const char* commandCode(const char* command)
+    {
+        if (!command)
+        {
+            return nullptr;
+        }
+
+        size_t length = strlen(command);
+        if ((length == (XB_ATxx_COMMAND_LENGTH - 1)) && (command[0] == 'A') && (command[1] == 'T'))
+        {
+            return command + 2;
+        }
+
+        return (length == 2) ? command : nullptr;
+    }
+
 	struct Config
 	{
 		size_t commandModeTimeout;		        /**< How many milliseconds the Xbee should stay in AT mode before timing out */
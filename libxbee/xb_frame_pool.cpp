@@ -0,0 +1,195 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_frame_pool.hpp>
+
+
+namespace libxbee
+{
+    XBFramePool::XBFramePool()
+    {
+        for (size_t i = 0; i < XB_FRAME_POOL_SIZE; i++)
+        {
+            slots[i].references.store(0, std::memory_order_relaxed);
+            slots[i].next.store((uint16_t)(((i + 1) < XB_FRAME_POOL_SIZE) ? (i + 1) : EMPTY), std::memory_order_relaxed);
+            slots[i].length = 0;
+        }
+
+        freeHead.store(0, std::memory_order_release);
+    }
+
+    XBFrameRef XBFramePool::allocate()
+    {
+        uint32_t head = freeHead.load(std::memory_order_acquire);
+        uint32_t index = 0;
+        uint32_t replacement = 0;
+
+        do
+        {
+            index = head & 0xFFFF;
+            if (index == EMPTY)
+            {
+                exhausted.fetch_add(1, std::memory_order_relaxed);
+                return XBFrameRef();
+            }
+
+            /* next may already be stale if someone else took the slot, in which case the tag makes the swap fail */
+            replacement = ((head + 0x10000) & 0xFFFF0000) | slots[index].next.load(std::memory_order_relaxed);
+        } while (!freeHead.compare_exchange_weak(head, replacement, std::memory_order_acq_rel, std::memory_order_acquire));
+
+        Slot& slot = slots[index];
+        slot.references.store(1, std::memory_order_relaxed);
+        slot.length = 0;
+
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        size_t used = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+        size_t peak = highWater.load(std::memory_order_relaxed);
+
+        while ((used > peak) && !highWater.compare_exchange_weak(peak, used, std::memory_order_relaxed))
+        {
+        }
+
+        return XBFrameRef(this, (uint16_t)index);
+    }
+
+    XBFrameRef XBFramePool::copy(const uint8_t* frame, size_t length)
+    {
+        if (!frame || !length || (length > XB_API_MAX_FRAME_DATA))
+        {
+            return XBFrameRef();
+        }
+
+        XBFrameRef ref = allocate();
+
+        if (ref.valid())
+        {
+            memcpy(ref.data(), frame, length);
+            ref.setLength(length);
+        }
+
+        return ref;
+    }
+
+    void XBFramePool::retain(uint16_t index)
+    {
+        slots[index].references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void XBFramePool::release(uint16_t index)
+    {
+        /* acq_rel so everything done with the frame happens before whoever allocates the slot next */
+        if (slots[index].references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        {
+            return;
+        }
+
+        inUse.fetch_sub(1, std::memory_order_relaxed);
+
+        uint32_t head = freeHead.load(std::memory_order_relaxed);
+        uint32_t replacement = 0;
+
+        do
+        {
+            slots[index].next.store((uint16_t)(head & 0xFFFF), std::memory_order_relaxed);
+            replacement = ((head + 0x10000) & 0xFFFF0000) | index;
+        } while (!freeHead.compare_exchange_weak(head, replacement, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    XBFramePoolStats XBFramePool::getStats() const
+    {
+        XBFramePoolStats stats;
+        stats.allocations = allocations.load(std::memory_order_relaxed);
+        stats.exhausted = exhausted.load(std::memory_order_relaxed);
+        stats.inUse = inUse.load(std::memory_order_relaxed);
+        stats.highWater = highWater.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void XBFramePool::resetStats()
+    {
+        allocations.store(0, std::memory_order_relaxed);
+        exhausted.store(0, std::memory_order_relaxed);
+        highWater.store(inUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    uint8_t* XBFrameRef::data()
+    {
+        return pool ? pool->slots[index].data : nullptr;
+    }
+
+    const uint8_t* XBFrameRef::data() const
+    {
+        return pool ? pool->slots[index].data : nullptr;
+    }
+
+    size_t XBFrameRef::length() const
+    {
+        return pool ? pool->slots[index].length : 0;
+    }
+
+    void XBFrameRef::setLength(size_t length)
+    {
+        if (pool)
+        {
+            pool->slots[index].length = (length < XB_API_MAX_FRAME_DATA) ? length : XB_API_MAX_FRAME_DATA;
+        }
+    }
+
+    size_t XBFrameRef::references() const
+    {
+        return pool ? pool->slots[index].references.load(std::memory_order_relaxed) : 0;
+    }
+
+    void XBFrameRef::release()
+    {
+        if (pool)
+        {
+            pool->release(index);
+            pool = nullptr;
+            index = 0;
+        }
+    }
+
+    XBFrameRef::XBFrameRef(const XBFrameRef& other) : pool(other.pool), index(other.index)
+    {
+        if (pool)
+        {
+            pool->retain(index);
+        }
+    }
+
+    XBFrameRef::XBFrameRef(XBFrameRef&& other) : pool(other.pool), index(other.index)
+    {
+        other.pool = nullptr;
+        other.index = 0;
+    }
+
+    XBFrameRef& XBFrameRef::operator=(const XBFrameRef& other)
+    {
+        /* Retain first, so assigning a handle to itself can't free the frame */
+        if (other.pool)
+        {
+            other.pool->retain(other.index);
+        }
+
+        release();
+        pool = other.pool;
+        index = other.index;
+        return *this;
+    }
+
+    XBFrameRef& XBFrameRef::operator=(XBFrameRef&& other)
+    {
+        if (this != &other)
+        {
+            release();
+            pool = other.pool;
+            index = other.index;
+            other.pool = nullptr;
+            other.index = 0;
+        }
+
+        return *this;
+    }
+}
@@ -0,0 +1,156 @@
+/**
+ * @file xb_frame_pool.hpp
+ */
+
+#ifndef XBEE_FRAME_POOL_HPP
+#define XBEE_FRAME_POOL_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_api_frame.hpp>
+
+/** Frames an XBFramePool holds. Each slot takes XB_API_MAX_FRAME_DATA bytes plus a little bookkeeping. */
+#ifndef XB_FRAME_POOL_SIZE
+#if defined(XBEE_PLATFORM_POSIX)
+#define XB_FRAME_POOL_SIZE 256
+#else
+#define XB_FRAME_POOL_SIZE 8
+#endif
+#endif
+
+namespace libxbee
+{
+    static_assert((XB_FRAME_POOL_SIZE > 0) && (XB_FRAME_POOL_SIZE < 0xFFFF), "XB_FRAME_POOL_SIZE must fit a 16-bit index");
+
+    class XBFramePool;
+
+    /** Counters of an XBFramePool. Exhaustion is what to watch: every one is a frame that had to be dropped. */
+    struct XBFramePoolStats
+    {
+        size_t allocations;             /**< Slots handed out */
+        size_t exhausted;               /**< Allocations that failed because every slot was in use */
+        size_t inUse;                   /**< Slots currently referenced */
+        size_t highWater;               /**< Most slots in use at once */
+    };
+
+    /** Reference Counted Frame Handle
+     *  Shares one pooled frame between any number of owners, e.g. the receive dispatcher, a subscriber that queues it
+     *  for another thread and that thread itself. Copying the handle adds a reference, destroying or release()ing it
+     *  drops one, and the slot goes back to the pool with the last. An empty handle (valid() false) is what a failed
+     *  allocation returns.
+     *
+     *  Handles can be passed between threads, but a single handle object must not be used by two threads at once.
+     *  The frame data holds the frame type onwards, the same as XBAPIDecoder::frameData().
+     **/
+    class XBFrameRef
+    {
+    public:
+        bool valid() const { return pool != nullptr; }
+        explicit operator bool() const { return valid(); }
+
+        uint8_t* data();
+        const uint8_t* data() const;
+
+        size_t length() const;
+
+        /** Sets the number of valid bytes, clamped to capacity() */
+        void setLength(size_t length);
+
+        XBFrameType type() const { return static_cast<XBFrameType>(data()[0]); }
+
+        static constexpr size_t capacity() { return XB_API_MAX_FRAME_DATA; }
+
+        /** Number of handles sharing the frame, 0 for an empty handle */
+        size_t references() const;
+
+        /** Drops this handle's reference and leaves it empty */
+        void release();
+
+        XBFrameRef() = default;
+        XBFrameRef(const XBFrameRef& other);
+        XBFrameRef(XBFrameRef&& other);
+        XBFrameRef& operator=(const XBFrameRef& other);
+        XBFrameRef& operator=(XBFrameRef&& other);
+        ~XBFrameRef() { release(); }
+
+    private:
+        friend class XBFramePool;
+
+        XBFramePool* pool = nullptr;
+        uint16_t index = 0;
+
+        XBFrameRef(XBFramePool* pool, uint16_t index) : pool(pool), index(index) {}
+    };
+
+    /** Receives a pooled frame. Copy the handle to keep the frame past the call. */
+    typedef void (*XBFrameRefCallback)(const XBFrameRef& frame, void* context);
+
+    /** Fixed-Slot Frame Pool
+     *  Storage for frames that have to outlive the buffer they arrived in, without touching the heap. Every slot holds
+     *  one frame of up to XB_API_MAX_FRAME_DATA bytes, so allocation can't fragment and takes constant time.
+     *
+     *  Free slots form a lock-free stack. Its head carries a tag that changes on every update, so a slot that was
+     *  popped and pushed back between another thread's read and compare-and-swap can't corrupt the list. Allocation
+     *  and release are therefore safe from any thread, and from interrupt context on targets with native atomics.
+     *  When the pool is empty allocation fails straight away and is counted, rather than blocking.
+     **/
+    class XBFramePool
+    {
+    public:
+        /** Takes a free slot
+         *  @return Handle holding the only reference, or an empty handle if the pool is exhausted */
+        XBFrameRef allocate();
+
+        /** Takes a free slot and copies a frame into it
+         *  @return Handle to the copy, or an empty handle if the pool is exhausted or the frame is longer than a slot */
+        XBFrameRef copy(const uint8_t* frame, size_t length);
+
+        /** Number of free slots. Only a snapshot while other threads are allocating. */
+        size_t available() const { return XB_FRAME_POOL_SIZE - inUse.load(std::memory_order_relaxed); }
+
+        static constexpr size_t capacity() { return XB_FRAME_POOL_SIZE; }
+
+        XBFramePoolStats getStats() const;
+
+        /** Clears the counters. The in use count is kept, since it describes the slots rather than past events. */
+        void resetStats();
+
+        XBFramePool();
+        ~XBFramePool() = default;
+
+        XBFramePool(const XBFramePool&) = delete;
+        XBFramePool& operator=(const XBFramePool&) = delete;
+
+    private:
+        friend class XBFrameRef;
+
+        static const uint32_t EMPTY = 0xFFFF;     /**< Index that ends the free list */
+
+        struct Slot
+        {
+            std::atomic<uint32_t> references;
+            std::atomic<uint16_t> next;         /**< Next free slot while this one is on the free list */
+            size_t length;
+            uint8_t data[XB_API_MAX_FRAME_DATA];
+        };
+
+        Slot slots[XB_FRAME_POOL_SIZE];
+
+        /** Free list head: the slot index in the low 16 bits, the ABA tag in the high 16 */
+        std::atomic<uint32_t> freeHead;
+
+        std::atomic<size_t> inUse{ 0 };
+        std::atomic<size_t> allocations{ 0 };
+        std::atomic<size_t> exhausted{ 0 };
+        std::atomic<size_t> highWater{ 0 };
+
+        void retain(uint16_t index);
+        void release(uint16_t index);
+    };
+}
+
+#endif /* !XBEE_FRAME_POOL_HPP */
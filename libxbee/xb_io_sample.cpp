@@ -0,0 +1,78 @@
+/* LibXBEE Includes */
+#include <libxbee/include/xb_io_sample.hpp>
+
+
+namespace libxbee
+{
+    bool decodeIOSample(const uint8_t* data, size_t length, XBIOSample& sample)
+    {
+        /* [sample sets][digital mask:16][analog mask] */
+        if (!data || (length < 4) || (data[0] == 0))
+        {
+            return false;
+        }
+
+        sample.digitalMask = (uint16_t)((data[1] << 8) | data[2]);
+        sample.analogMask = data[3];
+        sample.digital = 0;
+
+        size_t pos = 4;
+
+        /* The digital samples are only there if at least one line is enabled */
+        if (sample.digitalMask)
+        {
+            if ((pos + 2) > length)
+            {
+                return false;
+            }
+
+            sample.digital = (uint16_t)(((data[pos] << 8) | data[pos + 1]) & sample.digitalMask);
+            pos += 2;
+        }
+
+        /* Then one reading per analog mask bit, lowest first. Bit 7 is the supply voltage. */
+        for (size_t channel = 0; channel < XB_IO_ANALOG_CHANNELS; channel++)
+        {
+            uint8_t bit = (channel == XB_IO_SUPPLY_VOLTAGE) ? (uint8_t)0x80 : (uint8_t)(1u << channel);
+
+            if (!(sample.analogMask & bit))
+            {
+                sample.analog[channel] = XB_IO_SAMPLE_ABSENT;
+                continue;
+            }
+
+            if ((pos + 2) > length)
+            {
+                return false;
+            }
+
+            sample.analog[channel] = (uint16_t)((data[pos] << 8) | data[pos + 1]);
+            pos += 2;
+        }
+
+        return true;
+    }
+
+    bool decodeIOSampleFrame(const uint8_t* frame, size_t length, XBIOSample& sample)
+    {
+        /* [0x92][64-bit source][16-bit source][options][sample set...] */
+        if (!frame || (length <= XB_IO_SAMPLE_HEADER_SIZE) || (frame[0] != XB_FRAME_IO_SAMPLE))
+        {
+            return false;
+        }
+
+        if (!decodeIOSample(&frame[XB_IO_SAMPLE_HEADER_SIZE], length - XB_IO_SAMPLE_HEADER_SIZE, sample))
+        {
+            return false;
+        }
+
+        sample.address64 = 0;
+        for (size_t i = 0; i < 8; i++)
+        {
+            sample.address64 = (sample.address64 << 8) | frame[1 + i];
+        }
+
+        sample.address16 = (uint16_t)((frame[9] << 8) | frame[10]);
+        return true;
+    }
+}
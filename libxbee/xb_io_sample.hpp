@@ -0,0 +1,220 @@
+/**
+ * @file xb_io_sample.hpp
+ */
+
+#ifndef XBEE_IO_SAMPLE_HPP
+#define XBEE_IO_SAMPLE_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_api_frame.hpp>
+#include <libxbee/include/xb_platform.hpp>
+
+/** Samples an XBIOSampleBuffer holds by default, a power of two */
+#ifndef XB_IO_SAMPLE_BUFFER_SIZE
+#if defined(XBEE_PLATFORM_POSIX)
+#define XB_IO_SAMPLE_BUFFER_SIZE 4096
+#else
+#define XB_IO_SAMPLE_BUFFER_SIZE 64
+#endif
+#endif
+
+/** Alignment of every column, enough for the widest vector loads the consumer is expected to use */
+#ifndef XB_IO_SAMPLE_ALIGNMENT
+#define XB_IO_SAMPLE_ALIGNMENT 32
+#endif
+
+#define XB_IO_ANALOG_CHANNELS   5                   /**< AD0-AD3 plus the supply voltage */
+#define XB_IO_SUPPLY_VOLTAGE    4                   /**< Analog column of the supply voltage, analog mask bit 7 */
+#define XB_IO_SAMPLE_ABSENT     ((uint16_t)0xFFFF)  /**< Analog value of a channel the sample didn't include. ADC
+                                                         readings are 10 bits, so this never collides with one. */
+
+namespace libxbee
+{
+    /** One decoded IO sample set */
+    struct XBIOSample
+    {
+        uint64_t address64;                         /**< Sampling node, 0 if decoded from a local ATIS response */
+        uint16_t address16;
+        uint16_t digitalMask;                       /**< DIO lines enabled, bit n for DIOn */
+        uint8_t analogMask;                         /**< Analog inputs enabled, bits 0-3 for AD0-AD3, bit 7 for supply */
+        uint16_t digital;                           /**< DIO line states, valid where digitalMask is set */
+        uint16_t analog[XB_IO_ANALOG_CHANNELS];     /**< ADC readings, XB_IO_SAMPLE_ABSENT where not enabled */
+    };
+
+    /** Decodes an IO sample set: [sample sets][digital mask:16][analog mask][digital samples:16][analog samples:16...]
+     *  This is the data of an ATIS response and everything from offset XB_IO_SAMPLE_HEADER_SIZE of a 0x92 frame. The
+     *  address fields of the sample are left alone.
+     *  @return False if the data is truncated or holds no sample set */
+    bool decodeIOSample(const uint8_t* data, size_t length, XBIOSample& sample);
+
+    /** Decodes an IO Data Sample RX Indicator (0x92) frame, including its source addresses
+     *  @return False if the frame is malformed */
+    bool decodeIOSampleFrame(const uint8_t* frame, size_t length, XBIOSample& sample);
+
+    /** Contiguous run of samples in an XBIOSampleBuffer: slots first to first + count - 1 of every column */
+    struct XBIOSampleSpan
+    {
+        size_t first;
+        size_t count;
+    };
+
+    /** Columnar IO Sample Ring
+     *  Stores decoded samples as a struct of arrays: one aligned column per field and analog channel, so filters and
+     *  aggregates run as straight loops over plain uint16_t arrays that the compiler can vectorize, instead of walking
+     *  an array of structs. Channels a sample didn't include hold XB_IO_SAMPLE_ABSENT, which keeps every column dense.
+     *
+     *  One context (typically the receive dispatcher, through onFrame()) pushes samples while another reads them. As
+     *  with XBRingBuffer the indices are free running and each is written by one side only, so no locks are needed.
+     *  Samples that don't fit are dropped and counted rather than overwriting unread ones.
+     *
+     *  The consumer asks for the longest contiguous run of unread samples with peek(), processes that slice of the
+     *  columns and hands it back with consume():
+     *
+     *      XBIOSampleSpan span = buffer.peek();
+     *      const uint16_t* ad0 = buffer.analog(0) + span.first;
+     *      for (size_t i = 0; i < span.count; i++) { sum += ad0[i]; }
+     *      buffer.consume(span.count);
+     *
+     *  @tparam Capacity    Samples held. Must be a power of two.
+     **/
+    template<size_t Capacity = XB_IO_SAMPLE_BUFFER_SIZE>
+    class XBIOSampleBuffer
+    {
+        static_assert((Capacity != 0) && ((Capacity & (Capacity - 1)) == 0), "Sample buffer capacity must be a power of two");
+
+    public:
+        /** Producer side: appends a sample
+         *  @return False if the buffer is full and the sample was dropped */
+        bool push(const XBIOSample& sample, uint32_t timestamp_mS)
+        {
+            size_t head = this->head.load(std::memory_order_relaxed);
+            size_t tail = this->tail.load(std::memory_order_acquire);
+            size_t used = head - tail;
+
+            if (used >= Capacity)
+            {
+                dropped++;
+                return false;
+            }
+
+            size_t slot = head & (Capacity - 1);
+            timestampColumn[slot] = timestamp_mS;
+            sourceColumn[slot] = sample.address64;
+            digitalColumn[slot] = sample.digital;
+            digitalMaskColumn[slot] = sample.digitalMask;
+            analogMaskColumn[slot] = sample.analogMask;
+
+            for (size_t channel = 0; channel < XB_IO_ANALOG_CHANNELS; channel++)
+            {
+                analogColumns[channel][slot] = sample.analog[channel];
+            }
+
+            this->head.store(head + 1, std::memory_order_release);
+            samples++;
+
+            if ((used + 1) > highWater)
+            {
+                highWater = used + 1;
+            }
+
+            return true;
+        }
+
+        /** Producer side: decodes an IO Data Sample RX Indicator (0x92) frame straight into the columns
+         *  @return False if the frame was malformed or the buffer is full */
+        bool pushFrame(const uint8_t* frame, size_t length)
+        {
+            XBIOSample sample;
+
+            if (!decodeIOSampleFrame(frame, length, sample))
+            {
+                rejected++;
+                return false;
+            }
+
+            return push(sample, (uint32_t)platform::millis());
+        }
+
+        /** Frame handler for XBEEProS2::addFrameHandler(XB_FRAME_IO_SAMPLE, ...), with the buffer as context */
+        static void onFrame(const uint8_t* frame, size_t length, void* context)
+        {
+            static_cast<XBIOSampleBuffer*>(context)->pushFrame(frame, length);
+        }
+
+        /** Consumer side: longest run of unread samples that is contiguous in every column. When the unread samples
+         *  wrap around the end of the columns, a second peek() after consume() returns the rest. */
+        XBIOSampleSpan peek() const
+        {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            size_t head = this->head.load(std::memory_order_acquire);
+            size_t first = tail & (Capacity - 1);
+            size_t count = head - tail;
+
+            if ((first + count) > Capacity)
+            {
+                count = Capacity - first;
+            }
+
+            return { first, count };
+        }
+
+        /** Consumer side: releases the oldest count samples */
+        void consume(size_t count)
+        {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            size_t used = this->head.load(std::memory_order_acquire) - tail;
+            this->tail.store(tail + ((count < used) ? count : used), std::memory_order_release);
+        }
+
+        /** Number of unread samples */
+        size_t available() const
+        {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed);
+        }
+
+        static constexpr size_t capacity() { return Capacity; }
+
+        /** Columns, indexed by the slots of an XBIOSampleSpan */
+        const uint32_t* timestamps() const { return timestampColumn; }
+        const uint64_t* sources() const { return sourceColumn; }
+        const uint16_t* digital() const { return digitalColumn; }
+        const uint16_t* digitalMasks() const { return digitalMaskColumn; }
+        const uint8_t* analogMasks() const { return analogMaskColumn; }
+
+        /** Column of one analog channel: 0-3 for AD0-AD3, XB_IO_SUPPLY_VOLTAGE for the supply voltage. Every one is
+         *  aligned as long as Capacity is at least XB_IO_SAMPLE_ALIGNMENT / 2. */
+        const uint16_t* analog(size_t channel) const
+        {
+            return (channel < XB_IO_ANALOG_CHANNELS) ? analogColumns[channel] : nullptr;
+        }
+
+        /** Consumer side: drops every unread sample */
+        void clear()
+        {
+            tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+        size_t samples = 0;             /**< Samples stored */
+        size_t dropped = 0;             /**< Samples lost because the buffer was full */
+        size_t rejected = 0;            /**< Frames that didn't decode */
+        size_t highWater = 0;           /**< Most unread samples held at once */
+
+    private:
+        alignas(XB_IO_SAMPLE_ALIGNMENT) uint16_t analogColumns[XB_IO_ANALOG_CHANNELS][Capacity];
+        alignas(XB_IO_SAMPLE_ALIGNMENT) uint16_t digitalColumn[Capacity];
+        alignas(XB_IO_SAMPLE_ALIGNMENT) uint16_t digitalMaskColumn[Capacity];
+        alignas(XB_IO_SAMPLE_ALIGNMENT) uint8_t analogMaskColumn[Capacity];
+        alignas(XB_IO_SAMPLE_ALIGNMENT) uint32_t timestampColumn[Capacity];
+        alignas(XB_IO_SAMPLE_ALIGNMENT) uint64_t sourceColumn[Capacity];
+
+        std::atomic<size_t> head{ 0 };
+        std::atomic<size_t> tail{ 0 };
+    };
+}
+
+#endif /* !XBEE_IO_SAMPLE_HPP */
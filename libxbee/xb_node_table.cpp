@@ -0,0 +1,130 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_node_table.hpp>
+
+
+namespace libxbee
+{
+    bool decodeNodeRecord(const uint8_t* data, size_t length, XBNodeInfo& node)
+    {
+        /* Addresses plus at least the identifier's terminator */
+        if (!data || (length < 11))
+        {
+            return false;
+        }
+
+        memset(&node, 0, sizeof(node));
+        node.address16 = (uint16_t)((data[0] << 8) | data[1]);
+
+        for (size_t i = 0; i < 8; i++)
+        {
+            node.address64 = (node.address64 << 8) | data[2 + i];
+        }
+
+        size_t pos = 10;
+        size_t idLength = 0;
+
+        while ((pos < length) && data[pos])
+        {
+            if (idLength < (XB_NODE_ID_SIZE - 1))
+            {
+                node.identifier[idLength++] = (char)data[pos];
+            }
+            pos++;
+        }
+
+        if (pos >= length)
+        {
+            return false;
+        }
+        pos++;
+
+        /* Older firmware stops after the identifier */
+        node.parent16 = XB_ADDRESS_16_UNKNOWN;
+        node.deviceType = XB_DEVICE_UNKNOWN;
+
+        if ((pos + 3) <= length)
+        {
+            node.parent16 = (uint16_t)((data[pos] << 8) | data[pos + 1]);
+            node.deviceType = static_cast<XBDeviceType>(data[pos + 2]);
+        }
+
+        return true;
+    }
+
+    XBNodeInfo* XBNodeTable::findByIdentifier(const char* identifier)
+    {
+        if (!identifier || !identifier[0])
+        {
+            return nullptr;
+        }
+
+        for (size_t i = 0; i < XB_NODE_TABLE_SIZE; i++)
+        {
+            XBNodeInfo* node = at(i);
+            if (node && !strncmp(node->identifier, identifier, XB_NODE_ID_SIZE))
+            {
+                return node;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool XBNodeTable::lookup16(uint64_t address64, uint16_t& address16)
+    {
+        XBNodeInfo* node = find(address64);
+
+        if (!node || (node->address16 == XB_ADDRESS_16_UNKNOWN))
+        {
+            misses++;
+            return false;
+        }
+
+        hits++;
+        address16 = node->address16;
+        return true;
+    }
+
+    XBNodeInfo* XBNodeTable::update(uint64_t address64, uint16_t address16, size_t now_mS)
+    {
+        bool created = false;
+        XBNodeInfo* node = insert(address64, created);
+
+        if (created)
+        {
+            node->address16 = XB_ADDRESS_16_UNKNOWN;
+            node->parent16 = XB_ADDRESS_16_UNKNOWN;
+            node->deviceType = XB_DEVICE_UNKNOWN;
+        }
+
+        if (address16 != XB_ADDRESS_16_UNKNOWN)
+        {
+            node->address16 = address16;
+        }
+
+        node->lastSeen_mS = now_mS;
+        return node;
+    }
+
+    XBNodeInfo* XBNodeTable::update(const XBNodeInfo& info, size_t now_mS)
+    {
+        XBNodeInfo* node = update(info.address64, info.address16, now_mS);
+
+        if (info.identifier[0])
+        {
+            memcpy(node->identifier, info.identifier, XB_NODE_ID_SIZE);
+            node->identifier[XB_NODE_ID_SIZE - 1] = '\0';
+        }
+
+        if (info.deviceType != XB_DEVICE_UNKNOWN)
+        {
+            node->deviceType = info.deviceType;
+            node->parent16 = info.parent16;
+        }
+
+        return node;
+    }
+}
@@ -0,0 +1,87 @@
+/**
+ * @file xb_node_table.hpp
+ */
+
+#ifndef XBEE_NODE_TABLE_HPP
+#define XBEE_NODE_TABLE_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_api_frame.hpp>
+#include <libxbee/include/xb_address_table.hpp>
+
+/** Hash slots in the node table, a power of two. At most three quarters of them are used, so the default holds 384
+ *  nodes on POSIX and 24 elsewhere. */
+#ifndef XB_NODE_TABLE_SIZE
+#if defined(XBEE_PLATFORM_POSIX)
+#define XB_NODE_TABLE_SIZE 512
+#else
+#define XB_NODE_TABLE_SIZE 32
+#endif
+#endif
+
+#define XB_NODE_ID_SIZE     21      /**< Node identifier (ATNI) of up to 20 characters, plus the terminator */
+
+namespace libxbee
+{
+    /** Device type reported in node discovery and Node Identification (0x95) frames */
+    enum XBDeviceType : uint8_t
+    {
+        XB_DEVICE_COORDINATOR   = 0,
+        XB_DEVICE_ROUTER        = 1,
+        XB_DEVICE_END_DEVICE    = 2,
+        XB_DEVICE_UNKNOWN       = 0xFF,
+    };
+
+    /** What is known about one node of the network */
+    struct XBNodeInfo
+    {
+        uint64_t address64;
+        uint16_t address16;             /**< Network address, XB_ADDRESS_16_UNKNOWN if it hasn't been seen */
+        uint16_t parent16;              /**< Parent's network address for end devices, XB_ADDRESS_16_UNKNOWN otherwise */
+        XBDeviceType deviceType;
+        char identifier[XB_NODE_ID_SIZE];
+        size_t lastSeen_mS;             /**< Last time the node was discovered or heard from */
+    };
+
+    /** Called by XBNodeTable::forEach() for every node */
+    typedef void (*XBNodeVisitor)(const XBNodeInfo& node, void* context);
+
+    /** Node Address Table
+     *  Caches the network address, identifier and last-seen time of every node the driver has discovered or received
+     *  from, so transmissions can carry a known 16-bit address instead of making the module broadcast a network address
+     *  discovery first. Nodes are hashed by 64-bit address, see XBAddressTable.
+     **/
+    class XBNodeTable : public XBAddressTable<XBNodeInfo, XB_NODE_TABLE_SIZE>
+    {
+    public:
+        /** Looks up a node by identifier (ATNI). This walks the whole table. */
+        XBNodeInfo* findByIdentifier(const char* identifier);
+
+        /** Looks up the network address to transmit to a node with
+         *  @return False if the node or its network address isn't known */
+        bool lookup16(uint64_t address64, uint16_t& address16);
+
+        /** Records that a node was heard from at the given network address, adding it if needed
+         *  @return The node's entry */
+        XBNodeInfo* update(uint64_t address64, uint16_t address16, size_t now_mS);
+
+        /** Records a full node description, e.g. from node discovery. Fields the record leaves unknown are kept.
+         *  @return The node's entry */
+        XBNodeInfo* update(const XBNodeInfo& node, size_t now_mS);
+
+        size_t hits = 0;                /**< lookup16() calls that found a network address */
+        size_t misses = 0;              /**< lookup16() calls that didn't */
+    };
+
+    /** Decodes a node description as sent in ATND responses and from the remote address onwards in Node Identification
+     *  (0x95) frames: [16-bit address][64-bit address][identifier][0][parent][device type][status][profile][mfr]
+     *  @return False if the record is too short or its identifier isn't terminated */
+    bool decodeNodeRecord(const uint8_t* data, size_t length, XBNodeInfo& node);
+}
+
+#endif /* !XBEE_NODE_TABLE_HPP */
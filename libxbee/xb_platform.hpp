@@ -0,0 +1,77 @@
+/**
+ * @file xb_platform.hpp
+ */
+
+#ifndef XBEE_PLATFORM_HPP
+#define XBEE_PLATFORM_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(XBEE_PLATFORM_POSIX)
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#else
+/* Chimera Includes */
+#include <Chimera/chimera.hpp>
+#include <Chimera/logging.hpp>
+#include <Chimera/threading.hpp>
+#endif
+
+/** Log Message
+ *  Routes driver log output to the Chimera console, or to stderr on host builds. The level is one of INFO, WARN or ERROR.
+ *
+ *  @code
+ *  XB_LOG(INFO, "Found XBEE at baud: %d\r\n", baud);
+ *  @endcode
+ **/
+#if defined(XBEE_PLATFORM_POSIX)
+#define XB_LOG(level, ...) fprintf(stderr, __VA_ARGS__)
+#else
+#define XB_LOG(level, ...) Chimera::Logging::Console.log(Chimera::Logging::Level::level, __VA_ARGS__)
+#endif
+
+namespace libxbee
+{
+    namespace platform
+    {
+        /** Suspends the calling thread for the given number of milliseconds */
+        inline void delayMilliseconds(size_t delay_mS)
+        {
+            #if defined(XBEE_PLATFORM_POSIX)
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay_mS));
+            #else
+            Chimera::delayMilliseconds(delay_mS);
+            #endif
+        }
+
+        /** Millisecond time base used for timeouts and latency measurements */
+        inline size_t millis()
+        {
+            #if defined(XBEE_PLATFORM_POSIX)
+            using namespace std::chrono;
+            return (size_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+            #elif defined(USING_FREERTOS)
+            return (size_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+            #else
+            return (size_t)Chimera::millis();
+            #endif
+        }
+
+        /** Microsecond time base for timestamps. Only host builds have the resolution, elsewhere it counts in whole
+         *  milliseconds. */
+        inline uint64_t micros()
+        {
+            #if defined(XBEE_PLATFORM_POSIX)
+            using namespace std::chrono;
+            return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+            #else
+            return (uint64_t)millis() * 1000;
+            #endif
+        }
+    }
+}
+
+#endif /* !XBEE_PLATFORM_HPP */
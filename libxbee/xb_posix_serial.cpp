@@ -0,0 +1,552 @@
+/* C/C++ Includes */
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <chrono>
+
+/* termios2 and BOTHER. This clashes with <termios.h>, so the port is configured purely through ioctl() */
+#include <asm/termbits.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_posix_serial.hpp>
+
+
+namespace libxbee
+{
+    XbeePosixSerial::~XbeePosixSerial()
+    {
+        close();
+    }
+
+    XBStatus XbeePosixSerial::open(const char* device, uint32_t baud)
+    {
+        close();
+
+        fd = ::open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return XB_NOT_FOUND;
+        }
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        struct epoll_event ttyEvent = {};
+        ttyEvent.events = EPOLLIN;
+        ttyEvent.data.fd = fd;
+
+        struct epoll_event wakeEvent = {};
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.fd = wakeFd;
+
+        if ((epollFd < 0) || (wakeFd < 0) || !configure(baud) ||
+            (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ttyEvent) < 0) ||
+            (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &wakeEvent) < 0))
+        {
+            close();
+            return XB_UNKNOWN_ERROR;
+        }
+
+        rxRing.flush();
+        return XB_OK;
+    }
+
+    void XbeePosixSerial::close()
+    {
+        stop();
+
+        if (epollFd >= 0)
+        {
+            ::close(epollFd);
+            epollFd = -1;
+        }
+
+        if (wakeFd >= 0)
+        {
+            ::close(wakeFd);
+            wakeFd = -1;
+        }
+
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    bool XbeePosixSerial::configure(uint32_t baud)
+    {
+        struct termios2 tio;
+
+        if (ioctl(fd, TCGETS2, &tio) < 0)
+        {
+            return false;
+        }
+
+        /* Raw mode, the equivalent of cfmakeraw() */
+        tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+        tio.c_oflag &= ~OPOST;
+        tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+        tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD | (CBAUD << IBSHIFT));
+        tio.c_cflag |= CS8 | CREAD | CLOCAL | BOTHER | (BOTHER << IBSHIFT);
+
+        if (flowControl)
+        {
+            tio.c_cflag |= CRTSCTS;
+        }
+
+        tio.c_ispeed = baud;
+        tio.c_ospeed = baud;
+
+        /* Reads return whatever is there, the nonblocking fd and epoll do the waiting */
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+
+        if (ioctl(fd, TCSETS2, &tio) < 0)
+        {
+            return false;
+        }
+
+        this->baud = baud;
+        return true;
+    }
+
+    XBStatus XbeePosixSerial::start()
+    {
+        if (fd < 0)
+        {
+            return XB_UNKNOWN_ERROR;
+        }
+
+        if (running)
+        {
+            return XB_OK;
+        }
+
+        /* Reap a reader that stopped on its own after a device error */
+        if (reader.joinable())
+        {
+            reader.join();
+        }
+
+        running = true;
+        reader = std::thread(&XbeePosixSerial::readerLoop, this);
+        return XB_OK;
+    }
+
+    void XbeePosixSerial::stop()
+    {
+        if (!reader.joinable())
+        {
+            return;
+        }
+
+        running = false;
+
+        uint64_t wake = 1;
+        ssize_t result = ::write(wakeFd, &wake, sizeof(wake));
+        (void)result;
+
+        reader.join();
+
+        /* Leave the eventfd readable state behind so the next epoll_wait() doesn't return straight away */
+        uint64_t discard;
+        result = ::read(wakeFd, &discard, sizeof(discard));
+        (void)result;
+    }
+
+    void XbeePosixSerial::watchInput(bool enabled)
+    {
+        struct epoll_event ttyEvent = {};
+        ttyEvent.events = enabled ? (uint32_t)EPOLLIN : 0;
+        ttyEvent.data.fd = fd;
+
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ttyEvent);
+    }
+
+    void XbeePosixSerial::releaseHoldoff()
+    {
+        /* Pairs with the fence in readerLoop(): either the reader sees the room just made, or this sees its flag */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (holdingOff.load(std::memory_order_relaxed))
+        {
+            uint64_t wake = 1;
+            ssize_t result = ::write(wakeFd, &wake, sizeof(wake));
+            (void)result;
+        }
+    }
+
+    void XbeePosixSerial::readerLoop()
+    {
+        struct epoll_event events[2];
+
+        while (running)
+        {
+            /* Let the kernel hold on to the data while the consumer catches up, rather than reading it only to drop it.
+             * With CRTSCTS the kernel drops RTS once its own buffer fills, which pauses the module. The tty is taken out
+             * of the epoll set meanwhile, and the consumer wakes the thread through wakeFd once it has made room. */
+            if (!holdingOff && (rxRing.size() == rxRing.capacity()))
+            {
+                rxHoldoffs++;
+                watchInput(false);
+                holdingOff = true;
+
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                /* The consumer may have made room before it could see the flag */
+                if (rxRing.size() < rxRing.capacity())
+                {
+                    holdingOff = false;
+                    watchInput(true);
+                }
+            }
+
+            int ready = epoll_wait(epollFd, events, 2, -1);
+
+            if ((ready < 0) && (errno != EINTR))
+            {
+                readErrors++;
+                break;
+            }
+
+            for (int i = 0; i < ready; i++)
+            {
+                if (events[i].data.fd == wakeFd)
+                {
+                    uint64_t discard;
+                    ssize_t result = ::read(wakeFd, &discard, sizeof(discard));
+                    (void)result;
+
+                    if (holdingOff && (rxRing.size() < rxRing.capacity()))
+                    {
+                        holdingOff = false;
+                        watchInput(true);
+                    }
+                    continue;
+                }
+
+                if (!drain() || (events[i].events & (EPOLLERR | EPOLLHUP)))
+                {
+                    running = false;
+                }
+            }
+        }
+
+        /* A restarted reader has to see the tty again */
+        if (holdingOff)
+        {
+            holdingOff = false;
+            watchInput(true);
+        }
+
+        /* Release anyone still waiting for data that will never come */
+        dataReady.notify_all();
+    }
+
+    bool XbeePosixSerial::drain()
+    {
+        uint8_t chunk[XB_POSIX_READ_CHUNK_SIZE];
+        bool pushed = false;
+        bool healthy = true;
+
+        while (true)
+        {
+            size_t space = rxRing.capacity() - rxRing.size();
+            if (!space)
+            {
+                break;
+            }
+
+            ssize_t count = ::read(fd, chunk, (space < sizeof(chunk)) ? space : sizeof(chunk));
+
+            if (count > 0)
+            {
+                rxRing.push(chunk, (size_t)count);
+                pushed = true;
+                continue;
+            }
+
+            if ((count < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+
+            /* With VMIN = 0 an empty tty reads as 0 or EAGAIN. Anything else (EIO on hangup) means the device went away. */
+            if ((count < 0) && (errno != EAGAIN))
+            {
+                readErrors++;
+                healthy = false;
+            }
+
+            break;
+        }
+
+        if (pushed)
+        {
+            /* Taking the lock orders the push against a consumer that's about to sleep, so the wakeup can't be lost */
+            std::lock_guard<std::mutex> lock(dataLock);
+            dataReady.notify_all();
+        }
+
+        return healthy;
+    }
+
+    bool XbeePosixSerial::waitForData(size_t timeout_mS)
+    {
+        return waitForData(1, timeout_mS);
+    }
+
+    bool XbeePosixSerial::waitForData(size_t count, size_t timeout_mS)
+    {
+        using namespace std::chrono;
+
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        auto deadline = steady_clock::now() + milliseconds(timeout_mS);
+
+        if (running)
+        {
+            std::unique_lock<std::mutex> lock(dataLock);
+            return dataReady.wait_until(lock, deadline, [this, count] { return (rxRing.size() >= count) || !running; }) &&
+                (rxRing.size() >= count);
+        }
+
+        while (true)
+        {
+            drain();
+
+            if (rxRing.size() >= count)
+            {
+                return true;
+            }
+
+            auto now = steady_clock::now();
+            if (now >= deadline)
+            {
+                return false;
+            }
+
+            /* Round up so a sub-millisecond remainder doesn't turn into a busy loop */
+            int wait_mS = (int)duration_cast<milliseconds>(deadline - now + microseconds(999)).count();
+
+            struct epoll_event event;
+            if ((epoll_wait(epollFd, &event, 1, wait_mS) < 0) && (errno != EINTR))
+            {
+                return false;
+            }
+        }
+    }
+
+    void XbeePosixSerial::write(uint8_t* data, size_t length)
+    {
+        XBSpan span = { data, length };
+        writev(&span, 1);
+    }
+
+    void XbeePosixSerial::writev(const XBSpan* spans, size_t count)
+    {
+        if (fd < 0)
+        {
+            return;
+        }
+
+        struct iovec iov[XB_POSIX_MAX_IOV];
+
+        while (count)
+        {
+            int used = 0;
+            for (size_t i = 0; (i < count) && (used < XB_POSIX_MAX_IOV); i++)
+            {
+                iov[used].iov_base = const_cast<uint8_t*>(spans[i].data);
+                iov[used].iov_len = spans[i].length;
+                used++;
+            }
+
+            spans += used;
+            count -= used;
+
+            /* Short writes leave the iovec array pointing at whatever is left */
+            struct iovec* next = iov;
+            while (used)
+            {
+                ssize_t written = ::writev(fd, next, used);
+
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+
+                    if (errno == EAGAIN)
+                    {
+                        /* With flow control on, a full output queue means the module has deasserted CTS */
+                        auto start = std::chrono::steady_clock::now();
+
+                        struct pollfd pfd = { fd, POLLOUT, 0 };
+                        int ready = poll(&pfd, 1, XB_POSIX_WRITE_TIMEOUT_mS);
+
+                        if (flowControl)
+                        {
+                            throttleEvents++;
+                            throttled_mS += (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - start).count();
+                        }
+
+                        /* Still blocked, or gone: give up on the rest so the caller's own timeouts can run */
+                        if ((ready == 0) || ((ready > 0) && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))))
+                        {
+                            dropRemaining(next, used, spans, count);
+                            return;
+                        }
+                        continue;
+                    }
+
+                    dropRemaining(next, used, spans, count);
+                    return;
+                }
+
+                size_t remaining = (size_t)written;
+                while (used && (remaining >= next->iov_len))
+                {
+                    remaining -= next->iov_len;
+                    next++;
+                    used--;
+                }
+
+                if (used)
+                {
+                    next->iov_base = static_cast<uint8_t*>(next->iov_base) + remaining;
+                    next->iov_len -= remaining;
+                }
+            }
+        }
+    }
+
+    void XbeePosixSerial::dropRemaining(const struct iovec* iov, int used, const XBSpan* spans, size_t count)
+    {
+        size_t dropped = 0;
+
+        for (int i = 0; i < used; i++)
+        {
+            dropped += iov[i].iov_len;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            dropped += spans[i].length;
+        }
+
+        txDropped += dropped;
+    }
+
+    size_t XbeePosixSerial::read(uint8_t* data, size_t length)
+    {
+        if (!running && (fd >= 0))
+        {
+            drain();
+        }
+
+        size_t count = rxRing.pop(data, length);
+
+        if (count && running)
+        {
+            releaseHoldoff();
+        }
+
+        return count;
+    }
+
+    size_t XbeePosixSerial::available()
+    {
+        if (!running && (fd >= 0))
+        {
+            drain();
+        }
+
+        return rxRing.size();
+    }
+
+    bool XbeePosixSerial::setBaud(uint32_t baud)
+    {
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        /* Let anything already queued go out at the old rate */
+        ioctl(fd, TCSBRK, 1);
+        return configure(baud);
+    }
+
+    bool XbeePosixSerial::setFlowControl(bool enabled)
+    {
+        bool previous = flowControl;
+        flowControl = enabled;
+
+        if ((fd >= 0) && !configure(baud))
+        {
+            flowControl = previous;
+            return false;
+        }
+
+        return true;
+    }
+
+    XBFlowStats XbeePosixSerial::flowStats()
+    {
+        XBFlowStats stats;
+        stats.throttleEvents = throttleEvents;
+        stats.throttled_mS = throttled_mS;
+        stats.rxHoldoffs = rxHoldoffs;
+        stats.txDropped = txDropped;
+        return stats;
+    }
+
+    void XbeePosixSerial::resetFlowStats()
+    {
+        throttleEvents = 0;
+        throttled_mS = 0;
+        rxHoldoffs = 0;
+        txDropped = 0;
+    }
+
+    void XbeePosixSerial::flush()
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, TCFLSH, TCIFLUSH);
+        }
+
+        rxRing.flush();
+
+        if (running)
+        {
+            releaseHoldoff();
+        }
+    }
+
+    XBSerialRxStats XbeePosixSerial::rxStats()
+    {
+        XBSerialRxStats stats;
+        stats.highWaterMark = rxRing.highWaterMark();
+        stats.overruns = rxRing.overruns();
+        stats.packetErrors = readErrors;
+        return stats;
+    }
+
+    void XbeePosixSerial::resetRxStats()
+    {
+        rxRing.resetStats();
+        readErrors = 0;
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * @file xb_posix_serial.hpp
+ */
+
+#ifndef XBEE_POSIX_SERIAL_HPP
+#define XBEE_POSIX_SERIAL_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <sys/uio.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_serial.hpp>
+#include <libxbee/include/xb_ring_buffer.hpp>
+
+/** Size of the receive ring. Must be a power of two. At 921600 baud this is ~45mS of data. */
+#ifndef XB_POSIX_RX_RING_SIZE
+#define XB_POSIX_RX_RING_SIZE 4096
+#endif
+
+/** Largest single read() pulled out of the tty per wakeup */
+#ifndef XB_POSIX_READ_CHUNK_SIZE
+#define XB_POSIX_READ_CHUNK_SIZE 1024
+#endif
+
+/** Longest a write waits for the port to accept more data, e.g. while the module holds CTS deasserted or after it was
+ *  unplugged. Whatever is left of the write is dropped and counted in XBFlowStats::txDropped. */
+#ifndef XB_POSIX_WRITE_TIMEOUT_mS
+#define XB_POSIX_WRITE_TIMEOUT_mS 1000
+#endif
+
+/** Most spans handed to a single writev() call */
+#ifndef XB_POSIX_MAX_IOV
+#define XB_POSIX_MAX_IOV 16
+#endif
+
+namespace libxbee
+{
+    /** Linux Serial Backend
+     *  Drives a tty (USB adapter, on-board UART or one side of a pty pair) for host gateways. The port is put in raw
+     *  8N1 mode and opened nonblocking. Any baud rate can be requested, not just the standard Bxxx set, because the
+     *  speed is programmed through termios2/BOTHER.
+     *
+     *  Received bytes go through the same lock-free ring the embedded backend uses. The ring is filled in one of two ways:
+     *
+     *  1. start() spawns a reader thread that sleeps in epoll_wait() and drains the tty as soon as it becomes readable.
+     *     This keeps up with 921600 baud while costing nothing when the line is idle.
+     *  2. Without the reader thread, read(), available() and waitForData() drain the tty on demand.
+     **/
+    class XbeePosixSerial : public XBEESerial
+    {
+    public:
+        /** Opens and configures the port
+         *
+         *  @param[in]  device      Path of the tty, e.g. "/dev/ttyUSB0"
+         *  @param[in]  baud        Initial baud rate
+         *  @return     XBStatus    XB_OK, XB_NOT_FOUND if the device couldn't be opened, or XB_UNKNOWN_ERROR if it
+         *                          couldn't be configured
+         **/
+        XBStatus open(const char* device, uint32_t baud = 9600);
+
+        /** Stops the reader thread and closes the port */
+        void close();
+
+        bool isOpen() { return fd >= 0; }
+
+        /** Spawns the epoll reader thread. Must be called after open(). */
+        XBStatus start();
+
+        /** Stops the reader thread. Data already in the ring stays readable. */
+        void stop();
+
+        /** Blocks until received data is waiting or the timeout expires
+         *  @return True if data is available */
+        bool waitForData(size_t timeout_mS) override;
+
+        /** Blocks until the given number of received bytes are waiting, or the timeout expires */
+        bool waitForData(size_t count, size_t timeout_mS);
+
+        /** Writes the whole buffer, waiting for the tty to drain if its output queue fills up. If it makes no progress for
+         *  XB_POSIX_WRITE_TIMEOUT_mS the rest is dropped. */
+        void write(uint8_t* data, size_t length) override;
+
+        /** Hands all spans to the kernel in a single writev() */
+        void writev(const XBSpan* spans, size_t count) override;
+        size_t read(uint8_t* data, size_t length) override;
+        size_t available() override;
+
+        /** Waits for queued output to go out at the old rate first
+         *  @return False if the port isn't open or the rate couldn't be programmed, in which case the old rate stays */
+        bool setBaud(uint32_t baud) override;
+
+        /** Currently configured baud rate */
+        uint32_t getBaud() { return baud; }
+
+        /** Enables or disables CRTSCTS on the tty. The kernel then holds transmission while CTS is deasserted and
+         *  drops RTS when its own receive buffer fills up. */
+        bool setFlowControl(bool enabled) override;
+
+        /** Snapshot of the flow control statistics */
+        XBFlowStats flowStats() override;
+        void resetFlowStats() override;
+
+        /** Discards all received data that hasn't been read yet, including anything still queued in the tty */
+        void flush();
+
+        /** Snapshot of the receive statistics */
+        XBSerialRxStats rxStats() override;
+
+        /** Clears the receive statistics */
+        void resetRxStats();
+
+        /** File descriptor of the open tty, or -1 */
+        int handle() { return fd; }
+
+        XbeePosixSerial() = default;
+        ~XbeePosixSerial();
+
+    private:
+        int fd = -1;
+        int epollFd = -1;
+        int wakeFd = -1;            /**< eventfd used to pull the reader thread out of epoll_wait() */
+        uint32_t baud = 0;
+        bool flowControl = false;
+
+        std::thread reader;
+        std::atomic<bool> running{ false };
+
+        /* Only used to sleep in waitForData(). The ring itself stays lock-free. */
+        std::mutex dataLock;
+        std::condition_variable dataReady;
+
+        XBRingBuffer<XB_POSIX_RX_RING_SIZE> rxRing;
+        std::atomic<size_t> readErrors{ 0 };
+
+        /* Set by the reader thread while the ring is full and the tty is left unread. The consumer signals wakeFd once it
+         * has made room. */
+        std::atomic<bool> holdingOff{ false };
+
+        /* Written by the writer and reader threads respectively, read from anywhere */
+        std::atomic<size_t> throttleEvents{ 0 };
+        std::atomic<size_t> throttled_mS{ 0 };
+        std::atomic<size_t> rxHoldoffs{ 0 };
+        std::atomic<size_t> txDropped{ 0 };
+
+        /** Applies raw 8N1 mode, the flow control setting and the given baud rate to the open tty */
+        bool configure(uint32_t baud);
+
+        /** Stops or resumes watching the tty for input, while the reader thread holds off */
+        void watchInput(bool enabled);
+
+        /** Wakes a reader thread that is holding off, after the consumer took data out of the ring */
+        void releaseHoldoff();
+
+        /** Moves everything the tty has into the ring. Returns false if the tty reported an error or hangup. */
+        bool drain();
+
+        /** Counts what a write gave up on as txDropped: the unsent part of the current batch and the spans after it */
+        void dropRemaining(const struct iovec* iov, int used, const XBSpan* spans, size_t count);
+
+        /** Reader thread body */
+        void readerLoop();
+    };
+}
+
+#endif /* !XBEE_POSIX_SERIAL_HPP */
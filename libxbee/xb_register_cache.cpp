@@ -0,0 +1,301 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_register_cache.hpp>
+
+
+namespace libxbee
+{
+    const XBRegisterInfo XBRegisterCache::knownRegisters[XB_REGISTER_CACHE_SIZE] = {
+        { "VR", true  },    /* XB_FIRMWARE_VER */
+        { "HV", true  },    /* XB_HARDWARE_VER */
+        { "CT", false },    /* XB_CMD_MODE_TIMEOUT */
+        { "GT", false },    /* XB_SET_GUARD_TIME */
+        { "CC", false },    /* XB_SET_CMD_SEQ_CHAR */
+        { "AP", false },    /* XB_API_ENABLE */
+        { "BD", false },    /* XB_BAUD_RATE */
+        { "D6", false },    /* XB_RTS_FLOW_CONTROL */
+        { "D7", false },    /* XB_CTS_FLOW_CONTROL */
+    };
+
+    XBRegisterCache::XBRegisterCache()
+    {
+        invalidate();
+    }
+
+    int XBRegisterCache::indexOf(const char* command)
+    {
+        command = commandCode(command);
+
+        if (command)
+        {
+            for (size_t i = 0; i < XB_REGISTER_CACHE_SIZE; i++)
+            {
+                if ((knownRegisters[i].code[0] == command[0]) && (knownRegisters[i].code[1] == command[1]))
+                {
+                    return (int)i;
+                }
+            }
+        }
+
+        return -1;
+    }
+
+    XBRegister* XBRegisterCache::find(const char* command)
+    {
+        int index = indexOf(command);
+        return (index < 0) ? nullptr : &registers[index];
+    }
+
+    const XBRegisterInfo* XBRegisterCache::info(const char* command)
+    {
+        int index = indexOf(command);
+        return (index < 0) ? nullptr : &knownRegisters[index];
+    }
+
+    bool XBRegisterCache::get(const char* command, uint32_t& value)
+    {
+        XBRegister* reg = find(command);
+
+        if (!reg || !reg->valid)
+        {
+            return false;
+        }
+
+        value = reg->value;
+        readsAvoided++;
+        return true;
+    }
+
+    XBStatus XBRegisterCache::set(const char* command, uint32_t value)
+    {
+        int index = indexOf(command);
+
+        if ((index < 0) || knownRegisters[index].readOnly)
+        {
+            return XB_INVALID_PARAM;
+        }
+
+        XBRegister& reg = registers[index];
+
+        if (reg.valid && (reg.value == value))
+        {
+            /* Either the module already holds it, or it's already staged */
+            if (!reg.dirty)
+            {
+                writesAvoided++;
+            }
+
+            return XB_OK;
+        }
+
+        reg.value = value;
+        reg.valid = true;
+        reg.dirty = true;
+        return XB_OK;
+    }
+
+    void XBRegisterCache::updateFromRead(const char* command, uint32_t value)
+    {
+        XBRegister* reg = find(command);
+
+        if (!reg)
+        {
+            return;
+        }
+
+        reg->value = value;
+        reg->valid = true;
+        reg->dirty = false;
+
+        /* With nothing written since the last reset, the running value is what's stored in flash */
+        if (!reg->persistKnown && !reg->written)
+        {
+            reg->persistedValue = value;
+            reg->persistKnown = true;
+        }
+    }
+
+    void XBRegisterCache::updateFromWrite(const char* command, uint32_t value)
+    {
+        XBRegister* reg = find(command);
+
+        if (!reg)
+        {
+            untrackedWrite = true;
+            untrackedUnapplied = true;
+            return;
+        }
+
+        reg->value = value;
+        reg->valid = true;
+        reg->dirty = false;
+        reg->unapplied = true;
+        reg->written = true;
+    }
+
+    void XBRegisterCache::writeIssued(const char* command)
+    {
+        command = commandCode(command);
+
+        if (!command || (strcmp(command, &XB_NODE_DISCOVER[2]) == 0) || (strcmp(command, &XB_DESTINATION_NODE[2]) == 0))
+        {
+            return;
+        }
+
+        XBRegister* reg = find(command);
+
+        if (!reg)
+        {
+            untrackedWrite = true;
+            untrackedUnapplied = true;
+            return;
+        }
+
+        reg->valid = false;
+        reg->dirty = false;
+        reg->unapplied = true;
+        reg->written = true;
+    }
+
+    void XBRegisterCache::applied()
+    {
+        for (size_t i = 0; i < XB_REGISTER_CACHE_SIZE; i++)
+        {
+            registers[i].unapplied = false;
+        }
+
+        untrackedUnapplied = false;
+    }
+
+    void XBRegisterCache::persisted()
+    {
+        for (size_t i = 0; i < XB_REGISTER_CACHE_SIZE; i++)
+        {
+            XBRegister& reg = registers[i];
+
+            if (reg.valid && !reg.dirty)
+            {
+                reg.persistedValue = reg.value;
+                reg.persistKnown = true;
+                reg.written = false;
+            }
+            else if (!reg.valid && reg.written)
+            {
+                /* Flash now holds whatever was written, which isn't known either */
+                reg.persistKnown = false;
+                reg.written = false;
+            }
+        }
+
+        untrackedWrite = false;
+    }
+
+    void XBRegisterCache::invalidate()
+    {
+        memset(registers, 0, sizeof(registers));
+        untrackedWrite = false;
+        untrackedUnapplied = false;
+    }
+
+    void XBRegisterCache::executed(const char* command)
+    {
+        command = commandCode(command);
+
+        if (!command)
+        {
+            return;
+        }
+
+        if ((strcmp(command, &XB_APPLY_CHANGES[2]) == 0) || (strcmp(command, &XB_CMD_MODE_EXIT[2]) == 0))
+        {
+            applied();
+        }
+        else if (strcmp(command, &XB_WRITE_MEMORY[2]) == 0)
+        {
+            persisted();
+        }
+        else if ((strcmp(command, &XB_SOFTWARE_RESET[2]) == 0) || (strcmp(command, &XB_RESTORE_DEFAULTS[2]) == 0) ||
+                 (strcmp(command, &XB_NETWORK_RESET[2]) == 0))
+        {
+            invalidate();
+        }
+    }
+
+    size_t XBRegisterCache::dirtyCount()
+    {
+        size_t count = 0;
+
+        for (size_t i = 0; i < XB_REGISTER_CACHE_SIZE; i++)
+        {
+            if (registers[i].dirty)
+            {
+                count++;
+            }
+        }
+
+        return count;
+    }
+
+    bool XBRegisterCache::needsApply()
+    {
+        for (size_t i = 0; i < XB_REGISTER_CACHE_SIZE; i++)
+        {
+            if (registers[i].unapplied)
+            {
+                return true;
+            }
+        }
+
+        return untrackedUnapplied;
+    }
+
+    bool XBRegisterCache::needsPersist()
+    {
+        if (untrackedWrite)
+        {
+            return true;
+        }
+
+        for (size_t i = 0; i < XB_REGISTER_CACHE_SIZE; i++)
+        {
+            const XBRegister& reg = registers[i];
+
+            /* A register written without ever learning the flash contents has to be assumed different */
+            if ((reg.dirty || reg.written) && (!reg.persistKnown || (reg.persistedValue != reg.value)))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    XBStatus XBRegisterCache::buildFlush(XBATBatch& batch, bool persist)
+    {
+        XBStatus result = XB_OK;
+        bool staged = false;
+
+        for (size_t i = 0; (i < XB_REGISTER_CACHE_SIZE) && (result == XB_OK); i++)
+        {
+            if (registers[i].dirty)
+            {
+                result = batch.add(knownRegisters[i].code, registers[i].value);
+                staged = true;
+            }
+        }
+
+        if ((result == XB_OK) && (staged || needsApply()))
+        {
+            result = batch.applyChanges();
+        }
+
+        if ((result == XB_OK) && persist && needsPersist())
+        {
+            result = batch.writeChanges();
+        }
+
+        return result;
+    }
+}
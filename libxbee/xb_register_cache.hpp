@@ -0,0 +1,136 @@
+/**
+ * @file xb_register_cache.hpp
+ */
+
+#ifndef XBEE_REGISTER_CACHE_HPP
+#define XBEE_REGISTER_CACHE_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_at_batch.hpp>
+
+namespace libxbee
+{
+    #define XB_REGISTER_CACHE_SIZE      9       /**< Number of registers tracked by XBRegisterCache */
+
+    /** Static description of a register the cache knows about */
+    struct XBRegisterInfo
+    {
+        char code[3];                   /**< Two character command code */
+        bool readOnly;                  /**< True for registers that can't be written (VR, HV...) */
+    };
+
+    /** Cached state of a single register */
+    struct XBRegister
+    {
+        uint32_t value;                 /**< Value the driver believes the register holds, or should hold if dirty */
+        uint32_t persistedValue;        /**< Value stored in non-volatile memory */
+
+        bool valid;                     /**< value is known */
+        bool dirty;                     /**< value was changed locally and hasn't been written to the module yet */
+        bool unapplied;                 /**< value was written to the module but not yet applied with AC/CN */
+        bool written;                   /**< value was written to the module since the last WR or reset */
+        bool persistKnown;              /**< persistedValue is known */
+    };
+
+    /** Shadow Register File
+     *  Remembers the values of the command registers listed in xb_definitions.hpp so reads can be served without a round
+     *  trip, tracks registers that have been changed locally but not yet written (dirty), and knows which values differ
+     *  from what is stored in non-volatile memory. That lets the driver flush only changed registers with a single ATAC,
+     *  and issue ATWR only when it would actually change the flash contents.
+     *
+     *  The cache is only as good as what the driver tells it: any register write that goes through the driver is
+     *  recorded, and reset commands (FR, RE, NR) invalidate everything.
+     **/
+    class XBRegisterCache
+    {
+    public:
+        /** Reads a register from the cache
+         *
+         *  @param[in]  command     Command string, either "CT" or "ATCT"
+         *  @param[out] value       Cached value
+         *  @return     bool        True if the cache holds a valid value
+         **/
+        bool get(const char* command, uint32_t& value);
+
+        /** Stages a new register value to be written on the next flush
+         *
+         *  @param[in]  command     Command string, either "CT" or "ATCT"
+         *  @param[in]  value       The desired value
+         *  @return     XBStatus    XB_OK if staged (or already equal), XB_INVALID_PARAM for unknown/read-only registers
+         **/
+        XBStatus set(const char* command, uint32_t value);
+
+        /** Records a value that was read back from the module */
+        void updateFromRead(const char* command, uint32_t value);
+
+        /** Records a value that the module accepted in a register write */
+        void updateFromWrite(const char* command, uint32_t value);
+
+        /** Records a register write whose value the cache doesn't see, such as raw parameter bytes sent asynchronously.
+         *  The register's value is unknown until it is read again, and the write counts as unapplied and unpersisted.
+         *  ND and DN take a parameter without changing any setting, so they are ignored.
+         **/
+        void writeIssued(const char* command);
+
+        /** Records that the module applied all written values (AC, CN) */
+        void applied();
+
+        /** Records that the module persisted all values (WR) */
+        void persisted();
+
+        /** Forgets everything, typically after the module was reset or restored to defaults */
+        void invalidate();
+
+        /** Records the effect of an execution command (AC, WR, FR...) that the module accepted */
+        void executed(const char* command);
+
+        /** Number of registers waiting to be written */
+        size_t dirtyCount();
+
+        /** True if any value written to the module hasn't been applied */
+        bool needsApply();
+
+        /** True if non-volatile memory doesn't match the values written to the module */
+        bool needsPersist();
+
+        /** Appends a write for every dirty register to the batch, followed by AC if anything is staged or unapplied and WR
+         *  if persist is set and the result would differ from non-volatile memory.
+         *
+         *  @param[in]  batch       Batch to add the commands to
+         *  @param[in]  persist     Whether the values should be written to non-volatile memory
+         *  @return     XBStatus    XB_OK if everything fit in the batch
+         **/
+        XBStatus buildFlush(XBATBatch& batch, bool persist);
+
+        /** Returns the register entry for a command, or nullptr if the cache doesn't track it */
+        XBRegister* find(const char* command);
+
+        /** Returns the static description of a tracked register, or nullptr */
+        static const XBRegisterInfo* info(const char* command);
+
+        /** Number of register writes that were skipped because the module already held the value */
+        size_t writesAvoided = 0;
+
+        /** Number of register reads served from the cache */
+        size_t readsAvoided = 0;
+
+        XBRegisterCache();
+        ~XBRegisterCache() = default;
+
+    private:
+        static const XBRegisterInfo knownRegisters[XB_REGISTER_CACHE_SIZE];
+
+        XBRegister registers[XB_REGISTER_CACHE_SIZE];
+        bool untrackedWrite = false;        /**< A register the cache doesn't know about was written and not persisted */
+        bool untrackedUnapplied = false;    /**< A register the cache doesn't know about was written and not applied */
+
+        static int indexOf(const char* command);
+    };
+}
+
+#endif /* !XBEE_REGISTER_CACHE_HPP */
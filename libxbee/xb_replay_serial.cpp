@@ -0,0 +1,215 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_replay_serial.hpp>
+#include <libxbee/include/xb_platform.hpp>
+
+
+namespace libxbee
+{
+    XBStatus XBReplaySerial::load(const uint8_t* capture, size_t length)
+    {
+        XBStatus result = rxReader.open(capture, length);
+
+        if (result == XB_OK)
+        {
+            result = txReader.open(capture, length);
+        }
+
+        rewind();
+        return result;
+    }
+
+    #if defined(XBEE_PLATFORM_POSIX)
+    XBStatus XBReplaySerial::loadFile(const char* path)
+    {
+        FILE* input = path ? fopen(path, "rb") : nullptr;
+        if (!input)
+        {
+            return XB_NOT_FOUND;
+        }
+
+        std::vector<uint8_t> data;
+        uint8_t chunk[4096];
+        size_t count = 0;
+
+        while ((count = fread(chunk, 1, sizeof(chunk), input)) != 0)
+        {
+            data.insert(data.end(), chunk, chunk + count);
+        }
+
+        fclose(input);
+
+        file.swap(data);
+        return load(file.data(), file.size());
+    }
+    #endif
+
+    void XBReplaySerial::rewind()
+    {
+        rxReader.rewind();
+        txReader.rewind();
+
+        rxValid = false;
+        rxOffset = 0;
+        gate_uS = 0;
+        gateBytes = 0;
+        txValid = false;
+        txOffset = 0;
+
+        bytesReplayed = 0;
+        bytesWritten = 0;
+        mismatches = 0;
+        baudChanges = 0;
+
+        start_uS = platform::micros();
+        lastWrite_uS = start_uS;
+
+        nextRx();
+    }
+
+    bool XBReplaySerial::nextRx()
+    {
+        rxOffset = 0;
+
+        while ((rxValid = rxReader.next(rx)))
+        {
+            if (rx.tag == XB_CAPTURE_RX)
+            {
+                return true;
+            }
+
+            if (rx.tag == XB_CAPTURE_TX)
+            {
+                gate_uS = rx.time_uS;
+                gateBytes += rx.length;
+            }
+        }
+
+        return false;
+    }
+
+    bool XBReplaySerial::finished()
+    {
+        return !rxValid;
+    }
+
+    uint64_t XBReplaySerial::due_uS()
+    {
+        if (mode == XB_REPLAY_FAST)
+        {
+            return 0;
+        }
+
+        /* Before the first transmission, and without followWrites, everything is relative to the start */
+        if (!followWrites || !gateBytes)
+        {
+            return start_uS + rx.time_uS;
+        }
+
+        return lastWrite_uS + (rx.time_uS - gate_uS);
+    }
+
+    size_t XBReplaySerial::available()
+    {
+        if (!rxValid || !gateOpen())
+        {
+            return 0;
+        }
+
+        if ((mode == XB_REPLAY_REALTIME) && ((int64_t)(platform::micros() - due_uS()) < 0))
+        {
+            return 0;
+        }
+
+        return rx.length - rxOffset;
+    }
+
+    size_t XBReplaySerial::read(uint8_t* data, size_t length)
+    {
+        size_t copied = 0;
+
+        /* Keep going into the following records as long as they're due too */
+        while (copied < length)
+        {
+            size_t ready = available();
+            if (!ready)
+            {
+                break;
+            }
+
+            size_t chunk = length - copied;
+            chunk = (ready < chunk) ? ready : chunk;
+
+            memcpy(&data[copied], &rx.data[rxOffset], chunk);
+            copied += chunk;
+            rxOffset += chunk;
+
+            if (rxOffset >= rx.length)
+            {
+                nextRx();
+            }
+        }
+
+        bytesReplayed += copied;
+        return copied;
+    }
+
+    void XBReplaySerial::write(uint8_t* data, size_t length)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            while (!txValid || (txOffset >= tx.length))
+            {
+                txOffset = 0;
+                txValid = txReader.next(tx);
+
+                if (!txValid)
+                {
+                    break;
+                }
+
+                if (tx.tag != XB_CAPTURE_TX)
+                {
+                    tx.length = 0;
+                }
+            }
+
+            if (!txValid || (tx.data[txOffset++] != data[i]))
+            {
+                mismatches++;
+            }
+        }
+
+        bytesWritten += length;
+        lastWrite_uS = platform::micros();
+    }
+
+    bool XBReplaySerial::waitForData(size_t timeout_mS)
+    {
+        uint64_t deadline = platform::micros() + ((uint64_t)timeout_mS * 1000);
+
+        while (!available())
+        {
+            uint64_t now = platform::micros();
+            if ((int64_t)(now - deadline) >= 0)
+            {
+                return false;
+            }
+
+            /* With nothing left, or nothing until the driver writes again, sit out the timeout like an idle port */
+            uint64_t until = deadline;
+            if (rxValid && gateOpen() && ((int64_t)(due_uS() - deadline) < 0))
+            {
+                until = due_uS();
+            }
+
+            uint64_t wait_mS = (until > now) ? ((until - now + 999) / 1000) : 1;
+
+            platform::delayMilliseconds((size_t)wait_mS);
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * @file xb_replay_serial.hpp
+ */
+
+#ifndef XBEE_REPLAY_SERIAL_HPP
+#define XBEE_REPLAY_SERIAL_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(XBEE_PLATFORM_POSIX)
+#include <vector>
+#endif
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_serial.hpp>
+#include <libxbee/include/xb_serial_capture.hpp>
+
+namespace libxbee
+{
+    /** How XBReplaySerial paces the received bytes of a capture */
+    enum XBReplayMode : uint8_t
+    {
+        XB_REPLAY_REALTIME,         /**< Each record becomes readable after the same delay it had when it was captured */
+        XB_REPLAY_FAST,             /**< Records are readable as soon as the driver asks for them */
+    };
+
+    /** Replay Transport
+     *  Feeds a capture made with XBSerialCapture back into the driver in place of a real port. Received records are
+     *  handed out in order, either with their original timing or as fast as the driver can read them. What the
+     *  driver writes is compared against the transmitted records of the capture and otherwise discarded.
+     *
+     *  With followWrites set, received data that was captured after a transmission is held back until the driver has
+     *  written at least as many bytes as the capture had sent by then, so responses don't arrive ahead of the commands
+     *  that produce them. In real time mode the delay of such a response is then measured from the driver's write,
+     *  which reproduces the module's response latency rather than the original run's wall clock. Clear followWrites to
+     *  push received traffic through the parser without the driver sending anything, e.g. to benchmark it.
+     *
+     *  The capture isn't copied and must stay valid while it's replayed, unless loadFile() read it in.
+     **/
+    class XBReplaySerial : public XBEESerial
+    {
+    public:
+        /** Sets the capture to replay and rewinds to its start
+         *  @return XB_OK, or XB_BAD_RESPONSE if it isn't a readable capture */
+        XBStatus load(const uint8_t* capture, size_t length);
+
+        #if defined(XBEE_PLATFORM_POSIX)
+        /** Reads a capture file into memory and loads it
+         *  @return XB_OK, XB_NOT_FOUND if the file couldn't be read, or XB_BAD_RESPONSE if it isn't a capture */
+        XBStatus loadFile(const char* path);
+        #endif
+
+        /** Starts the replay over from the first record. Real time pacing counts from here. */
+        void rewind();
+
+        void setMode(XBReplayMode mode) { this->mode = mode; }
+        XBReplayMode getMode() { return mode; }
+
+        /** True once every received record has been read */
+        bool finished();
+
+        void write(uint8_t* data, size_t length) override;
+        size_t read(uint8_t* data, size_t length) override;
+        size_t available() override;
+        bool setBaud(uint32_t baud) override { (void)baud; baudChanges++; return true; }
+
+        /** Sleeps until the next received record is due, in real time mode
+         *  @return True if data is available */
+        bool waitForData(size_t timeout_mS) override;
+
+        bool followWrites = true;       /**< Hold received data until the driver has sent what preceded it */
+
+        size_t bytesReplayed = 0;       /**< Received bytes handed to the driver */
+        size_t bytesWritten = 0;        /**< Bytes the driver wrote */
+        size_t mismatches = 0;          /**< Written bytes that differ from the capture, or go beyond it */
+        size_t baudChanges = 0;         /**< setBaud() calls, which otherwise have no effect */
+
+        XBReplaySerial() = default;
+        ~XBReplaySerial() = default;
+
+    private:
+        XBReplayMode mode = XB_REPLAY_FAST;
+        XBCaptureReader rxReader;       /**< Next received record */
+        XBCaptureReader txReader;       /**< Transmitted records, to check the driver's writes against */
+
+        XBCaptureRecord rx;
+        bool rxValid = false;
+        size_t rxOffset = 0;
+        uint64_t gate_uS = 0;           /**< Capture time of the transmission rx waits on */
+        size_t gateBytes = 0;           /**< Bytes the capture had sent before rx */
+
+        XBCaptureRecord tx;
+        bool txValid = false;
+        size_t txOffset = 0;
+
+        uint64_t start_uS = 0;          /**< When the replay started */
+        uint64_t lastWrite_uS = 0;      /**< When the driver last wrote */
+
+        #if defined(XBEE_PLATFORM_POSIX)
+        std::vector<uint8_t> file;
+        #endif
+
+        /** Moves rx to the next received record, noting the transmissions passed on the way
+         *  @return False at the end of the capture */
+        bool nextRx();
+
+        /** Time rx becomes readable, on the platform::micros() time base */
+        uint64_t due_uS();
+
+        /** True once the driver has written everything that preceded rx */
+        bool gateOpen() { return !followWrites || (bytesWritten >= gateBytes); }
+    };
+}
+
+#endif /* !XBEE_REPLAY_SERIAL_HPP */
@@ -0,0 +1,296 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_request_table.hpp>
+
+
+namespace libxbee
+{
+    bool decodeCompletion(const uint8_t* frame, size_t length, XBCompletion& completion)
+    {
+        if (!frame || (length < 2))
+        {
+            return false;
+        }
+
+        memset(&completion, 0, sizeof(completion));
+        completion.type = static_cast<XBFrameType>(frame[0]);
+        completion.frameID = frame[1];
+        completion.frame = frame;
+        completion.frameLength = length;
+
+        size_t dataStart = 0;
+
+        switch (completion.type)
+        {
+        /* [type][frame id][cmd 0][cmd 1][status][data...] */
+        case XB_FRAME_AT_RESPONSE:
+            if (length < 5)
+            {
+                return false;
+            }
+
+            completion.command[0] = (char)frame[2];
+            completion.command[1] = (char)frame[3];
+            completion.rawStatus = frame[4];
+            completion.status = atResponseStatus(frame[4]);
+            dataStart = 5;
+            break;
+
+        /* [type][frame id][16-bit dest][retries][delivery status][discovery status] */
+        case XB_FRAME_TRANSMIT_STATUS:
+            if (length < 7)
+            {
+                return false;
+            }
+
+            completion.address16 = (uint16_t)((frame[2] << 8) | frame[3]);
+            completion.retries = frame[4];
+            completion.rawStatus = frame[5];
+            completion.discoveryStatus = frame[6];
+            completion.status = transmitStatus(frame[5]);
+            return true;
+
+        /* [type][frame id][64-bit source][16-bit source][cmd 0][cmd 1][status][data...] */
+        case XB_FRAME_REMOTE_AT_RESPONSE:
+            if (length < 15)
+            {
+                return false;
+            }
+
+            for (size_t i = 0; i < 8; i++)
+            {
+                completion.address64 = (completion.address64 << 8) | frame[2 + i];
+            }
+
+            completion.address16 = (uint16_t)((frame[10] << 8) | frame[11]);
+            completion.command[0] = (char)frame[12];
+            completion.command[1] = (char)frame[13];
+            completion.rawStatus = frame[14];
+            completion.status = atResponseStatus(frame[14]);
+            dataStart = 15;
+            break;
+
+        default:
+            return false;
+        }
+
+        completion.dataLength = length - dataStart;
+        memcpy(completion.data, &frame[dataStart],
+            (completion.dataLength < XB_COMPLETION_DATA_SIZE) ? completion.dataLength : XB_COMPLETION_DATA_SIZE);
+
+        return true;
+    }
+
+    XBRequestTable::XBRequestTable()
+    {
+        clear();
+    }
+
+    void XBRequestTable::clear()
+    {
+        memset(slots, 0, sizeof(slots));
+        pendingCount = 0;
+        transientID = 0;
+    }
+
+    uint8_t XBRequestTable::nextFreeID()
+    {
+        /* Round robin through the ID space so a late response to an expired request is unlikely to hit a new one */
+        uint8_t id = lastFrameID;
+
+        for (size_t attempt = 0; attempt < 255; attempt++)
+        {
+            if (++id == 0)
+            {
+                id = 1;
+            }
+
+            if ((id != transientID) && (slots[id % XB_MAX_PENDING_REQUESTS].state == SLOT_FREE))
+            {
+                lastFrameID = id;
+                return id;
+            }
+        }
+
+        return 0;
+    }
+
+    XBStatus XBRequestTable::allocate(XBFrameType expected, const char* command, size_t now_mS, size_t timeout_mS,
+        XBCompletionCallback callback, void* context, XBRequestHandle& handle)
+    {
+        uint8_t id = nextFreeID();
+        if (!id)
+        {
+            return XB_BUFFER_OVERRUN;
+        }
+
+        Slot& slot = slots[id % XB_MAX_PENDING_REQUESTS];
+        slot.state = SLOT_PENDING;
+        slot.expected = expected;
+        slot.frameID = id;
+        slot.sequence = ++nextSequence;
+        slot.command[0] = command ? command[0] : '\0';
+        slot.command[1] = command ? command[1] : '\0';
+        slot.issued_mS = now_mS;
+        slot.deadline_mS = now_mS + timeout_mS;
+        slot.callback = callback;
+        slot.context = context;
+
+        handle.frameID = id;
+        handle.sequence = slot.sequence;
+
+        pendingCount++;
+        return XB_OK;
+    }
+
+    uint8_t XBRequestTable::reserveTransient()
+    {
+        /* Released implicitly by the next reservation, since synchronous requests never overlap */
+        transientID = 0;
+        transientID = nextFreeID();
+        return transientID;
+    }
+
+    XBRequestTable::Slot* XBRequestTable::find(const XBRequestHandle& handle)
+    {
+        if (!handle.valid())
+        {
+            return nullptr;
+        }
+
+        Slot& slot = slots[handle.frameID % XB_MAX_PENDING_REQUESTS];
+        if ((slot.state == SLOT_FREE) || (slot.frameID != handle.frameID) || (slot.sequence != handle.sequence))
+        {
+            return nullptr;
+        }
+
+        return &slot;
+    }
+
+    void XBRequestTable::cancel(const XBRequestHandle& handle)
+    {
+        Slot* slot = find(handle);
+        if (!slot)
+        {
+            return;
+        }
+
+        if (slot->state == SLOT_PENDING)
+        {
+            pendingCount--;
+        }
+
+        slot->state = SLOT_FREE;
+    }
+
+    void XBRequestTable::setObserver(XBCompletionCallback observer, void* context)
+    {
+        this->observer = observer;
+        observerContext = context;
+    }
+
+    bool XBRequestTable::dispatch(const uint8_t* frame, size_t length, size_t now_mS)
+    {
+        XBCompletion completion;
+        if (!decodeCompletion(frame, length, completion))
+        {
+            return false;
+        }
+
+        Slot& slot = slots[completion.frameID % XB_MAX_PENDING_REQUESTS];
+        if ((slot.state != SLOT_PENDING) || (slot.frameID != completion.frameID) || (slot.expected != completion.type))
+        {
+            unmatched++;
+            return false;
+        }
+
+        completions++;
+        completion.elapsed_mS = now_mS - slot.issued_mS;
+        finish(slot, completion);
+        return true;
+    }
+
+    size_t XBRequestTable::expire(size_t now_mS)
+    {
+        size_t expired = 0;
+
+        for (size_t i = 0; (i < XB_MAX_PENDING_REQUESTS) && pendingCount; i++)
+        {
+            Slot& slot = slots[i];
+
+            /* Signed difference so the comparison survives the time base wrapping */
+            if ((slot.state != SLOT_PENDING) || ((long)(now_mS - slot.deadline_mS) < 0))
+            {
+                continue;
+            }
+
+            XBCompletion completion;
+            memset(&completion, 0, sizeof(completion));
+            completion.type = slot.expected;
+            completion.frameID = slot.frameID;
+            completion.status = XB_TIMEOUT;
+            completion.command[0] = slot.command[0];
+            completion.command[1] = slot.command[1];
+            completion.elapsed_mS = now_mS - slot.issued_mS;
+
+            timeouts++;
+            expired++;
+            finish(slot, completion);
+        }
+
+        return expired;
+    }
+
+    void XBRequestTable::finish(Slot& slot, XBCompletion& completion)
+    {
+        pendingCount--;
+
+        if (observer)
+        {
+            observer(completion, observerContext);
+        }
+
+        if (slot.callback)
+        {
+            /* Free the slot first so the callback can issue a follow-up request straight away */
+            XBCompletionCallback callback = slot.callback;
+            void* context = slot.context;
+            slot.state = SLOT_FREE;
+
+            callback(completion, context);
+            return;
+        }
+
+        completion.frame = nullptr;
+        completion.frameLength = 0;
+        slot.completion = completion;
+        slot.state = SLOT_COMPLETE;
+    }
+
+    bool XBRequestTable::isComplete(const XBRequestHandle& handle)
+    {
+        Slot* slot = find(handle);
+        return slot && (slot->state == SLOT_COMPLETE);
+    }
+
+    bool XBRequestTable::isPending(const XBRequestHandle& handle)
+    {
+        Slot* slot = find(handle);
+        return slot && (slot->state == SLOT_PENDING);
+    }
+
+    bool XBRequestTable::take(const XBRequestHandle& handle, XBCompletion& completion)
+    {
+        Slot* slot = find(handle);
+        if (!slot || (slot->state != SLOT_COMPLETE))
+        {
+            return false;
+        }
+
+        completion = slot->completion;
+        slot->state = SLOT_FREE;
+        return true;
+    }
+}
@@ -0,0 +1,183 @@
+/**
+ * @file xb_request_table.hpp
+ */
+
+#ifndef XBEE_REQUEST_TABLE_HPP
+#define XBEE_REQUEST_TABLE_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_api_frame.hpp>
+
+/** Most requests that can be in flight at once. 255 covers the whole frame ID space, smaller values save RAM on
+ *  targets that never pipeline that deep. */
+#ifndef XB_MAX_PENDING_REQUESTS
+#if defined(XBEE_PLATFORM_POSIX)
+#define XB_MAX_PENDING_REQUESTS 255
+#else
+#define XB_MAX_PENDING_REQUESTS 32
+#endif
+#endif
+
+/** Response data kept with a completion that is collected later instead of through a callback. Enough for any
+ *  register value, longer responses are truncated. */
+#ifndef XB_COMPLETION_DATA_SIZE
+#define XB_COMPLETION_DATA_SIZE 8
+#endif
+
+namespace libxbee
+{
+    /** Identifies one asynchronous request. The sequence number tells a recycled frame ID apart from the original. */
+    struct XBRequestHandle
+    {
+        uint8_t frameID = 0;
+        uint16_t sequence = 0;
+
+        bool valid() const { return frameID != 0; }
+    };
+
+    /** Outcome of an asynchronous request, decoded from its 0x88, 0x8B or 0x97 response */
+    struct XBCompletion
+    {
+        XBFrameType type;               /**< Response frame type, or the request's expected type if it timed out */
+        uint8_t frameID;
+        XBStatus status;                /**< XB_OK, XB_TIMEOUT, or the mapped AT/delivery status */
+        uint8_t rawStatus;              /**< AT command status or delivery status byte as sent by the module */
+
+        char command[3];                /**< AT command code (0x88, 0x97) */
+        uint64_t address64;             /**< Responding node (0x97) */
+        uint16_t address16;             /**< Responding (0x97) or destination (0x8B) network address */
+        uint8_t retries;                /**< Transmit retry count (0x8B) */
+        uint8_t discoveryStatus;        /**< Route/address discovery overhead (0x8B) */
+        size_t elapsed_mS;              /**< Time from allocate() until the response arrived or the request expired */
+
+        uint8_t data[XB_COMPLETION_DATA_SIZE];
+        size_t dataLength;              /**< Bytes of response data, may be larger than what fit in data */
+
+        const uint8_t* frame;           /**< Full response frame data. Only valid inside a completion callback. */
+        size_t frameLength;
+    };
+
+    /** Called from the receive dispatcher once a request completes or times out */
+    typedef void (*XBCompletionCallback)(const XBCompletion& completion, void* context);
+
+    /** Called from the receive dispatcher for every frame that isn't a response to an outstanding request */
+    typedef void (*XBFrameCallback)(const uint8_t* frame, size_t length, void* context);
+
+    /** Frame ID Correlation Table
+     *  Tracks the requests that are waiting on a response and hands out frame IDs that aren't in use. Responses are
+     *  matched purely by frame ID, so any number of requests up to XB_MAX_PENDING_REQUESTS can be outstanding at once.
+     *  A completed request is either reported through its callback and released straight away, or parked until the
+     *  owner collects it with take().
+     *
+     *  Slots are found by frame ID modulo the table size, so no lookup ever searches.
+     **/
+    class XBRequestTable
+    {
+    public:
+        /** Reserves a frame ID for a new request
+         *
+         *  @param[in]  expected    Response frame type that completes the request
+         *  @param[in]  command     AT command code the request carries, or nullptr. Reported with a timeout, which
+         *                          has no response to take it from.
+         *  @param[in]  now_mS      Current time, on the caller's millisecond time base
+         *  @param[in]  timeout_mS  How long the request may wait for its response
+         *  @param[in]  callback    Completion callback, or nullptr to collect the result with take()
+         *  @param[in]  context     Passed through to the callback
+         *  @param[out] handle      Identifies the request afterwards
+         *  @return     XBStatus    XB_OK, or XB_BUFFER_OVERRUN if every usable frame ID is taken
+         **/
+        XBStatus allocate(XBFrameType expected, const char* command, size_t now_mS, size_t timeout_mS,
+            XBCompletionCallback callback, void* context, XBRequestHandle& handle);
+
+        /** Releases a request without reporting it, e.g. one that was never sent or whose callback context is about to
+         *  go away. A response that arrives later counts as unmatched. */
+        void cancel(const XBRequestHandle& handle);
+
+        /** Returns a frame ID that no outstanding request is using, for responses the caller waits on itself */
+        uint8_t reserveTransient();
+
+        /** Routes a received frame to its request
+         *  @return True if the frame completed an outstanding request */
+        bool dispatch(const uint8_t* frame, size_t length, size_t now_mS);
+
+        /** Completes every request whose deadline has passed with XB_TIMEOUT
+         *  @return Number of requests that expired */
+        size_t expire(size_t now_mS);
+
+        /** True once the request has completed and is waiting to be collected */
+        bool isComplete(const XBRequestHandle& handle);
+
+        /** True while the request is waiting on its response */
+        bool isPending(const XBRequestHandle& handle);
+
+        /** Collects a completed request and frees its slot
+         *  @return False if the request hasn't completed or the handle is stale */
+        bool take(const XBRequestHandle& handle, XBCompletion& completion);
+
+        /** Number of requests waiting on a response */
+        size_t pending() { return pendingCount; }
+
+        /** Drops every request without reporting it, e.g. after the module was reset */
+        void clear();
+
+        /** Sets a callback that sees every completion, timeouts included, before the request's own callback or
+         *  take(). Used by the driver to keep its statistics. */
+        void setObserver(XBCompletionCallback observer, void* context);
+
+        size_t completions = 0;         /**< Requests completed by a response */
+        size_t timeouts = 0;            /**< Requests that expired */
+        size_t unmatched = 0;           /**< Responses whose frame ID didn't belong to an outstanding request */
+
+        XBRequestTable();
+        ~XBRequestTable() = default;
+
+    private:
+        enum SlotState : uint8_t
+        {
+            SLOT_FREE,
+            SLOT_PENDING,
+            SLOT_COMPLETE,
+        };
+
+        struct Slot
+        {
+            SlotState state;
+            XBFrameType expected;
+            uint8_t frameID;
+            uint16_t sequence;
+            char command[2];
+            size_t issued_mS;
+            size_t deadline_mS;
+            XBCompletionCallback callback;
+            void* context;
+            XBCompletion completion;
+        };
+
+        Slot slots[XB_MAX_PENDING_REQUESTS];
+        size_t pendingCount = 0;
+        uint8_t lastFrameID = 0;
+        uint16_t nextSequence = 0;
+        uint8_t transientID = 0;        /**< Frame ID of the last synchronous request, kept off the async ID list */
+        XBCompletionCallback observer = nullptr;
+        void* observerContext = nullptr;
+
+        /** Picks the next frame ID whose slot is free */
+        uint8_t nextFreeID();
+
+        Slot* find(const XBRequestHandle& handle);
+
+        /** Stores or reports a completion and frees the slot if it was reported */
+        void finish(Slot& slot, XBCompletion& completion);
+    };
+
+    /** Decodes an AT Command Response, Transmit Status or Remote AT Command Response frame
+     *  @return False if the frame isn't one of those types or is too short */
+    bool decodeCompletion(const uint8_t* frame, size_t length, XBCompletion& completion);
+}
+
+#endif /* !XBEE_REQUEST_TABLE_HPP */
@@ -0,0 +1,137 @@
+/**
+ * @file xb_ring_buffer.hpp
+ */
+
+#ifndef XBEE_RING_BUFFER_HPP
+#define XBEE_RING_BUFFER_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace libxbee
+{
+    /** Lock-free Single Producer / Single Consumer Byte Ring
+     *  One context (typically the RX interrupt or DMA complete callback) pushes bytes while another (the parser thread)
+     *  pops them. Each index is only ever written by one side, so no locks or critical sections are needed. The capacity
+     *  must be a power of two so wrapping is a mask instead of a division, and the indices are free running so the full
+     *  capacity is usable.
+     *
+     *  Bytes that don't fit are dropped and counted rather than overwriting unread data.
+     *
+     *  @tparam Capacity    Size of the ring in bytes. Must be a power of two.
+     **/
+    template<size_t Capacity>
+    class XBRingBuffer
+    {
+        static_assert((Capacity != 0) && ((Capacity & (Capacity - 1)) == 0), "Ring buffer capacity must be a power of two");
+
+    public:
+        /** Producer side: copies as many bytes as fit into the ring
+         *
+         *  @param[in]  data        Bytes to add
+         *  @param[in]  length      Number of bytes in data
+         *  @return     size_t      Number of bytes actually added
+         **/
+        size_t push(const uint8_t* data, size_t length)
+        {
+            size_t head = this->head.load(std::memory_order_relaxed);
+            size_t tail = this->tail.load(std::memory_order_acquire);
+            size_t used = head - tail;
+            size_t free = Capacity - used;
+            size_t count = (length < free) ? length : free;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                buffer[(head + i) & (Capacity - 1)] = data[i];
+            }
+
+            this->head.store(head + count, std::memory_order_release);
+
+            if ((used + count) > highWater)
+            {
+                highWater = used + count;
+            }
+
+            if (count < length)
+            {
+                dropped += (length - count);
+            }
+
+            return count;
+        }
+
+        /** Consumer side: copies up to length bytes out of the ring
+         *
+         *  @param[out] data        Destination buffer
+         *  @param[in]  length      Size of data
+         *  @return     size_t      Number of bytes copied
+         **/
+        size_t pop(uint8_t* data, size_t length)
+        {
+            size_t tail = this->tail.load(std::memory_order_relaxed);
+            size_t head = this->head.load(std::memory_order_acquire);
+            size_t used = head - tail;
+            size_t count = (length < used) ? length : used;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                data[i] = buffer[(tail + i) & (Capacity - 1)];
+            }
+
+            this->tail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        /** Consumer side: discards everything currently in the ring */
+        void flush()
+        {
+            tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+        /** Number of bytes waiting to be read */
+        size_t size() const
+        {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        static constexpr size_t capacity()
+        {
+            return Capacity;
+        }
+
+        /** Largest number of bytes that have been waiting in the ring at once */
+        size_t highWaterMark() const
+        {
+            return highWater;
+        }
+
+        /** Number of bytes dropped because the ring was full */
+        size_t overruns() const
+        {
+            return dropped;
+        }
+
+        /** Clears the statistics. Only call this from the producer context or while the producer is idle. */
+        void resetStats()
+        {
+            highWater = 0;
+            dropped = 0;
+        }
+
+        XBRingBuffer() = default;
+        ~XBRingBuffer() = default;
+
+    private:
+        std::atomic<size_t> head{ 0 };     /**< Free running write index, only modified by the producer */
+        std::atomic<size_t> tail{ 0 };     /**< Free running read index, only modified by the consumer */
+
+        size_t highWater = 0;
+        size_t dropped = 0;
+
+        uint8_t buffer[Capacity];
+    };
+}
+
+#endif /* !XBEE_RING_BUFFER_HPP */
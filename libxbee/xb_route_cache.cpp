@@ -0,0 +1,63 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_route_cache.hpp>
+
+
+namespace libxbee
+{
+    bool XBRouteCache::record(const uint8_t* frame, size_t length, size_t now_mS)
+    {
+        /* [0xA1][64-bit source][16-bit source][options][number of hops][hops...] */
+        if (!frame || (length < XB_ROUTE_RECORD_HEADER_SIZE) || (frame[0] != XB_FRAME_ROUTE_RECORD))
+        {
+            rejected++;
+            return false;
+        }
+
+        uint8_t hops = frame[12];
+        if ((hops > XB_MAX_SOURCE_ROUTE_HOPS) || (length != (XB_ROUTE_RECORD_HEADER_SIZE + (2 * (size_t)hops))))
+        {
+            rejected++;
+            return false;
+        }
+
+        uint64_t address64 = 0;
+        for (size_t i = 0; i < 8; i++)
+        {
+            address64 = (address64 << 8) | frame[1 + i];
+        }
+
+        bool created = false;
+        XBSourceRoute* route = insert(address64, created);
+
+        route->address16 = (uint16_t)((frame[9] << 8) | frame[10]);
+        route->hops = hops;
+        memcpy(route->path, &frame[XB_ROUTE_RECORD_HEADER_SIZE], 2 * (size_t)hops);
+        route->lastSeen_mS = now_mS;
+
+        records++;
+        return true;
+    }
+
+    const XBSourceRoute* XBRouteCache::lookup(uint64_t address64, size_t now_mS)
+    {
+        XBSourceRoute* route = find(address64);
+
+        if (route && ((now_mS - route->lastSeen_mS) >= maxAge_mS))
+        {
+            remove(address64);
+            route = nullptr;
+        }
+
+        if (!route)
+        {
+            misses++;
+            return nullptr;
+        }
+
+        hits++;
+        return route;
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * @file xb_route_cache.hpp
+ */
+
+#ifndef XBEE_ROUTE_CACHE_HPP
+#define XBEE_ROUTE_CACHE_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_api_frame.hpp>
+#include <libxbee/include/xb_address_table.hpp>
+
+/** Hash slots in the route cache, a power of two. Three quarters of them are usable. */
+#ifndef XB_ROUTE_CACHE_SIZE
+#if defined(XBEE_PLATFORM_POSIX)
+#define XB_ROUTE_CACHE_SIZE 512
+#else
+#define XB_ROUTE_CACHE_SIZE 16
+#endif
+#endif
+
+/** Longest source route kept. Every hop takes two bytes off the RF payload (ATNP) of a source routed transmission. */
+#ifndef XB_MAX_SOURCE_ROUTE_HOPS
+#define XB_MAX_SOURCE_ROUTE_HOPS 11
+#endif
+
+/** How long a route record is trusted. Many-to-one route requests (ATAR) should refresh routes well within this. */
+#ifndef XB_ROUTE_MAX_AGE_mS
+#define XB_ROUTE_MAX_AGE_mS ((size_t)300000)
+#endif
+
+namespace libxbee
+{
+    /** Path from this node to a remote one, as reported by its Route Record Indicator (0xA1) */
+    struct XBSourceRoute
+    {
+        uint64_t address64;
+        uint16_t address16;                             /**< Destination network address */
+        uint8_t hops;                                   /**< Intermediate routers, 0 for a neighbor */
+        uint8_t path[2 * XB_MAX_SOURCE_ROUTE_HOPS];     /**< Big-endian router addresses, destination's neighbor first */
+        size_t lastSeen_mS;                             /**< When the route record arrived */
+
+        /** Network address of the given hop, 0 being the destination's neighbor */
+        uint16_t hop(size_t index) const { return (uint16_t)((path[2 * index] << 8) | path[(2 * index) + 1]); }
+    };
+
+    /** Source Route Cache
+     *  Keeps the latest route record of every node that reported one, hashed by 64-bit address (see XBAddressTable).
+     *  Routers send a route record along with their first packet after each many-to-one route request, so a
+     *  coordinator that hands these routes back to the module with Create Source Route (0x21) can reach any router
+     *  without a route discovery. Routes older than maxAge_mS aren't used.
+     **/
+    class XBRouteCache : public XBAddressTable<XBSourceRoute, XB_ROUTE_CACHE_SIZE>
+    {
+    public:
+        /** Stores the route carried by a Route Record Indicator (0xA1) frame
+         *  @return False if the frame is malformed or the route is longer than XB_MAX_SOURCE_ROUTE_HOPS */
+        bool record(const uint8_t* frame, size_t length, size_t now_mS);
+
+        /** Looks up a route that isn't older than maxAge_mS. A stale route is dropped.
+         *  @return The route, or nullptr if there is no usable one */
+        const XBSourceRoute* lookup(uint64_t address64, size_t now_mS);
+
+        size_t maxAge_mS = XB_ROUTE_MAX_AGE_mS;
+
+        size_t records = 0;             /**< Route records stored */
+        size_t rejected = 0;            /**< Route records that were malformed or too long */
+        size_t hits = 0;                /**< lookup() calls that found a usable route */
+        size_t misses = 0;              /**< lookup() calls that didn't */
+        size_t installs = 0;            /**< Routes handed to the module with Create Source Route */
+    };
+}
+
+#endif /* !XBEE_ROUTE_CACHE_HPP */
@@ -3,18 +3,172 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/** Size of the stack buffer used to coalesce spans when a backend can't gather */
+#ifndef XB_SERIAL_GATHER_BUFFER_SIZE
+#define XB_SERIAL_GATHER_BUFFER_SIZE 64
+#endif
 
 namespace libxbee
 {
+	/** Receive statistics for a backend's ring buffer */
+	struct XBSerialRxStats
+	{
+		size_t highWaterMark;		/**< Most bytes ever waiting in the ring at once */
+		size_t overruns;			/**< Bytes dropped because the ring was full */
+		size_t packetErrors;		/**< Reads the underlying driver failed to hand over */
+	};
+
+	/** Hardware flow control statistics */
+	struct XBFlowStats
+	{
+		size_t throttleEvents;		/**< Times a write had to wait because the module deasserted CTS */
+		size_t throttled_mS;		/**< Total time writes spent waiting on CTS */
+		size_t rxHoldoffs;			/**< Times RTS was deasserted because the receive ring was full */
+		size_t txDropped;			/**< Bytes discarded because the port stayed blocked past its write timeout */
+	};
+
+	/** A contiguous piece of a larger transfer */
+	struct XBSpan
+	{
+		const uint8_t* data;
+		size_t length;
+	};
+
 	class XBEESerial
 	{
 	public:
 		virtual void write(uint8_t* data, size_t length) = 0;
-		virtual void read(uint8_t* data, size_t length) = 0;
+
+		/** Vectored write
+		 *	Sends several non-contiguous spans as one transfer, so a frame's header, payload and checksum don't have to be
+		 *	copied together first. Backends that can gather override this. The default coalesces the spans into a small
+		 *	stack buffer and writes it out in chunks.
+		 *
+		 *	@param[in]	spans		The pieces to send, in order
+		 *	@param[in]	count		Number of spans
+		 **/
+		virtual void writev(const XBSpan* spans, size_t count)
+		{
+			uint8_t scratch[XB_SERIAL_GATHER_BUFFER_SIZE];
+			size_t used = 0;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const uint8_t* data = spans[i].data;
+				size_t remaining = spans[i].length;
+
+				while (remaining)
+				{
+					size_t chunk = sizeof(scratch) - used;
+					chunk = (remaining < chunk) ? remaining : chunk;
+
+					memcpy(scratch + used, data, chunk);
+					used += chunk;
+					data += chunk;
+					remaining -= chunk;
+
+					if (used == sizeof(scratch))
+					{
+						write(scratch, used);
+						used = 0;
+					}
+				}
+			}
+
+			if (used)
+			{
+				write(scratch, used);
+			}
+		}
+
+		/** Reads whatever has been received, up to length bytes. Never blocks.
+		 *	@return Number of bytes copied into data */
+		virtual size_t read(uint8_t* data, size_t length) = 0;
+
+		/** Number of received bytes waiting to be read */
+		virtual size_t available() = 0;
+
+		/** Changes the baud rate of the local serial port
+		 *	@return False if the port couldn't be switched to the rate */
+		virtual bool setBaud(uint32_t baud) = 0;
+
+		/** Sleeps until received data is waiting or the timeout expires. Backends that can't block return straight away
+		 *	and leave the caller to poll.
+		 *	@return True if data is available */
+		virtual bool waitForData(size_t timeout_mS)
+		{
+			(void)timeout_mS;
+			return available() != 0;
+		}
+
+		/** Enables or disables RTS/CTS hardware flow control on the local port
+		 *	@return False if the backend can't do flow control */
+		virtual bool setFlowControl(bool enabled)
+		{
+			return !enabled;
+		}
+
+		/** Flow control statistics. All zero if the backend doesn't keep any. */
+		virtual XBFlowStats flowStats()
+		{
+			XBFlowStats stats = { 0, 0, 0, 0 };
+			return stats;
+		}
+
+		/** Clears the flow control statistics */
+		virtual void resetFlowStats()
+		{
+		}
+
+		/** Receive statistics of the backend's ring buffer. All zero if the backend doesn't keep any. */
+		virtual XBSerialRxStats rxStats()
+		{
+			XBSerialRxStats stats = { 0, 0, 0 };
+			return stats;
+		}
+
+		virtual ~XBEESerial() = default;
 
 	private:
 
 	};
+
+	/** Static Transport Dispatch
+	 *	Routes the calls a driver makes for every frame (write, writev, read, available, waitForData) to the backend by
+	 *	their qualified name. For a concrete backend they are bound at compile time and can be inlined, skipping the vtable. For
+	 *	XBEESerial itself, which is abstract, they stay virtual so any backend can be plugged in at run time.
+	 *
+	 *	A driver built for a concrete backend has to be handed exactly that type: overrides in a class derived from it
+	 *	are bypassed.
+	 *
+	 *	@tparam	Transport	The backend type the driver was built for
+	 **/
+	template<typename Transport, bool Dynamic = std::is_abstract<Transport>::value>
+	struct XBSerialIO
+	{
+		static_assert(std::is_base_of<XBEESerial, Transport>::value, "Transport must implement XBEESerial");
+
+		static void write(Transport& port, uint8_t* data, size_t length) { port.Transport::write(data, length); }
+		static void writev(Transport& port, const XBSpan* spans, size_t count) { port.Transport::writev(spans, count); }
+		static size_t read(Transport& port, uint8_t* data, size_t length) { return port.Transport::read(data, length); }
+		static size_t available(Transport& port) { return port.Transport::available(); }
+		static bool waitForData(Transport& port, size_t timeout_mS) { return port.Transport::waitForData(timeout_mS); }
+	};
+
+	template<typename Transport>
+	struct XBSerialIO<Transport, true>
+	{
+		static_assert(std::is_base_of<XBEESerial, Transport>::value, "Transport must implement XBEESerial");
+
+		static void write(Transport& port, uint8_t* data, size_t length) { port.write(data, length); }
+		static void writev(Transport& port, const XBSpan* spans, size_t count) { port.writev(spans, count); }
+		static size_t read(Transport& port, uint8_t* data, size_t length) { return port.read(data, length); }
+		static size_t available(Transport& port) { return port.available(); }
+		static bool waitForData(Transport& port, size_t timeout_mS) { return port.waitForData(timeout_mS); }
+	};
 }
 
 
@@ -0,0 +1,278 @@
+/* C/C++ Includes */
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_serial_capture.hpp>
+#include <libxbee/include/xb_platform.hpp>
+
+
+namespace libxbee
+{
+    static const uint8_t captureMagic[] = { 'X', 'B', 'C', 'P' };
+
+    /** Appends value as a LEB128 varint
+     *  @return Bytes written, at most 10 */
+    static size_t encodeVarint(uint64_t value, uint8_t* out)
+    {
+        size_t used = 0;
+
+        do
+        {
+            uint8_t byte = value & 0x7F;
+            value >>= 7;
+            out[used++] = byte | (value ? 0x80 : 0);
+        } while (value);
+
+        return used;
+    }
+
+    XBStatus XBCaptureReader::open(const uint8_t* capture, size_t length)
+    {
+        if (!capture || (length < XB_CAPTURE_HEADER_SIZE) || memcmp(capture, captureMagic, sizeof(captureMagic)) ||
+            (capture[sizeof(captureMagic)] != XB_CAPTURE_VERSION))
+        {
+            this->capture = nullptr;
+            this->length = 0;
+            return XB_BAD_RESPONSE;
+        }
+
+        this->capture = capture;
+        this->length = length;
+        rewind();
+        return XB_OK;
+    }
+
+    void XBCaptureReader::rewind()
+    {
+        position = XB_CAPTURE_HEADER_SIZE;
+        time_uS = 0;
+        damaged = false;
+    }
+
+    bool XBCaptureReader::readVarint(uint64_t& value)
+    {
+        value = 0;
+
+        for (size_t shift = 0; (shift < 64) && (position < length); shift += 7)
+        {
+            uint8_t byte = capture[position++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool XBCaptureReader::next(XBCaptureRecord& record)
+    {
+        if (!capture || damaged || (position >= length))
+        {
+            return false;
+        }
+
+        uint8_t tag = capture[position++];
+        uint64_t delta = 0;
+        uint64_t size = 0;
+
+        if ((tag > XB_CAPTURE_BAUD) || !readVarint(delta) || !readVarint(size) || (size > (length - position)))
+        {
+            damaged = true;
+            return false;
+        }
+
+        time_uS += delta;
+
+        record.tag = static_cast<XBCaptureTag>(tag);
+        record.time_uS = time_uS;
+        record.data = &capture[position];
+        record.length = (size_t)size;
+
+        position += (size_t)size;
+        return true;
+    }
+
+    XBSerialCapture::~XBSerialCapture()
+    {
+        stop();
+    }
+
+    XBStatus XBSerialCapture::start(XBCaptureWriter writer, void* context)
+    {
+        if (!writer)
+        {
+            return XB_INVALID_PARAM;
+        }
+
+        stop();
+        begin(writer, context);
+        return XB_OK;
+    }
+
+    void XBSerialCapture::begin(XBCaptureWriter writer, void* context)
+    {
+        this->writer = writer;
+        writerContext = context;
+        start_uS = platform::micros();
+        lastRecord_uS = 0;
+        pendingLength = 0;
+        bytesIn = 0;
+        bytesOut = 0;
+        records = 0;
+        logBytes = 0;
+
+        uint8_t header[XB_CAPTURE_HEADER_SIZE] = { 0 };
+        memcpy(header, captureMagic, sizeof(captureMagic));
+        header[sizeof(captureMagic)] = XB_CAPTURE_VERSION;
+        emit(header, sizeof(header));
+    }
+
+    #if defined(XBEE_PLATFORM_POSIX)
+    XBStatus XBSerialCapture::open(const char* path)
+    {
+        stop();
+
+        file = path ? fopen(path, "wb") : nullptr;
+        if (!file)
+        {
+            return XB_NOT_FOUND;
+        }
+
+        begin(&XBSerialCapture::writeFile, file);
+        return XB_OK;
+    }
+
+    void XBSerialCapture::writeFile(const uint8_t* data, size_t length, void* context)
+    {
+        fwrite(data, 1, length, static_cast<FILE*>(context));
+    }
+    #endif
+
+    void XBSerialCapture::stop()
+    {
+        flush();
+        writer = nullptr;
+        writerContext = nullptr;
+
+        #if defined(XBEE_PLATFORM_POSIX)
+        if (file)
+        {
+            fclose(file);
+            file = nullptr;
+        }
+        #endif
+    }
+
+    void XBSerialCapture::flush()
+    {
+        closeRecord();
+
+        #if defined(XBEE_PLATFORM_POSIX)
+        if (file)
+        {
+            fflush(file);
+        }
+        #endif
+    }
+
+    void XBSerialCapture::closeRecord()
+    {
+        if (!writer || !pendingLength)
+        {
+            return;
+        }
+
+        uint8_t header[XB_CAPTURE_RECORD_HEADER_MAX];
+        size_t used = 0;
+
+        header[used++] = pendingTag;
+        used += encodeVarint(pending_uS - lastRecord_uS, &header[used]);
+        used += encodeVarint(pendingLength, &header[used]);
+
+        emit(header, used);
+        emit(pending, pendingLength);
+
+        lastRecord_uS = pending_uS;
+        pendingLength = 0;
+        records++;
+    }
+
+    void XBSerialCapture::emit(const uint8_t* data, size_t length)
+    {
+        writer(data, length, writerContext);
+        logBytes += length;
+    }
+
+    void XBSerialCapture::record(XBCaptureTag tag, const uint8_t* data, size_t length)
+    {
+        if (!writer || !length)
+        {
+            return;
+        }
+
+        uint64_t now = platform::micros() - start_uS;
+
+        while (length)
+        {
+            bool fits = pendingLength && (pendingTag == tag) && (pendingLength < sizeof(pending)) &&
+                ((now - pending_uS) <= XB_CAPTURE_COALESCE_uS);
+
+            if (!fits)
+            {
+                closeRecord();
+                pendingTag = tag;
+                pending_uS = now;
+            }
+
+            size_t chunk = sizeof(pending) - pendingLength;
+            chunk = (length < chunk) ? length : chunk;
+
+            memcpy(&pending[pendingLength], data, chunk);
+            pendingLength += chunk;
+            data += chunk;
+            length -= chunk;
+        }
+    }
+
+    void XBSerialCapture::write(uint8_t* data, size_t length)
+    {
+        record(XB_CAPTURE_TX, data, length);
+        bytesOut += length;
+        transport.write(data, length);
+    }
+
+    void XBSerialCapture::writev(const XBSpan* spans, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            record(XB_CAPTURE_TX, spans[i].data, spans[i].length);
+            bytesOut += spans[i].length;
+        }
+
+        transport.writev(spans, count);
+    }
+
+    size_t XBSerialCapture::read(uint8_t* data, size_t length)
+    {
+        size_t count = transport.read(data, length);
+
+        record(XB_CAPTURE_RX, data, count);
+        bytesIn += count;
+        return count;
+    }
+
+    bool XBSerialCapture::setBaud(uint32_t baud)
+    {
+        const uint8_t value[] = { (uint8_t)(baud >> 24), (uint8_t)(baud >> 16), (uint8_t)(baud >> 8), (uint8_t)baud };
+
+        /* Kept as a record of its own, so it can't be merged with a neighbour */
+        closeRecord();
+        record(XB_CAPTURE_BAUD, value, sizeof(value));
+        closeRecord();
+
+        return transport.setBaud(baud);
+    }
+}
@@ -0,0 +1,184 @@
+/**
+ * @file xb_serial_capture.hpp
+ */
+
+#ifndef XBEE_SERIAL_CAPTURE_HPP
+#define XBEE_SERIAL_CAPTURE_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(XBEE_PLATFORM_POSIX)
+#include <stdio.h>
+#endif
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_serial.hpp>
+
+/** Most bytes merged into one capture record. Longer bursts are split over several records. */
+#ifndef XB_CAPTURE_RECORD_SIZE
+#if defined(XBEE_PLATFORM_POSIX)
+#define XB_CAPTURE_RECORD_SIZE 256
+#else
+#define XB_CAPTURE_RECORD_SIZE 64
+#endif
+#endif
+
+/** Bytes moving the same way within this long of the first one are merged into its record. This is what keeps the
+ *  byte-at-a-time reads of the AT mode parser from costing a record header each. */
+#ifndef XB_CAPTURE_COALESCE_uS
+#define XB_CAPTURE_COALESCE_uS 1000
+#endif
+
+#define XB_CAPTURE_VERSION          1
+#define XB_CAPTURE_HEADER_SIZE      8       /**< "XBCP", version, three reserved bytes */
+
+/* Largest encoded record header: the tag plus two 10 byte varints */
+#define XB_CAPTURE_RECORD_HEADER_MAX 21
+
+namespace libxbee
+{
+    /** What a capture record holds */
+    enum XBCaptureTag : uint8_t
+    {
+        XB_CAPTURE_RX   = 0,        /**< Bytes the driver read */
+        XB_CAPTURE_TX   = 1,        /**< Bytes the driver wrote */
+        XB_CAPTURE_BAUD = 2,        /**< Baud rate change, 4 bytes big-endian */
+    };
+
+    /** One decoded capture record */
+    struct XBCaptureRecord
+    {
+        XBCaptureTag tag;
+        uint64_t time_uS;           /**< Time of the first byte, from the start of the capture */
+        const uint8_t* data;        /**< Points into the capture */
+        size_t length;
+    };
+
+    /** Receives the encoded capture as it's produced, e.g. to append it to a file or a RAM buffer */
+    typedef void (*XBCaptureWriter)(const uint8_t* data, size_t length, void* context);
+
+    /** Walks the records of a capture held in memory
+     *
+     *  The log is a XB_CAPTURE_HEADER_SIZE byte header followed by records of
+     *      [tag][time since the previous record in uS, LEB128][length, LEB128][data...]
+     *  so a record of a few bytes costs three bytes of overhead.
+     **/
+    class XBCaptureReader
+    {
+    public:
+        /** Checks the header and rewinds to the first record
+         *  @return XB_OK, or XB_BAD_RESPONSE if this isn't a capture this version can read */
+        XBStatus open(const uint8_t* capture, size_t length);
+
+        /** Decodes the next record
+         *  @return False at the end of the capture, or if the rest of it is truncated */
+        bool next(XBCaptureRecord& record);
+
+        /** Goes back to the first record */
+        void rewind();
+
+        /** True if decoding stopped at a truncated or malformed record rather than the end */
+        bool truncated() { return damaged; }
+
+    private:
+        const uint8_t* capture = nullptr;
+        size_t length = 0;
+        size_t position = 0;
+        uint64_t time_uS = 0;
+        bool damaged = false;
+
+        bool readVarint(uint64_t& value);
+    };
+
+    /** Serial Capture Tap
+     *  Sits between the driver and its real transport and logs every byte that passes in either direction, with a
+     *  monotonic microsecond timestamp, in the compact format read by XBCaptureReader. The log can be fed back through
+     *  XBReplaySerial to benchmark the receive path on real field traffic or to reproduce a latency problem without the
+     *  hardware.
+     *
+     *  Received bytes are stamped when the driver reads them, which is also when the driver first sees them. The tap
+     *  has no lock, so like the driver itself it expects to be used from a single thread; the transport underneath
+     *  may still fill its ring from its own reader thread.
+     *
+     *  @code
+     *  XBSerialCapture tap(serial);
+     *  tap.open("field.xbcap");
+     *  XBEEProS2 xbee(&tap, 115200);
+     *  @endcode
+     **/
+    class XBSerialCapture : public XBEESerial
+    {
+    public:
+        /** Starts a new capture, handing the encoded log to writer as it's produced
+         *  @return XB_OK, or XB_INVALID_PARAM without a writer */
+        XBStatus start(XBCaptureWriter writer, void* context = nullptr);
+
+        #if defined(XBEE_PLATFORM_POSIX)
+        /** Starts a new capture into a file, replacing it if it exists
+         *  @return XB_OK, or XB_NOT_FOUND if the file couldn't be created */
+        XBStatus open(const char* path);
+        #endif
+
+        /** Writes out the record being collected and ends the capture. Closes the file if open() started it. */
+        void stop();
+
+        /** Writes out the record being collected, e.g. before reading the log while the capture is still running */
+        void flush();
+
+        bool isCapturing() { return writer != nullptr; }
+
+        void write(uint8_t* data, size_t length) override;
+        void writev(const XBSpan* spans, size_t count) override;
+        size_t read(uint8_t* data, size_t length) override;
+        size_t available() override { return transport.available(); }
+        bool setBaud(uint32_t baud) override;
+        bool waitForData(size_t timeout_mS) override { return transport.waitForData(timeout_mS); }
+        bool setFlowControl(bool enabled) override { return transport.setFlowControl(enabled); }
+        XBFlowStats flowStats() override { return transport.flowStats(); }
+        void resetFlowStats() override { transport.resetFlowStats(); }
+        XBSerialRxStats rxStats() override { return transport.rxStats(); }
+
+        size_t bytesIn = 0;             /**< Received bytes logged */
+        size_t bytesOut = 0;            /**< Transmitted bytes logged */
+        size_t records = 0;             /**< Records written */
+        size_t logBytes = 0;            /**< Size of the log so far, header included */
+
+        explicit XBSerialCapture(XBEESerial& transport) : transport(transport) {}
+        ~XBSerialCapture();
+
+    private:
+        XBEESerial& transport;
+        XBCaptureWriter writer = nullptr;
+        void* writerContext = nullptr;
+
+        #if defined(XBEE_PLATFORM_POSIX)
+        FILE* file = nullptr;
+        static void writeFile(const uint8_t* data, size_t length, void* context);
+        #endif
+
+        uint64_t start_uS = 0;
+        uint64_t lastRecord_uS = 0;     /**< Capture time of the last record written */
+
+        /* The record still being collected */
+        XBCaptureTag pendingTag = XB_CAPTURE_RX;
+        uint64_t pending_uS = 0;
+        uint8_t pending[XB_CAPTURE_RECORD_SIZE];
+        size_t pendingLength = 0;
+
+        /** Resets the counters and writes the log header */
+        void begin(XBCaptureWriter writer, void* context);
+
+        /** Adds bytes to the open record, or closes it and starts another if they don't belong to it */
+        void record(XBCaptureTag tag, const uint8_t* data, size_t length);
+
+        /** Encodes the record being collected and hands it to the writer */
+        void closeRecord();
+
+        void emit(const uint8_t* data, size_t length);
+    };
+}
+
+#endif /* !XBEE_SERIAL_CAPTURE_HPP */
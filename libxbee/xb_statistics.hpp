@@ -0,0 +1,292 @@
+/**
+ * @file xb_statistics.hpp
+ */
+
+#ifndef XBEE_STATISTICS_HPP
+#define XBEE_STATISTICS_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_api_frame.hpp>
+
+/** Set to 0 to compile the driver statistics out entirely. Every recording call then becomes an empty inline function
+ *  and XBStatistics holds no data. */
+#ifndef XB_ENABLE_STATISTICS
+#define XB_ENABLE_STATISTICS 1
+#endif
+
+/** Distinct commands that get their own latency histogram. Round trips of any further commands are only counted. */
+#ifndef XB_STATS_MAX_COMMANDS
+#if defined(XBEE_PLATFORM_POSIX)
+#define XB_STATS_MAX_COMMANDS 32
+#else
+#define XB_STATS_MAX_COMMANDS 8
+#endif
+#endif
+
+/** Latency histogram buckets. Bucket 0 counts round trips under 1 mS, bucket n those of 2^(n-1) to 2^n - 1 mS, and
+ *  the last one everything longer. */
+#define XB_LATENCY_BUCKETS      12
+
+/** Number of XBStatus values, for tables indexed by statusIndex() */
+#define XB_STATUS_COUNT         ((size_t)(XB_NUMBER_OF_STATUS_KEYS - XB_BUFFER_TOO_SMALL))
+
+namespace libxbee
+{
+    /** Position of a status in XB_STATUS_COUNT sized tables. Anything out of range lands on XB_UNKNOWN_ERROR. */
+    inline size_t statusIndex(XBStatus status)
+    {
+        if ((status < XB_BUFFER_TOO_SMALL) || (status >= XB_NUMBER_OF_STATUS_KEYS))
+        {
+            status = XB_UNKNOWN_ERROR;
+        }
+
+        return (size_t)(status - XB_BUFFER_TOO_SMALL);
+    }
+
+    /** Round trip statistics of one command */
+    struct XBCommandStats
+    {
+        char command[3];                /**< Two character code, empty for transmissions */
+        XBFrameType type;               /**< XB_FRAME_AT_COMMAND for local commands in either mode,
+                                             XB_FRAME_REMOTE_AT_COMMAND or XB_FRAME_TRANSMIT_REQUEST */
+        size_t count;                   /**< Round trips, successful or not */
+        size_t failures;                /**< Round trips that didn't end in XB_OK, timeouts included */
+        size_t timeouts;
+        size_t total_mS;
+        size_t max_mS;
+        uint32_t histogram[XB_LATENCY_BUCKETS];
+
+        size_t average_mS() const { return count ? (total_mS / count) : 0; }
+
+        /** Upper bound of the bucket the given percentile (0-100) of round trips falls in, in mS */
+        size_t percentile_mS(size_t percent) const
+        {
+            size_t wanted = ((count * percent) + 99) / 100;
+            size_t seen = 0;
+
+            for (size_t i = 0; i < XB_LATENCY_BUCKETS; i++)
+            {
+                seen += histogram[i];
+                if (seen && (seen >= wanted))
+                {
+                    return (i < (XB_LATENCY_BUCKETS - 1)) ? (((size_t)1 << i) - 1) : max_mS;
+                }
+            }
+
+            return max_mS;
+        }
+    };
+
+    /** Snapshot of everything the driver counts, see XBEEProS2::getDriverStats() */
+    struct XBDriverStats
+    {
+        size_t results[XB_STATUS_COUNT];            /**< Round trip outcomes, indexed by statusIndex() */
+        XBCommandStats commands[XB_STATS_MAX_COMMANDS];
+        size_t commandCount;                        /**< Entries of commands in use */
+        size_t untracked;                           /**< Round trips of commands that didn't fit in commands */
+
+        size_t commandModeEntries;                  /**< "+++" sequences answered with OK */
+        size_t commandModeFailures;                 /**< "+++" sequences that weren't */
+        size_t guardTime_mS;                        /**< Time spent keeping the line quiet ahead of "+++" */
+
+        size_t rxOverruns;                          /**< Bytes the serial backend dropped because its ring was full */
+        size_t bytesOut;                            /**< Bytes handed to the serial port */
+        size_t bytesIn;                             /**< Bytes read from the serial port */
+        size_t framesOut;                           /**< API frames sent */
+        size_t framesIn;                            /**< API frames received */
+
+        /** Number of round trips that ended with the given status */
+        size_t result(XBStatus status) const { return results[statusIndex(status)]; }
+
+        /** Looks up a command's entry, e.g. find("ATNJ") or find("NJ", XB_FRAME_REMOTE_AT_COMMAND)
+         *  @return The entry, or nullptr if the command was never seen */
+        const XBCommandStats* find(const char* command, XBFrameType type = XB_FRAME_AT_COMMAND) const
+        {
+            command = command ? commandCode(command) : "";
+
+            for (size_t i = 0; command && (i < commandCount); i++)
+            {
+                if ((commands[i].type == type) && !strncmp(commands[i].command, command, 2))
+                {
+                    return &commands[i];
+                }
+            }
+
+            return nullptr;
+        }
+    };
+
+    /** Driver Statistics
+     *  Always-on counters that show where the driver spends its time: outcome counts per status, a latency histogram
+     *  per command, command mode entries and the guard time they cost, and the serial traffic. Recording is a few
+     *  increments and a short search of the command table, so it can stay enabled in production builds. Define
+     *  XB_ENABLE_STATISTICS to 0 to strip it entirely.
+     **/
+    class XBStatistics
+    {
+    public:
+        /** Records one command round trip or asynchronous request
+         *
+         *  @param[in]  type        XB_FRAME_AT_COMMAND, XB_FRAME_REMOTE_AT_COMMAND or XB_FRAME_TRANSMIT_REQUEST
+         *  @param[in]  command     Command code, nullptr for transmissions
+         *  @param[in]  status      Outcome
+         *  @param[in]  elapsed_mS  Time from sending the request until the outcome was known
+         **/
+        void recordCommand(XBFrameType type, const char* command, XBStatus status, size_t elapsed_mS)
+        {
+            #if XB_ENABLE_STATISTICS
+            stats.results[statusIndex(status)]++;
+
+            XBCommandStats* entry = lookup(type, command);
+            if (!entry)
+            {
+                stats.untracked++;
+                return;
+            }
+
+            size_t bucket = 0;
+            while ((bucket < (XB_LATENCY_BUCKETS - 1)) && (elapsed_mS >> bucket))
+            {
+                bucket++;
+            }
+
+            entry->count++;
+            entry->total_mS += elapsed_mS;
+            entry->histogram[bucket]++;
+
+            if (elapsed_mS > entry->max_mS)
+            {
+                entry->max_mS = elapsed_mS;
+            }
+
+            if (status != XB_OK)
+            {
+                entry->failures++;
+                entry->timeouts += (status == XB_TIMEOUT) ? 1 : 0;
+            }
+            #else
+            (void)type; (void)command; (void)status; (void)elapsed_mS;
+            #endif
+        }
+
+        /** Records a "+++" sequence and how long the line had to be held quiet before it */
+        void recordCommandMode(XBStatus result, size_t guard_mS)
+        {
+            #if XB_ENABLE_STATISTICS
+            if (result == XB_OK)
+            {
+                stats.commandModeEntries++;
+            }
+            else
+            {
+                stats.commandModeFailures++;
+            }
+
+            stats.guardTime_mS += guard_mS;
+            #else
+            (void)result; (void)guard_mS;
+            #endif
+        }
+
+        void addBytesOut(size_t count)
+        {
+            #if XB_ENABLE_STATISTICS
+            stats.bytesOut += count;
+            #else
+            (void)count;
+            #endif
+        }
+
+        void addBytesIn(size_t count)
+        {
+            #if XB_ENABLE_STATISTICS
+            stats.bytesIn += count;
+            #else
+            (void)count;
+            #endif
+        }
+
+        void addFrameOut()
+        {
+            #if XB_ENABLE_STATISTICS
+            stats.framesOut++;
+            #endif
+        }
+
+        void addFrameIn()
+        {
+            #if XB_ENABLE_STATISTICS
+            stats.framesIn++;
+            #endif
+        }
+
+        /** Copies the counters. The snapshot is a few KB, so it's written to caller storage instead of returned.
+         *  With statistics compiled out it's all zero. */
+        void snapshot(XBDriverStats& out) const
+        {
+            #if XB_ENABLE_STATISTICS
+            out = stats;
+            #else
+            memset(&out, 0, sizeof(out));
+            #endif
+        }
+
+        void reset()
+        {
+            #if XB_ENABLE_STATISTICS
+            memset(&stats, 0, sizeof(stats));
+            #endif
+        }
+
+        XBStatistics() { reset(); }
+        ~XBStatistics() = default;
+
+    #if XB_ENABLE_STATISTICS
+    private:
+        XBDriverStats stats;
+
+        /** Finds or claims the command's entry
+         *  @return nullptr if the table is full */
+        XBCommandStats* lookup(XBFrameType type, const char* command)
+        {
+            char code[2] = { 0, 0 };
+            const char* shortCode = command ? commandCode(command) : nullptr;
+
+            if (shortCode)
+            {
+                code[0] = shortCode[0];
+                code[1] = shortCode[1];
+            }
+
+            for (size_t i = 0; i < stats.commandCount; i++)
+            {
+                XBCommandStats& entry = stats.commands[i];
+                if ((entry.type == type) && (entry.command[0] == code[0]) && (entry.command[1] == code[1]))
+                {
+                    return &entry;
+                }
+            }
+
+            if (stats.commandCount >= XB_STATS_MAX_COMMANDS)
+            {
+                return nullptr;
+            }
+
+            XBCommandStats& entry = stats.commands[stats.commandCount++];
+            entry.command[0] = code[0];
+            entry.command[1] = code[1];
+            entry.command[2] = '\0';
+            entry.type = type;
+            return &entry;
+        }
+    #endif
+    };
+}
+
+#endif /* !XBEE_STATISTICS_HPP */
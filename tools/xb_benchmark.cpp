@@ -0,0 +1,968 @@
+/**
+ * @file xb_benchmark.cpp
+ *
+ * Measures round-trip latency and throughput of the XBEEProS2 driver operations against the pty emulator.
+ *
+ * Usage: xb_benchmark [--iterations N] [--baud B] [--delay-us D] [--guard-ms G] [--depth P] [--line-rate]
+ *                     [--capture FILE] [--replay FILE] [--limit name=uS]...
+ *
+ * --depth sets how many asynchronous requests the pipelined operations keep in flight.
+ *
+ * --capture logs the serial traffic of the run through XBSerialCapture. --replay skips the emulator and instead times
+ * the API frame decoder over the received bytes of a capture, e.g. one taken in the field, N times over.
+ *
+ * Each --limit fails the run (exit code 1) if the named operation's average latency is above the given number of
+ * microseconds, so the benchmark can gate CI on regressions.
+ *
+ * The scenario rows at the end each bring up a second emulator configured to misbehave in one way and check that the
+ * driver copes. A run of a scenario row fails unless its outcome is exactly the expected one, so they fail the benchmark
+ * like any other failed operation.
+ */
+
+/* C/C++ Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_frame_pool.hpp>
+#include <libxbee/include/xb_io_sample.hpp>
+#include <libxbee/include/xb_posix_serial.hpp>
+#include <libxbee/include/xb_replay_serial.hpp>
+#include <libxbee/include/xb_serial_capture.hpp>
+#include <libxbee/include/modules/xbee_pro_s2/xbpros2.hpp>
+#include <libxbee/include/modules/xbee_pro_s2/xb_fleet_config.hpp>
+#include <libxbee/include/modules/xbee_pro_s2/xb_fragmenter.hpp>
+#include <libxbee/include/modules/xbee_pro_s2/xb_transmit_window.hpp>
+
+#include "xb_emulator.hpp"
+
+using namespace libxbee;
+using namespace libxbee::emulator;
+using namespace libxbee::modules::XBEEProS2;
+
+struct Limit
+{
+    const char* name;
+    double average_uS;
+};
+
+struct Result
+{
+    const char* name;
+    size_t iterations;
+    size_t failures;
+    double min_uS;
+    double average_uS;
+    double p99_uS;
+    double max_uS;
+    double opsPerSecond;
+};
+
+/** Times one operation
+ *
+ *  @param[in]  name        Operation name used in the report and by --limit
+ *  @param[in]  iterations  Number of timed runs
+ *  @param[in]  setup       Untimed preparation before every run, may be empty
+ *  @param[in]  operation   The timed operation. Returns XB_OK on success.
+ **/
+static Result measure(const char* name, size_t iterations, const std::function<void()>& setup,
+    const std::function<XBStatus()>& operation)
+{
+    using namespace std::chrono;
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+
+    Result result = {};
+    result.name = name;
+    result.iterations = iterations;
+
+    double total_uS = 0.0;
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        if (setup)
+        {
+            setup();
+        }
+
+        auto start = steady_clock::now();
+        XBStatus status = operation();
+        double elapsed_uS = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1000.0;
+
+        if (status != XB_OK)
+        {
+            result.failures++;
+            continue;
+        }
+
+        samples.push_back(elapsed_uS);
+        total_uS += elapsed_uS;
+    }
+
+    if (!samples.empty())
+    {
+        std::sort(samples.begin(), samples.end());
+        result.min_uS = samples.front();
+        result.max_uS = samples.back();
+        result.average_uS = total_uS / samples.size();
+        result.p99_uS = samples[std::min(samples.size() - 1, (samples.size() * 99) / 100)];
+        result.opsPerSecond = 1000000.0 / result.average_uS;
+    }
+
+    return result;
+}
+
+/** Row for an operation that couldn't be run at all */
+static Result failed(const char* name)
+{
+    Result result = {};
+    result.name = name;
+    result.iterations = 1;
+    result.failures = 1;
+    return result;
+}
+
+/** Longest a scenario row waits for an outcome before counting the run as failed */
+static const size_t scenarioTimeout_mS = 5000;
+
+/** Emulator and driver of one scenario row, brought up in API mode */
+struct Scenario
+{
+    XBEmulator module;
+    XbeePosixSerial serial;
+    XBEEProS2 xbee;
+
+    Scenario(const XBEmulatorConfig& config, size_t guard_mS) : module(config), xbee(&serial, config.baud)
+    {
+        module.setRegister(XB_SET_GUARD_TIME, (uint32_t)guard_mS);
+        xbee.guardTimeout_mS = guard_mS;
+        xbee.setRxMode(XB_RX_BLOCKING);
+    }
+
+    ~Scenario()
+    {
+        serial.close();
+        module.stop();
+    }
+
+    bool start()
+    {
+        uint32_t baud = module.baud();
+        return (module.start() == XB_OK) && (serial.open(module.devicePath(), baud) == XB_OK) &&
+            (serial.start() == XB_OK) && (xbee.discover(baud) == XB_OK) && (xbee.setAPIMode(XB_API_ENABLED) == XB_OK);
+    }
+
+    /** Handles whatever the module still has to say, e.g. looped back packets after their Transmit Status */
+    void drain()
+    {
+        while (xbee.processIncoming(5) == XB_OK)
+        {
+        }
+    }
+};
+
+/** Reassembly target and verdicts of the fragmentReorder row */
+struct FragmentCheck
+{
+    uint8_t buffer[8192];
+    const uint8_t* expected = nullptr;
+    size_t length = 0;
+    size_t delivered = 0;
+    size_t corrupted = 0;
+};
+
+static uint8_t* fragmentBuffer(uint64_t, uint8_t, size_t, size_t& capacity, void* context)
+{
+    FragmentCheck* check = static_cast<FragmentCheck*>(context);
+    capacity = sizeof(check->buffer);
+    return check->buffer;
+}
+
+static void fragmentDelivered(uint64_t, uint8_t, XBStatus status, uint8_t* buffer, size_t length, void* context)
+{
+    FragmentCheck* check = static_cast<FragmentCheck*>(context);
+
+    if ((status == XB_OK) && (length == check->length) && !memcmp(buffer, check->expected, length))
+    {
+        check->delivered++;
+    }
+    else
+    {
+        check->corrupted++;
+    }
+}
+
+/** A message of about 50 fragments looped back in swapped pairs with every 5th packet doubled. It has to come out of
+ *  reassembly intact, with the fragmenter having seen fragments out of order and duplicated. */
+static void fragmentRows(std::vector<Result>& results, size_t runs, uint32_t baud, size_t guard_mS)
+{
+    XBEmulatorConfig config;
+    config.baud = baud;
+    config.loopback = true;
+    config.loopbackSwapPairs = true;
+    config.loopbackDuplicateEvery = 5;
+
+    Scenario scenario(config, guard_mS);
+    XBFragmenter fragmenter(scenario.xbee, 8);
+
+    if (!scenario.start() || (fragmenter.initialize() != XB_OK))
+    {
+        results.push_back(failed("fragmentReorder"));
+        return;
+    }
+
+    static FragmentCheck check;
+    static uint8_t message[4000];
+    for (size_t i = 0; i < sizeof(message); i++)
+    {
+        message[i] = (uint8_t)((i * 7) + (i / 251));
+    }
+
+    check.expected = message;
+    check.length = sizeof(message);
+    fragmenter.setBufferProvider(fragmentBuffer, &check);
+    fragmenter.setMessageCallback(fragmentDelivered, &check);
+
+    results.push_back(measure("fragmentReorder", runs, nullptr, [&] {
+        XBFragmentStats before = fragmenter.getStats();
+        size_t delivered = check.delivered;
+        size_t corrupted = check.corrupted;
+
+        if (fragmenter.sendMessage(XB_EMULATOR_NODE_ADDRESS, XB_ADDRESS_16_UNKNOWN, message, sizeof(message)) != XB_OK)
+        {
+            return XB_FAILED_COMMAND;
+        }
+
+        size_t start = platform::millis();
+        while (fragmenter.isSending() && ((platform::millis() - start) < scenarioTimeout_mS))
+        {
+            fragmenter.service(10);
+        }
+
+        /* The last fragment may be held back waiting for a packet to swap with, so a plain one follows it */
+        static const uint8_t plain[] = { 0x00 };
+        fragmenter.transmitWindow().send(XB_EMULATOR_NODE_ADDRESS, XB_ADDRESS_16_UNKNOWN, plain, sizeof(plain), 0);
+
+        while ((check.delivered == delivered) && (check.corrupted == corrupted) &&
+            ((platform::millis() - start) < scenarioTimeout_mS))
+        {
+            fragmenter.service(10);
+        }
+
+        const XBFragmentStats& after = fragmenter.getStats();
+        bool passed = (check.delivered == (delivered + 1)) && (check.corrupted == corrupted) &&
+            (after.outOfOrder > before.outOfOrder) && (after.duplicates > before.duplicates);
+
+        return passed ? XB_OK : XB_FAILED_COMPARE;
+    }));
+}
+
+/** ATND answered by 32 simulated nodes, then ATDN for a node the table doesn't know and for one that doesn't exist */
+static void discoveryRows(std::vector<Result>& results, size_t runs, uint32_t baud, size_t guard_mS)
+{
+    static const size_t nodes = 32;
+
+    XBEmulatorConfig config;
+    config.baud = baud;
+    config.remoteNodes = nodes;
+
+    Scenario scenario(config, guard_mS);
+    XBEEProS2& xbee = scenario.xbee;
+
+    if (!scenario.start())
+    {
+        results.push_back(failed("discoverNodes"));
+        results.push_back(failed("resolveNode"));
+        return;
+    }
+
+    results.push_back(measure("discoverNodes", runs, [&] { xbee.nodeTable().clear(); }, [&] {
+        size_t found = 0;
+        if ((xbee.discoverNodes(100, &found) != XB_OK) || (found != nodes) || (xbee.nodeTable().size() != nodes))
+        {
+            return XB_FAILED_COMPARE;
+        }
+
+        const XBNodeInfo* node = xbee.nodeTable().find(XB_EMULATOR_NODE_ADDRESS + 5);
+        return (node && (node->address16 == 0x1005) && !strcmp(node->identifier, "NODE5")) ? XB_OK : XB_FAILED_COMPARE;
+    }));
+
+    results.push_back(measure("resolveNode", runs, [&] { xbee.nodeTable().clear(); }, [&] {
+        XBNodeInfo node;
+        if ((xbee.resolveNode("NODE17", node) != XB_OK) || (node.address64 != (XB_EMULATOR_NODE_ADDRESS + 17)) ||
+            (node.address16 != 0x1011))
+        {
+            return XB_FAILED_COMPARE;
+        }
+
+        return (xbee.resolveNode("NODE99", node) != XB_OK) ? XB_OK : XB_FAILED_COMPARE;
+    }));
+}
+
+/** Route Records of 3 hops ahead of every looped back packet. With source routing on, each transmission to a node other
+ *  than the last one has to be preceded by a Create Source Route frame for it. */
+static void sourceRouteRows(std::vector<Result>& results, size_t runs, uint32_t baud, size_t guard_mS)
+{
+    XBEmulatorConfig config;
+    config.baud = baud;
+    config.loopback = true;
+    config.routeRecords = true;
+
+    Scenario scenario(config, guard_mS);
+    XBEEProS2& xbee = scenario.xbee;
+
+    if (!scenario.start())
+    {
+        results.push_back(failed("sourceRoute"));
+        return;
+    }
+
+    /* The emulator reports address % 4 hops */
+    static const uint64_t targets[] = { XB_EMULATOR_NODE_ADDRESS + 3, XB_EMULATOR_NODE_ADDRESS + 7 };
+    static const uint8_t payload[] = "routed payload";
+
+    auto transmit = [&](uint64_t address64) {
+        XBRequestHandle handle;
+        XBCompletion completion;
+        XBStatus status = xbee.transmitAsync(address64, XB_ADDRESS_16_UNKNOWN, payload, handle);
+
+        status = (status == XB_OK) ? xbee.waitFor(handle, completion) : status;
+        scenario.drain();
+        return status;
+    };
+
+    /* Learn both routes first */
+    for (uint64_t target : targets)
+    {
+        transmit(target);
+    }
+
+    xbee.setSourceRouting(true);
+    size_t next = 0;
+
+    results.push_back(measure("sourceRoute", runs, nullptr, [&] {
+        uint64_t target = targets[next++ & 1];
+        const XBSourceRoute* route = xbee.routeCache().lookup(target, platform::millis());
+        XBEmulatorStats before = scenario.module.stats();
+
+        if (!route || (route->hops != 3) || (transmit(target) != XB_OK))
+        {
+            return XB_FAILED_COMPARE;
+        }
+
+        XBEmulatorStats after = scenario.module.stats();
+        bool passed = (after.sourceRoutes == (before.sourceRoutes + 1)) &&
+            (after.sourceRoutedTransmits == (before.sourceRoutedTransmits + 1));
+
+        return passed ? XB_OK : XB_FAILED_COMPARE;
+    }));
+}
+
+/** A two register profile pushed to 16 nodes over a 2 mS RF round trip, with every 7th Remote AT Command failing. Every
+ *  node has to end up configured, through retries. */
+static void fleetRows(std::vector<Result>& results, size_t runs, uint32_t baud, size_t guard_mS)
+{
+    static const size_t nodes = 16;
+    static const size_t concurrency = 8;
+
+    XBEmulatorConfig config;
+    config.baud = baud;
+    config.remoteNodes = nodes;
+    config.remoteLatency_uS = 2000;
+
+    /* Failures are counted across all nodes. With a period longer than a round of commands from every worker, a node's
+     * retries don't keep landing on the failing slot until it runs out of them. */
+    config.remoteFailEvery = concurrency + 1;
+
+    Scenario scenario(config, guard_mS);
+    XBFleetConfigurator fleet(scenario.xbee, concurrency);
+
+    if (!scenario.start())
+    {
+        results.push_back(failed("fleetRetry"));
+        return;
+    }
+
+    uint64_t addresses[nodes];
+    for (size_t i = 0; i < nodes; i++)
+    {
+        addresses[i] = XB_EMULATOR_NODE_ADDRESS + i;
+    }
+
+    fleet.retryBackoff_mS = 2;
+    uint32_t joinTime = 0x20;
+
+    results.push_back(measure("fleetRetry", runs, nullptr, [&] {
+        /* A different value every run, so every node is written */
+        joinTime = (joinTime == 0x20) ? 0x40 : 0x20;
+        XBRegisterSetting profile[] = { { "NJ", joinTime, 0 }, { "D6", 1, 0 } };
+
+        XBFleetStats before = fleet.getStats();
+        if ((fleet.setProfile(profile, 2) != XB_OK) || (fleet.start(addresses, nodes) != XB_OK) ||
+            (fleet.run(scenarioTimeout_mS) != XB_OK))
+        {
+            return XB_FAILED_COMMAND;
+        }
+
+        XBFleetStats after = fleet.getStats();
+        if ((after.nodesFailed != before.nodesFailed) || (after.nodesConfigured != (before.nodesConfigured + nodes)) ||
+            (after.retries == before.retries))
+        {
+            return XB_FAILED_COMPARE;
+        }
+
+        for (size_t i = 0; i < nodes; i++)
+        {
+            uint32_t value = 0;
+            if (!scenario.module.getRemoteRegister(i, "NJ", value) || (value != joinTime))
+            {
+                return XB_FAILED_COMPARE;
+            }
+        }
+
+        return XB_OK;
+    }));
+}
+
+static void pulseReset(bool asserted, void* context)
+{
+    if (!asserted)
+    {
+        static_cast<XBEmulator*>(context)->powerCycle();
+    }
+}
+
+/** A module that takes 20 mS to boot. hardwareReset() has to wait it out and see the Modem Status it announces itself
+ *  with, without sleeping a fixed startup delay. */
+static void resetRows(std::vector<Result>& results, size_t runs, uint32_t baud, size_t guard_mS)
+{
+    XBEmulatorConfig config;
+    config.baud = baud;
+    config.bootTime_uS = 20000;
+
+    Scenario scenario(config, guard_mS);
+    XBEEProS2& xbee = scenario.xbee;
+
+    if (!scenario.start())
+    {
+        results.push_back(failed("hardwareReset"));
+        return;
+    }
+
+    /* setAPIMode() doesn't write to flash, so persist AP for the module to come back up in API mode */
+    scenario.module.setRegister(XB_API_ENABLE, 1);
+    xbee.setResetLine(pulseReset, &scenario.module);
+
+    results.push_back(measure("hardwareReset", runs, nullptr, [&] {
+        const XBBootStats& boot = xbee.getBootStats();
+        if ((xbee.hardwareReset() != XB_OK) || !boot.modemStatus || (boot.elapsed_mS < 20))
+        {
+            return XB_FAILED_COMPARE;
+        }
+
+        uint32_t value = 0;
+        return (xbee.readRegister(XB_FIRMWARE_VER, value, false) == XB_OK) ? XB_OK : XB_FAILED_COMPARE;
+    }));
+}
+
+/** A link that loses responses above 115200 baud. Moving to 921600 has to fail the link check and fall back to the
+ *  previous rate, including 1200 baud whose ATBD value is 0. */
+static void baudRows(std::vector<Result>& results, size_t runs, size_t guard_mS)
+{
+    XBEmulatorConfig config;
+    config.baud = 115200;
+    config.maxCleanBaud = 115200;
+
+    Scenario scenario(config, guard_mS);
+    XBEEProS2& xbee = scenario.xbee;
+
+    if (!scenario.start())
+    {
+        results.push_back(failed("baudFallback"));
+        return;
+    }
+
+    auto settledAt = [&](uint32_t baud) { return (xbee.getBuadRate() == baud) && (scenario.module.baud() == baud); };
+
+    results.push_back(measure("baudFallback", runs, nullptr, [&] {
+        if ((xbee.setBaudRate(1200) != XB_OK) || !settledAt(1200))
+        {
+            return XB_FAILED_COMPARE;
+        }
+
+        if ((xbee.setBaudRate(921600) == XB_OK) || !settledAt(1200))
+        {
+            return XB_FAILED_COMPARE;
+        }
+
+        return ((xbee.setBaudRate(115200) == XB_OK) && settledAt(115200)) ? XB_OK : XB_FAILED_COMPARE;
+    }));
+}
+
+/** Times the frame decoder over the received side of a capture, as fast as it can be fed */
+static int replayCapture(const char* path, size_t iterations)
+{
+    XBReplaySerial replay;
+    XBStatus result = replay.loadFile(path);
+
+    if (result != XB_OK)
+    {
+        fprintf(stderr, "Couldn't load capture [%s]: %s\n", path, (result == XB_NOT_FOUND) ? "unreadable" : "bad format");
+        return 2;
+    }
+
+    /* Pure receive path: nothing is written, so nothing may hold the received data back */
+    replay.setMode(XB_REPLAY_FAST);
+    replay.followWrites = false;
+
+    XBAPIDecoder decoder;
+    size_t frames = 0;
+    size_t bytes = 0;
+
+    Result r = measure("replay", iterations, [&] { replay.rewind(); decoder.reset(); }, [&] {
+        uint8_t chunk[XB_POSIX_READ_CHUNK_SIZE];
+        size_t count = 0;
+
+        frames = 0;
+        bytes = 0;
+
+        while ((count = replay.read(chunk, sizeof(chunk))) != 0)
+        {
+            bytes += count;
+            for (size_t i = 0; i < count; i++)
+            {
+                frames += (decoder.push(chunk[i]) == XB_DECODE_COMPLETE) ? 1 : 0;
+            }
+        }
+
+        return bytes ? XB_OK : XB_NOT_FOUND;
+    });
+
+    printf("%-18s %8s %8s %10s %10s %10s %10s %10s\n", "operation", "runs", "failed", "min uS", "avg uS", "p99 uS",
+        "max uS", "ops/s");
+    printf("%-18s %8zu %8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", r.name, r.iterations, r.failures, r.min_uS,
+        r.average_uS, r.p99_uS, r.max_uS, r.opsPerSecond);
+
+    double seconds = r.average_uS / 1000000.0;
+    printf("replay: %zu bytes, %zu frames per pass, %.1f MB/s, %.0f frames/s\n", bytes, frames,
+        seconds ? (bytes / seconds) / 1000000.0 : 0.0, seconds ? (frames / seconds) : 0.0);
+
+    return r.failures ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = 100;
+    size_t guard_mS = 10;
+    size_t depth = 16;
+    XBEmulatorConfig config;
+    config.baud = 115200;
+    std::vector<Limit> limits;
+    const char* capturePath = nullptr;
+    const char* replayPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1) < argc;
+
+        if (!strcmp(argv[i], "--iterations") && hasValue)
+        {
+            iterations = strtoul(argv[++i], nullptr, 0);
+        }
+        else if (!strcmp(argv[i], "--baud") && hasValue)
+        {
+            config.baud = strtoul(argv[++i], nullptr, 0);
+        }
+        else if (!strcmp(argv[i], "--delay-us") && hasValue)
+        {
+            config.responseDelay_uS = strtoul(argv[++i], nullptr, 0);
+        }
+        else if (!strcmp(argv[i], "--guard-ms") && hasValue)
+        {
+            guard_mS = strtoul(argv[++i], nullptr, 0);
+        }
+        else if (!strcmp(argv[i], "--depth") && hasValue)
+        {
+            depth = std::max<size_t>(1, std::min<size_t>(XB_MAX_PENDING_REQUESTS, strtoul(argv[++i], nullptr, 0)));
+        }
+        else if (!strcmp(argv[i], "--capture") && hasValue)
+        {
+            capturePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--replay") && hasValue)
+        {
+            replayPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--line-rate"))
+        {
+            config.simulateLineRate = true;
+        }
+        else if (!strcmp(argv[i], "--limit") && hasValue)
+        {
+            char* spec = argv[++i];
+            char* split = strchr(spec, '=');
+
+            if (!split)
+            {
+                fprintf(stderr, "Bad limit [%s], expected name=uS\n", spec);
+                return 2;
+            }
+
+            *split = 0;
+            limits.push_back({ spec, strtod(split + 1, nullptr) });
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--iterations N] [--baud B] [--delay-us D] [--guard-ms G] [--depth P] "
+                "[--line-rate] [--capture FILE] [--replay FILE] [--limit name=uS]...\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (replayPath)
+    {
+        return replayCapture(replayPath, iterations);
+    }
+
+    /* Short guard times keep the command mode entries from dominating the run */
+    XBEmulator module(config);
+    module.setRegister(XB_SET_GUARD_TIME, (uint32_t)guard_mS);
+
+    XbeePosixSerial serial;
+    if ((module.start() != XB_OK) || (serial.open(module.devicePath(), config.baud) != XB_OK) || (serial.start() != XB_OK))
+    {
+        fprintf(stderr, "Couldn't set up the emulator pty\n");
+        return 2;
+    }
+
+    XBSerialCapture tap(serial);
+    if (capturePath && (tap.open(capturePath) != XB_OK))
+    {
+        fprintf(stderr, "Couldn't create capture [%s]\n", capturePath);
+        return 2;
+    }
+
+    XBEEProS2 xbee(capturePath ? static_cast<XBEESerial*>(&tap) : &serial);
+    xbee.guardTimeout_mS = guard_mS;
+    xbee.setRxMode(XB_RX_BLOCKING);
+
+    std::vector<Result> results;
+    auto leaveCommandMode = [&] { xbee.exitCommandMode(); };
+    auto enterCommandMode = [&] { if (!xbee.isATMode()) { xbee.goToCommandMode(); } };
+
+    results.push_back(measure("discover", std::max<size_t>(1, iterations / 10), leaveCommandMode,
+        [&] { return xbee.discover(config.baud); }));
+
+    results.push_back(measure("goToCommandMode", std::max<size_t>(1, iterations / 10), leaveCommandMode,
+        [&] { return xbee.goToCommandMode(); }));
+
+    size_t timeout = 1000;
+    results.push_back(measure("setATModeTimeout", iterations, enterCommandMode, [&] {
+        /* Alternate so the register cache never short-circuits the write */
+        timeout = (timeout == 1000) ? 1100 : 1000;
+        return (xbee.setATModeTimeout(timeout, true) == timeout) ? XB_OK : XB_FAILED_COMPARE;
+    }));
+
+    results.push_back(measure("readRegister", iterations, enterCommandMode, [&] {
+        uint32_t value = 0;
+        return xbee.readRegister(XB_FIRMWARE_VER, value, false);
+    }));
+
+    results.push_back(measure("txBatch", iterations, enterCommandMode, [&] {
+        XBATBatch batch;
+        batch.add(XB_FIRMWARE_VER);
+        batch.add(XB_HARDWARE_VER);
+        batch.add(XB_CMD_MODE_TIMEOUT);
+        batch.add(XB_SET_GUARD_TIME);
+        return xbee.txBatch(batch);
+    }));
+
+    enterCommandMode();
+    if (xbee.setAPIMode(XB_API_ENABLED) == XB_OK)
+    {
+        results.push_back(measure("apiReadRegister", iterations, nullptr, [&] {
+            uint32_t value = 0;
+            return xbee.readRegister(XB_FIRMWARE_VER, value, false);
+        }));
+
+        /* The same reads with depth requests on the wire at once, routed back by frame ID */
+        std::vector<XBRequestHandle> handles(depth);
+        results.push_back(measure("apiPipeline", iterations, nullptr, [&] {
+            XBStatus status = XB_OK;
+
+            for (XBRequestHandle& handle : handles)
+            {
+                if (xbee.atCommandAsync(XB_FIRMWARE_VER, nullptr, 0, handle) != XB_OK)
+                {
+                    status = XB_FAILED_COMMAND;
+                }
+            }
+
+            for (XBRequestHandle& handle : handles)
+            {
+                XBCompletion completion;
+                if (xbee.waitFor(handle, completion) != XB_OK)
+                {
+                    status = XB_FAILED_COMMAND;
+                }
+            }
+
+            return status;
+        }));
+
+        results.push_back(measure("apiTransmit", iterations, nullptr, [&] {
+            static const uint8_t payload[] = "benchmark payload";
+            XBStatus status = XB_OK;
+
+            for (XBRequestHandle& handle : handles)
+            {
+                if (xbee.transmitAsync(XB_ADDRESS_64_COORDINATOR, XB_ADDRESS_16_UNKNOWN, payload, sizeof(payload),
+                    handle) != XB_OK)
+                {
+                    status = XB_FAILED_COMMAND;
+                }
+            }
+
+            for (XBRequestHandle& handle : handles)
+            {
+                XBCompletion completion;
+                if (xbee.waitFor(handle, completion) != XB_OK)
+                {
+                    status = XB_FAILED_COMMAND;
+                }
+            }
+
+            return status;
+        }));
+
+        /* The same transmissions through the sliding window, which also retries and tracks statistics */
+        XBTransmitWindow transmitter(xbee, depth);
+        results.push_back(measure("txWindow", iterations, nullptr, [&] {
+            static const uint8_t payload[] = "benchmark payload";
+
+            for (size_t i = 0; i < depth; i++)
+            {
+                while (transmitter.send(XB_ADDRESS_64_COORDINATOR, XB_ADDRESS_16_UNKNOWN, payload, sizeof(payload),
+                    (uint32_t)i) != XB_OK)
+                {
+                    transmitter.service(XBEEProS2::XB_DEFAULT_TIMEOUT_mS);
+                }
+            }
+
+            XBStatus status = transmitter.flush(XBEEProS2::XB_ASYNC_TIMEOUT_mS);
+            return ((status == XB_OK) && !transmitter.getStats().failed) ? XB_OK : XB_FAILED_COMMAND;
+        }));
+
+        xbee.setAPIMode(XB_API_DISABLED);
+    }
+    else
+    {
+        for (const char* name : { "apiReadRegister", "apiPipeline", "apiTransmit", "txWindow" })
+        {
+            results.push_back(failed(name));
+        }
+    }
+
+    /* IO sample decoding and a columnar aggregate, host side only: 1024 frames from 8 nodes with 4 DIO lines, AD0-AD3
+     * and the supply voltage per run */
+    {
+        static XBIOSampleBuffer<1024> samples;
+        uint8_t frame[XB_IO_SAMPLE_HEADER_SIZE + 16] = { XB_FRAME_IO_SAMPLE, 0x00, 0x13, 0xA2, 0x00, 0x41, 0x00, 0x00,
+            0x00, 0x10, 0x00, 0x01, 0x01, 0x00, 0x0F, 0x8F, 0x00, 0x05 };
+
+        results.push_back(measure("ioSample", iterations, nullptr, [&] {
+            for (size_t i = 0; i < samples.capacity(); i++)
+            {
+                frame[8] = (uint8_t)(i & 0x07);
+                frame[18] = (uint8_t)((i >> 8) & 0x03);
+                frame[19] = (uint8_t)i;
+                samples.pushFrame(frame, sizeof(frame));
+            }
+
+            uint32_t sum = 0;
+            size_t count = 0;
+
+            for (XBIOSampleSpan span = samples.peek(); span.count; span = samples.peek())
+            {
+                const uint16_t* ad0 = samples.analog(0) + span.first;
+                for (size_t i = 0; i < span.count; i++)
+                {
+                    sum += ad0[i];
+                }
+
+                count += span.count;
+                samples.consume(span.count);
+            }
+
+            return ((count == samples.capacity()) && sum) ? XB_OK : XB_FAILED_COMMAND;
+        }));
+    }
+
+    /* AT command encoding, host side only: the allocation-free encoder against the snprintf() formatting it replaced,
+     * 1024 commands per run alternating between reads and writes with values of every width */
+    {
+        static const char* commands[] = { "ATGT", "ATCT", "ATBD", "ATNJ", "ATD6", "ATPL", "ATNT", "ATAP" };
+        static const size_t frames = 1024;
+        char buffer[XBEEProS2::XBEE_TX_BUFFER_SIZE];
+        volatile uint32_t sink = 0;
+
+        results.push_back(measure("encodeATCommand", iterations, nullptr, [&] {
+            uint32_t sum = 0;
+
+            for (size_t i = 0; i < frames; i++)
+            {
+                uint32_t value = (i & 1) ? (uint32_t)(i * 2654435761u) >> (i & 31) : 0;
+                size_t length = encodeATCommand(buffer, sizeof(buffer), commands[i & 7], value != 0, value);
+                sum += (uint32_t)length + (uint8_t)buffer[length - 2];
+            }
+
+            sink = sink + sum;
+            return sum ? XB_OK : XB_FAILED_COMMAND;
+        }));
+
+        results.push_back(measure("snprintfATCommand", iterations, nullptr, [&] {
+            uint32_t sum = 0;
+
+            for (size_t i = 0; i < frames; i++)
+            {
+                uint32_t value = (i & 1) ? (uint32_t)(i * 2654435761u) >> (i & 31) : 0;
+                int length = value ? snprintf(buffer, sizeof(buffer), "%s %x%s", commands[i & 7], value, XB_DELIMITER) :
+                    snprintf(buffer, sizeof(buffer), "%s%s", commands[i & 7], XB_DELIMITER);
+                sum += (uint32_t)length + (uint8_t)buffer[length - 2];
+            }
+
+            sink = sink + sum;
+            return sum ? XB_OK : XB_FAILED_COMMAND;
+        }));
+    }
+
+    /* Frame pool, host side only: 1024 received frames copied in, shared with a second holder and released per run,
+     * keeping up to 16 in flight like a consumer thread lagging behind the dispatcher */
+    {
+        static XBFramePool pool;
+        uint8_t frame[32] = { XB_FRAME_RECEIVE_PACKET };
+        XBFrameRef held[16];
+
+        results.push_back(measure("framePool", iterations, nullptr, [&] {
+            size_t copies = 0;
+
+            for (size_t i = 0; i < 1024; i++)
+            {
+                frame[1] = (uint8_t)i;
+                XBFrameRef ref = pool.copy(frame, sizeof(frame));
+                if (ref.valid() && (ref.data()[1] == frame[1]))
+                {
+                    held[i % 16] = ref;
+                    copies++;
+                }
+            }
+
+            for (XBFrameRef& ref : held)
+            {
+                ref.release();
+            }
+
+            return ((copies == 1024) && (pool.available() == pool.capacity())) ? XB_OK : XB_FAILED_COMMAND;
+        }));
+    }
+
+    /* Scenario rows, each against its own emulator. They are slow by design, so they run fewer times. */
+    size_t scenarioRuns = std::max<size_t>(1, iterations / 20);
+    fragmentRows(results, scenarioRuns, config.baud, guard_mS);
+    discoveryRows(results, scenarioRuns, config.baud, guard_mS);
+    sourceRouteRows(results, scenarioRuns, config.baud, guard_mS);
+    fleetRows(results, scenarioRuns, config.baud, guard_mS);
+    resetRows(results, scenarioRuns, config.baud, guard_mS);
+    baudRows(results, scenarioRuns, guard_mS);
+
+    /* Report */
+    int exitCode = 0;
+    XBEmulatorStats stats = module.stats();
+    XBSerialRxStats rx = serial.rxStats();
+    XBFlowStats flow = serial.flowStats();
+
+    printf("baud %u, response delay %zu uS, guard time %zu mS, pipeline depth %zu, line rate %s\n", config.baud,
+        config.responseDelay_uS, guard_mS, depth, config.simulateLineRate ? "on" : "off");
+    printf("%-18s %8s %8s %10s %10s %10s %10s %10s\n", "operation", "runs", "failed", "min uS", "avg uS", "p99 uS",
+        "max uS", "ops/s");
+
+    for (const Result& r : results)
+    {
+        printf("%-18s %8zu %8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", r.name, r.iterations, r.failures, r.min_uS,
+            r.average_uS, r.p99_uS, r.max_uS, r.opsPerSecond);
+
+        if (r.failures)
+        {
+            exitCode = 1;
+        }
+
+        for (const Limit& limit : limits)
+        {
+            if (!strcmp(limit.name, r.name) && (r.average_uS > limit.average_uS))
+            {
+                printf("REGRESSION: %s averaged %.1f uS, limit is %.1f uS\n", r.name, r.average_uS, limit.average_uS);
+                exitCode = 1;
+            }
+        }
+    }
+
+    /* Both encoding rows run 1024 commands, so their averages convert straight to a per-frame cost */
+    const Result* encoder = nullptr;
+    const Result* formatter = nullptr;
+    for (const Result& r : results)
+    {
+        encoder = !strcmp(r.name, "encodeATCommand") ? &r : encoder;
+        formatter = !strcmp(r.name, "snprintfATCommand") ? &r : formatter;
+    }
+
+    if (encoder && formatter && (encoder->average_uS > 0.0))
+    {
+        printf("encoding: %.1f nS per frame, snprintf %.1f nS per frame (%.1fx)\n", encoder->average_uS * 1000.0 / 1024,
+            formatter->average_uS * 1000.0 / 1024, formatter->average_uS / encoder->average_uS);
+    }
+
+    printf("emulator: %zu commands, %zu command mode entries, %zu guard violations, %zu baud mismatch bytes\n",
+        stats.commands, stats.commandModeEntries, stats.guardViolations, stats.baudMismatchBytes);
+    printf("serial: ring high water %zu, overruns %zu, CTS throttles %zu (%zu mS), RTS holdoffs %zu, TX dropped %zu\n",
+        rx.highWaterMark, rx.overruns, flow.throttleEvents, flow.throttled_mS, flow.rxHoldoffs, flow.txDropped);
+
+    /* Where the driver's own time went, busiest commands first */
+    static XBDriverStats driver;
+    xbee.getDriverStats(driver);
+    printf("driver: %zu frames out, %zu frames in, %zu bytes out, %zu bytes in, %zu command mode entries (%zu mS guard)\n",
+        driver.framesOut, driver.framesIn, driver.bytesOut, driver.bytesIn, driver.commandModeEntries, driver.guardTime_mS);
+
+    std::vector<const XBCommandStats*> commands;
+    for (size_t i = 0; i < driver.commandCount; i++)
+    {
+        commands.push_back(&driver.commands[i]);
+    }
+
+    std::sort(commands.begin(), commands.end(),
+        [](const XBCommandStats* a, const XBCommandStats* b) { return a->total_mS > b->total_mS; });
+
+    for (size_t i = 0; (i < commands.size()) && (i < 5); i++)
+    {
+        const XBCommandStats& c = *commands[i];
+        printf("  %-4s 0x%02X %8zu runs %6zu failed  avg %4zu mS  p99 <= %4zu mS  max %4zu mS  total %6zu mS\n",
+            c.command[0] ? c.command : "tx", c.type, c.count, c.failures, c.average_mS(), c.percentile_mS(99), c.max_mS,
+            c.total_mS);
+    }
+
+    if (capturePath)
+    {
+        tap.stop();
+        printf("capture: %zu bytes in, %zu bytes out, %zu records, %zu byte log\n", tap.bytesIn, tap.bytesOut, tap.records,
+            tap.logBytes);
+    }
+
+    serial.close();
+    module.stop();
+    return exitCode;
+}
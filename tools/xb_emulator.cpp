@@ -0,0 +1,1126 @@
+/* C/C++ Includes */
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <chrono>
+
+/* termios2 for reading the host's baud rate. This clashes with <termios.h>, so everything goes through ioctl() */
+#include <asm/termbits.h>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_at_batch.hpp>
+#include <libxbee/include/xb_command.hpp>
+
+#include "xb_emulator.hpp"
+
+
+namespace libxbee
+{
+    namespace emulator
+    {
+        static uint64_t now_uS()
+        {
+            using namespace std::chrono;
+            return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+        static const XBEmulatorRegister defaultRegisters[XB_EMULATOR_REGISTER_COUNT] = {
+            /* code  width  min                     max                     readOnly  default     value, active and persisted are set up at start */
+            { "VR",  2,     0,                      0xFFFF,                 true,     0x21A7,     0, 0, 0 },
+            { "HV",  2,     0,                      0xFFFF,                 true,     0x1E46,     0, 0, 0 },
+            { "SH",  4,     0,                      0xFFFFFFFF,             true,     0x0013A200, 0, 0, 0 },
+            { "SL",  4,     0,                      0xFFFFFFFF,             true,     0x40A1B2C3, 0, 0, 0 },
+            { "MY",  2,     0,                      0xFFFF,                 true,     0xFFFE,     0, 0, 0 },
+            { "CT",  2,     XB_MIN_AT_TIMEOUT_HEX,  XB_MAX_AT_TIMEOUT_HEX,  false,    0x64,       0, 0, 0 },
+            { "GT",  2,     XB_MIN_GUARD_TIME_HEX,  XB_MAX_GUARD_TIME_HEX,  false,    0x3E8,      0, 0, 0 },
+            { "CC",  1,     0,                      0xFF,                   false,    0x2B,       0, 0, 0 },
+            { "AP",  1,     XB_API_DISABLED,        XB_API_ESCAPED,         false,    XB_API_DISABLED, 0, 0, 0 },
+            { "BD",  4,     0,                      0xE1000,                false,    3,          0, 0, 0 },
+            { "D6",  1,     0,                      7,                      false,    0,          0, 0, 0 },
+            { "D7",  1,     0,                      7,                      false,    1,          0, 0, 0 },
+            { "NJ",  1,     0,                      0xFF,                   false,    0xFF,       0, 0, 0 },
+            { "PL",  1,     0,                      4,                      false,    4,          0, 0, 0 },
+            { "NP",  2,     0,                      0xFFFF,                 true,     0x54,       0, 0, 0 },
+            { "NT",  1,     0x20,                   0xFF,                   false,    0x3C,       0, 0, 0 },
+        };
+
+        XBEmulator::XBEmulator(const XBEmulatorConfig& config) : config(config)
+        {
+            memcpy(registers, defaultRegisters, sizeof(registers));
+
+            for (size_t i = 0; i < XB_EMULATOR_REGISTER_COUNT; i++)
+            {
+                registers[i].persisted = registers[i].defaultValue;
+            }
+
+            find('B', 'D')->persisted = baudToRegister(config.baud);
+            loadPersisted();
+
+            /* Remote nodes start out with the defaults, apart from their own addresses */
+            remoteRegisters.resize(config.remoteNodes * XB_EMULATOR_REGISTER_COUNT);
+            for (size_t node = 0; node < config.remoteNodes; node++)
+            {
+                uint32_t* values = &remoteRegisters[node * XB_EMULATOR_REGISTER_COUNT];
+                uint64_t address64 = XB_EMULATOR_NODE_ADDRESS + node;
+
+                for (size_t i = 0; i < XB_EMULATOR_REGISTER_COUNT; i++)
+                {
+                    values[i] = registers[i].defaultValue;
+                }
+
+                values[find('S', 'H') - registers] = (uint32_t)(address64 >> 32);
+                values[find('S', 'L') - registers] = (uint32_t)address64;
+                values[find('M', 'Y') - registers] = (uint32_t)(0x1000 + node);
+            }
+        }
+
+        XBEmulator::~XBEmulator()
+        {
+            stop();
+        }
+
+        XBStatus XBEmulator::start()
+        {
+            stop();
+
+            masterFd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+            if ((masterFd < 0) || (grantpt(masterFd) < 0) || (unlockpt(masterFd) < 0) ||
+                (ptsname_r(masterFd, slavePath, sizeof(slavePath)) != 0))
+            {
+                stop();
+                return XB_UNKNOWN_ERROR;
+            }
+
+            slaveFd = ::open(slavePath, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+            wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if ((slaveFd < 0) || (wakeFd < 0))
+            {
+                stop();
+                return XB_UNKNOWN_ERROR;
+            }
+
+            /* Start out raw so nothing is mangled before the host configures the port itself */
+            struct termios2 tio;
+            if (ioctl(slaveFd, TCGETS2, &tio) == 0)
+            {
+                tio.c_iflag = 0;
+                tio.c_oflag = 0;
+                tio.c_lflag = 0;
+                tio.c_cflag = CS8 | CREAD | CLOCAL | BOTHER | (BOTHER << IBSHIFT);
+                tio.c_ispeed = registerToBaud(find('B', 'D')->active);
+                tio.c_ospeed = tio.c_ispeed;
+                ioctl(slaveFd, TCSETS2, &tio);
+            }
+
+            running = true;
+            worker = std::thread(&XBEmulator::run, this);
+            return XB_OK;
+        }
+
+        void XBEmulator::stop()
+        {
+            if (worker.joinable())
+            {
+                running = false;
+
+                uint64_t wake = 1;
+                ssize_t result = ::write(wakeFd, &wake, sizeof(wake));
+                (void)result;
+
+                worker.join();
+            }
+
+            int* fds[] = { &masterFd, &slaveFd, &wakeFd };
+            for (int* fd : fds)
+            {
+                if (*fd >= 0)
+                {
+                    ::close(*fd);
+                    *fd = -1;
+                }
+            }
+        }
+
+        void XBEmulator::run()
+        {
+            uint8_t buffer[256];
+
+            while (running)
+            {
+                /* Wake up for whichever timer is due first: the "+++" trailing guard time or the ATCT expiry */
+                int timeout_mS = -1;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    uint64_t now = now_uS();
+                    uint64_t due = 0;
+
+                    if (sequenceCount == 3)
+                    {
+                        due = sequenceEnd_uS + guardTime_uS();
+                    }
+                    else if (commandMode)
+                    {
+                        due = commandDeadline_uS;
+                    }
+
+                    for (const DelayedFrame& frame : delayed)
+                    {
+                        due = (!due || (frame.due_uS < due)) ? frame.due_uS : due;
+                    }
+
+                    if (due)
+                    {
+                        timeout_mS = (due > now) ? (int)((due - now + 999) / 1000) : 0;
+                    }
+                }
+
+                struct pollfd fds[] = { { masterFd, POLLIN, 0 }, { wakeFd, POLLIN, 0 } };
+                if ((poll(fds, 2, timeout_mS) < 0) && (errno != EINTR))
+                {
+                    break;
+                }
+
+                if (fds[1].revents & POLLIN)
+                {
+                    /* A power cycle queued a timer, so the wait above has to be worked out again */
+                    uint64_t wake = 0;
+                    ssize_t result = ::read(wakeFd, &wake, sizeof(wake));
+                    (void)result;
+                }
+
+                std::lock_guard<std::mutex> guard(lock);
+                uint64_t now = now_uS();
+
+                /* Timers first, so a byte arriving right at the deadline is judged against the state it ends up in */
+                expire(now);
+
+                if (fds[0].revents & POLLIN)
+                {
+                    ssize_t count = ::read(masterFd, buffer, sizeof(buffer));
+                    if (count > 0)
+                    {
+                        receive(buffer, (size_t)count, now);
+                    }
+                }
+            }
+        }
+
+        void XBEmulator::expire(uint64_t now)
+        {
+            if ((sequenceCount == 3) && (now >= (sequenceEnd_uS + guardTime_uS())))
+            {
+                /* Silence after the sequence: enter command mode */
+                sequenceCount = 0;
+                commandMode = true;
+                commandDeadline_uS = now + commandTimeout_uS();
+                lineLength = 0;
+                lineOverflow = false;
+                counters.commandModeEntries++;
+
+                respond((const uint8_t*)XB_DEFAULT_RESPONSE, strlen(XB_DEFAULT_RESPONSE));
+            }
+
+            if (commandMode && (now >= commandDeadline_uS))
+            {
+                /* Timing out of command mode applies queued changes, the same as ATCN */
+                commandMode = false;
+                counters.commandModeExpiries++;
+                apply();
+            }
+
+            /* Remote responses whose RF round trip is over, in the order they were queued */
+            size_t kept = 0;
+            for (size_t i = 0; i < delayed.size(); i++)
+            {
+                if (now >= delayed[i].due_uS)
+                {
+                    respond(delayed[i].data.data(), delayed[i].data.size());
+                }
+                else if (kept++ != i)
+                {
+                    delayed[kept - 1] = std::move(delayed[i]);
+                }
+            }
+            delayed.resize(kept);
+        }
+
+        void XBEmulator::receive(const uint8_t* data, size_t length, uint64_t now)
+        {
+            if (bootEnd_uS && (now < bootEnd_uS))
+            {
+                counters.bootDroppedBytes += length;
+                sequenceCount = 0;
+                return;
+            }
+
+            bootEnd_uS = 0;
+
+            if (!hostBaudMatches())
+            {
+                /* At the wrong rate the UART would only see framing errors */
+                counters.baudMismatchBytes += length;
+                sequenceCount = 0;
+                return;
+            }
+
+            for (size_t i = 0; i < length; i++)
+            {
+                if (commandMode)
+                {
+                    receiveCommand(data[i], now);
+                }
+                else if (apiMode() != XB_API_DISABLED)
+                {
+                    receiveAPI(data[i]);
+                }
+                else
+                {
+                    receiveTransparent(data[i], now);
+                }
+
+                lastRx_uS = now;
+                anyRx = true;
+            }
+        }
+
+        void XBEmulator::receiveTransparent(uint8_t byte, uint64_t now)
+        {
+            uint8_t sequenceChar = (uint8_t)find('C', 'C')->active;
+            bool quietBefore = !anyRx || ((now - lastRx_uS) >= guardTime_uS());
+
+            if (byte != sequenceChar)
+            {
+                /* Ordinary transparent data, which would go out over the air. Breaks any sequence in progress. */
+                if (sequenceCount == 3)
+                {
+                    counters.guardViolations++;
+                }
+
+                sequenceCount = 0;
+                return;
+            }
+
+            if (sequenceCount == 0)
+            {
+                if (quietBefore)
+                {
+                    sequenceCount = 1;
+                }
+                else
+                {
+                    counters.guardViolations++;
+                }
+            }
+            else if (sequenceCount < 3)
+            {
+                /* All three characters have to arrive within one guard time */
+                sequenceCount = ((now - lastRx_uS) < guardTime_uS()) ? (sequenceCount + 1) : 0;
+            }
+            else
+            {
+                /* A fourth character inside the trailing guard time */
+                counters.guardViolations++;
+                sequenceCount = 0;
+            }
+
+            if (sequenceCount == 3)
+            {
+                sequenceEnd_uS = now;
+            }
+        }
+
+        void XBEmulator::receiveCommand(uint8_t byte, uint64_t now)
+        {
+            if (byte != XB_DELIMITER[0])
+            {
+                if (lineLength < sizeof(line))
+                {
+                    line[lineLength++] = (char)byte;
+                }
+                else
+                {
+                    lineOverflow = true;
+                }
+
+                return;
+            }
+
+            if (lineOverflow)
+            {
+                respond((const uint8_t*)XB_ERROR_RESPONSE "\r", strlen(XB_ERROR_RESPONSE) + 1);
+            }
+            else
+            {
+                executeLine(now);
+            }
+
+            lineLength = 0;
+            lineOverflow = false;
+        }
+
+        void XBEmulator::executeLine(uint64_t now)
+        {
+            /* Every line has to start with AT. Further commands follow after commas: "ATCT 64,GT 32,AC" */
+            if ((lineLength < 2) || ((line[0] | 0x20) != 'a') || ((line[1] | 0x20) != 't'))
+            {
+                respond((const uint8_t*)XB_ERROR_RESPONSE "\r", strlen(XB_ERROR_RESPONSE) + 1);
+                return;
+            }
+
+            size_t pos = 2;
+
+            /* A bare "AT" just checks the module is listening */
+            if (lineLength == 2)
+            {
+                commandDeadline_uS = now + commandTimeout_uS();
+                respond((const uint8_t*)XB_DEFAULT_RESPONSE, strlen(XB_DEFAULT_RESPONSE));
+                return;
+            }
+
+            while (pos < lineLength)
+            {
+                size_t end = pos;
+                while ((end < lineLength) && (line[end] != ','))
+                {
+                    end++;
+                }
+
+                char c0 = (char)toupper(line[pos]);
+                char c1 = ((pos + 1) < end) ? (char)toupper(line[pos + 1]) : 0;
+
+                size_t paramStart = pos + 2;
+                while ((paramStart < end) && (line[paramStart] == ' '))
+                {
+                    paramStart++;
+                }
+
+                uint32_t param = 0;
+                bool hasParam = paramStart < end;
+                uint8_t status = XB_AT_STATUS_INVALID_COMMAND;
+                XBEmulatorRegister* reg = nullptr;
+
+                if (!c1 || (hasParam && !decodeHex(&line[paramStart], end - paramStart, param)))
+                {
+                    status = XB_AT_STATUS_INVALID_PARAMETER;
+                }
+                else
+                {
+                    status = execute(c0, c1, hasParam, param, reg);
+                }
+
+                if (status != XB_AT_STATUS_OK)
+                {
+                    /* The rest of the line is dropped after the first failure */
+                    respond((const uint8_t*)XB_ERROR_RESPONSE "\r", strlen(XB_ERROR_RESPONSE) + 1);
+                    return;
+                }
+
+                commandDeadline_uS = now + commandTimeout_uS();
+
+                if (reg)
+                {
+                    char text[XB_MAX_HEX_DIGITS + 1];
+                    size_t length = encodeHex(reg->value, text);
+                    text[length++] = XB_DELIMITER[0];
+                    respond((const uint8_t*)text, length);
+                }
+                else
+                {
+                    respond((const uint8_t*)XB_DEFAULT_RESPONSE, strlen(XB_DEFAULT_RESPONSE));
+                }
+
+                finishCommand();
+
+                if (!commandMode)
+                {
+                    /* ATCN/ATFR end the line too */
+                    return;
+                }
+
+                pos = end + 1;
+            }
+        }
+
+        void XBEmulator::receiveAPI(uint8_t byte)
+        {
+            if (decoder.push(byte) != XB_DECODE_COMPLETE)
+            {
+                return;
+            }
+
+            const uint8_t* frame = decoder.frameData();
+            size_t length = decoder.frameLength();
+
+            if ((decoder.frameType() == XB_FRAME_CREATE_SOURCE_ROUTE) && (length >= XB_SOURCE_ROUTE_HEADER_SIZE))
+            {
+                counters.sourceRoutes++;
+                sourceRoute64 = 0;
+                for (size_t i = 0; i < 8; i++)
+                {
+                    sourceRoute64 = (sourceRoute64 << 8) | frame[2 + i];
+                }
+                return;
+            }
+
+            if ((decoder.frameType() == XB_FRAME_TRANSMIT_REQUEST) && (length > XB_TRANSMIT_HEADER_SIZE))
+            {
+                transmit(frame, length);
+                return;
+            }
+
+            if ((decoder.frameType() == XB_FRAME_REMOTE_AT_COMMAND) && (length >= XB_REMOTE_AT_HEADER_SIZE))
+            {
+                remoteCommand(frame, length);
+                return;
+            }
+
+            if ((decoder.frameType() != XB_FRAME_AT_COMMAND) || (length < 4))
+            {
+                return;
+            }
+
+            uint8_t frameID = frame[1];
+            char c0 = (char)frame[2];
+            char c1 = (char)frame[3];
+
+            if (((c0 == 'N') && (c1 == 'D')) || ((c0 == 'D') && (c1 == 'N')))
+            {
+                discover(frame, length);
+                finishCommand();
+                return;
+            }
+            bool hasParam = length > 4;
+            uint32_t param = 0;
+
+            for (size_t i = 4; i < length; i++)
+            {
+                param = (param << 8) | frame[i];
+            }
+
+            XBEmulatorRegister* reg = nullptr;
+            uint8_t status = (length > 8) ? (uint8_t)XB_AT_STATUS_INVALID_PARAMETER : execute(c0, c1, hasParam, param, reg);
+
+            if (frameID)
+            {
+                uint8_t header[] = { XB_FRAME_AT_RESPONSE, frameID, (uint8_t)c0, (uint8_t)c1, status };
+                uint8_t value[4];
+                size_t valueLength = 0;
+
+                if (reg && (status == XB_AT_STATUS_OK))
+                {
+                    for (size_t i = 0; i < reg->width; i++)
+                    {
+                        value[valueLength++] = (uint8_t)(reg->value >> (8 * (reg->width - 1 - i)));
+                    }
+                }
+
+                uint8_t out[2 * (XB_API_FRAME_OVERHEAD + sizeof(header) + sizeof(value))];
+                size_t outLength = encodeAPIFrame(header, sizeof(header), value, valueLength, out, sizeof(out), apiMode());
+                respond(out, outLength);
+            }
+
+            finishCommand();
+        }
+
+        void XBEmulator::transmit(const uint8_t* frame, size_t length)
+        {
+            counters.transmits++;
+
+            uint64_t destination = 0;
+            for (size_t i = 0; i < 8; i++)
+            {
+                destination = (destination << 8) | frame[2 + i];
+            }
+
+            if (sourceRoute64 && (destination == sourceRoute64))
+            {
+                counters.sourceRoutedTransmits++;
+            }
+
+            /* There is no network behind the emulator, so transmissions are reported as delivered unless a failure
+             * was asked for */
+            bool fail = config.transmitFailEvery && ((counters.transmits % config.transmitFailEvery) == 0);
+
+            if (frame[1])
+            {
+                uint8_t status[] = { XB_FRAME_TRANSMIT_STATUS, frame[1], frame[10], frame[11], (uint8_t)(fail ? 3 : 0),
+                    (uint8_t)(fail ? XB_DELIVERY_NETWORK_ACK_FAILURE : XB_DELIVERY_SUCCESS), 0 };
+                uint8_t out[2 * (XB_API_FRAME_OVERHEAD + sizeof(status))];
+                size_t outLength = encodeAPIFrame(status, sizeof(status), nullptr, 0, out, sizeof(out), apiMode());
+                respond(out, outLength);
+            }
+
+            if (!fail && config.loopback)
+            {
+                loopback(frame, length);
+            }
+        }
+
+        void XBEmulator::loopback(const uint8_t* frame, size_t length)
+        {
+            /* Receive Packet: [type][64-bit source][16-bit source][options][data...], sent from the destination */
+            uint8_t packet[XB_API_MAX_FRAME_DATA];
+            size_t payloadLength = length - XB_TRANSMIT_HEADER_SIZE;
+
+            if ((XB_RECEIVE_HEADER_SIZE + payloadLength) > sizeof(packet))
+            {
+                return;
+            }
+
+            uint16_t source16 = (uint16_t)((frame[10] << 8) | frame[11]);
+            if (source16 == XB_ADDRESS_16_UNKNOWN)
+            {
+                source16 = 0x1234;
+            }
+
+            packet[0] = XB_FRAME_RECEIVE_PACKET;
+            memcpy(&packet[1], &frame[2], 8);
+            packet[9] = (uint8_t)(source16 >> 8);
+            packet[10] = (uint8_t)(source16 & 0xFF);
+            packet[11] = 0x01;
+            memcpy(&packet[XB_RECEIVE_HEADER_SIZE], &frame[XB_TRANSMIT_HEADER_SIZE], payloadLength);
+
+            size_t packetLength = XB_RECEIVE_HEADER_SIZE + payloadLength;
+            uint8_t out[2 * (XB_API_FRAME_OVERHEAD + XB_API_MAX_FRAME_DATA)];
+
+            if (config.routeRecords)
+            {
+                /* [0xA1][64-bit source][16-bit source][options][number of hops][hops...] */
+                uint8_t record[XB_ROUTE_RECORD_HEADER_SIZE + 6];
+                uint8_t hops = (uint8_t)(frame[9] % 4);
+
+                memcpy(record, packet, XB_ROUTE_RECORD_HEADER_SIZE - 1);
+                record[0] = XB_FRAME_ROUTE_RECORD;
+                record[12] = hops;
+                for (size_t i = 0; i < hops; i++)
+                {
+                    record[XB_ROUTE_RECORD_HEADER_SIZE + (2 * i)] = 0x20;
+                    record[XB_ROUTE_RECORD_HEADER_SIZE + (2 * i) + 1] = (uint8_t)i;
+                }
+
+                respond(out, encodeAPIFrame(record, XB_ROUTE_RECORD_HEADER_SIZE + (2 * (size_t)hops), nullptr, 0, out,
+                    sizeof(out), apiMode()));
+            }
+
+            if (config.loopbackSwapPairs && !heldLength)
+            {
+                memcpy(heldPacket, packet, packetLength);
+                heldLength = packetLength;
+                return;
+            }
+
+            size_t copies = 1;
+            counters.loopbacks++;
+            if (config.loopbackDuplicateEvery && ((counters.loopbacks % config.loopbackDuplicateEvery) == 0))
+            {
+                copies = 2;
+            }
+
+            for (size_t i = 0; i < copies; i++)
+            {
+                respond(out, encodeAPIFrame(packet, packetLength, nullptr, 0, out, sizeof(out), apiMode()));
+            }
+
+            if (heldLength)
+            {
+                counters.loopbacks++;
+                respond(out, encodeAPIFrame(heldPacket, heldLength, nullptr, 0, out, sizeof(out), apiMode()));
+                heldLength = 0;
+            }
+        }
+
+        void XBEmulator::remoteCommand(const uint8_t* frame, size_t length)
+        {
+            counters.remoteCommands++;
+
+            /* [0x17][frame ID][64-bit destination][16-bit destination][options][command][parameter...] */
+            uint64_t address64 = 0;
+            for (size_t i = 0; i < 8; i++)
+            {
+                address64 = (address64 << 8) | frame[2 + i];
+            }
+
+            char c0 = (char)frame[13];
+            char c1 = (char)frame[14];
+            size_t paramLength = length - XB_REMOTE_AT_HEADER_SIZE;
+            uint32_t param = 0;
+
+            for (size_t i = XB_REMOTE_AT_HEADER_SIZE; i < length; i++)
+            {
+                param = (param << 8) | frame[i];
+            }
+
+            size_t node = (size_t)(address64 - XB_EMULATOR_NODE_ADDRESS);
+            bool reachable = (address64 >= XB_EMULATOR_NODE_ADDRESS) && (node < config.remoteNodes);
+            bool fail = config.remoteFailEvery && ((counters.remoteCommands % config.remoteFailEvery) == 0);
+
+            uint8_t status = XB_AT_STATUS_OK;
+            XBEmulatorRegister* reg = find(c0, c1);
+            uint8_t value[4];
+            size_t valueLength = 0;
+
+            if (!reachable || fail)
+            {
+                status = XB_AT_STATUS_TX_FAILURE;
+            }
+            else if (((c0 == 'A') && (c1 == 'C')) || ((c0 == 'W') && (c1 == 'R')))
+            {
+                /* Remote changes take effect straight away here, so applying them has nothing left to do */
+                counters.remoteFlashWrites += (c0 == 'W') ? 1 : 0;
+            }
+            else if (!reg)
+            {
+                status = XB_AT_STATUS_INVALID_COMMAND;
+            }
+            else if (paramLength)
+            {
+                if (reg->readOnly)
+                {
+                    status = XB_AT_STATUS_ERROR;
+                }
+                else if ((paramLength > 4) || (param < reg->min) || (param > reg->max))
+                {
+                    status = XB_AT_STATUS_INVALID_PARAMETER;
+                }
+                else
+                {
+                    remoteRegisters[(node * XB_EMULATOR_REGISTER_COUNT) + (size_t)(reg - registers)] = param;
+                    counters.remoteWrites++;
+                }
+            }
+            else
+            {
+                uint32_t current = remoteRegisters[(node * XB_EMULATOR_REGISTER_COUNT) + (size_t)(reg - registers)];
+                for (size_t i = 0; i < reg->width; i++)
+                {
+                    value[valueLength++] = (uint8_t)(current >> (8 * (reg->width - 1 - i)));
+                }
+            }
+
+            if (!frame[1])
+            {
+                return;
+            }
+
+            /* [0x97][frame ID][64-bit source][16-bit source][command][status][value...] */
+            uint16_t address16 = reachable ? (uint16_t)(0x1000 + node) : XB_ADDRESS_16_UNKNOWN;
+            uint8_t header[15] = { XB_FRAME_REMOTE_AT_RESPONSE, frame[1] };
+
+            memcpy(&header[2], &frame[2], 8);
+            header[10] = (uint8_t)(address16 >> 8);
+            header[11] = (uint8_t)address16;
+            header[12] = (uint8_t)c0;
+            header[13] = (uint8_t)c1;
+            header[14] = status;
+
+            uint8_t out[2 * (XB_API_FRAME_OVERHEAD + sizeof(header) + sizeof(value))];
+            size_t outLength = encodeAPIFrame(header, sizeof(header), value, valueLength, out, sizeof(out), apiMode());
+
+            if (!config.remoteLatency_uS)
+            {
+                respond(out, outLength);
+                return;
+            }
+
+            /* Hold the response for the round trip; the run loop sends it once it's due */
+            DelayedFrame response;
+            response.due_uS = now_uS() + config.remoteLatency_uS;
+            response.data.assign(out, out + outLength);
+            delayed.push_back(std::move(response));
+
+            if (delayed.size() > counters.remoteInFlightHighWater)
+            {
+                counters.remoteInFlightHighWater = delayed.size();
+            }
+        }
+
+        void XBEmulator::discover(const uint8_t* frame, size_t length)
+        {
+            counters.commands++;
+
+            /* ATDN resolves exactly one identifier, ATND optionally filters on one */
+            bool resolve = (frame[2] == 'D');
+            const char* wanted = reinterpret_cast<const char*>(&frame[4]);
+            size_t wantedLength = length - 4;
+            size_t answers = 0;
+
+            uint8_t header[] = { XB_FRAME_AT_RESPONSE, frame[1], frame[2], frame[3], XB_AT_STATUS_OK };
+            uint8_t out[2 * (XB_API_FRAME_OVERHEAD + XB_API_MAX_FRAME_DATA)];
+
+            for (size_t i = 0; (i < config.remoteNodes) && !(resolve && !wantedLength); i++)
+            {
+                char id[21];
+                size_t idLength = (size_t)snprintf(id, sizeof(id), "NODE%zu", i);
+
+                if (wantedLength && ((wantedLength != idLength) || memcmp(wanted, id, idLength)))
+                {
+                    continue;
+                }
+
+                /* [MY][SH][SL], and for ATND [NI][0][parent][device type][status][profile][manufacturer] */
+                uint64_t address64 = XB_EMULATOR_NODE_ADDRESS + i;
+                uint16_t address16 = (uint16_t)(0x1000 + i);
+                uint8_t record[10 + sizeof(id) + 8];
+                size_t recordLength = 0;
+
+                record[recordLength++] = (uint8_t)(address16 >> 8);
+                record[recordLength++] = (uint8_t)address16;
+                for (size_t b = 0; b < 8; b++)
+                {
+                    record[recordLength++] = (uint8_t)(address64 >> (8 * (7 - b)));
+                }
+
+                if (!resolve)
+                {
+                    memcpy(&record[recordLength], id, idLength + 1);
+                    recordLength += idLength + 1;
+
+                    const uint8_t trailer[] = { 0xFF, 0xFE, 0x01, 0x00, 0xC1, 0x05, 0x10, 0x1E };
+                    memcpy(&record[recordLength], trailer, sizeof(trailer));
+                    recordLength += sizeof(trailer);
+                }
+
+                if (frame[1])
+                {
+                    respond(out, encodeAPIFrame(header, sizeof(header), record, recordLength, out, sizeof(out),
+                        apiMode()));
+                }
+
+                answers++;
+                if (resolve)
+                {
+                    break;
+                }
+            }
+
+            if (resolve && !answers && frame[1])
+            {
+                header[4] = XB_AT_STATUS_ERROR;
+                respond(out, encodeAPIFrame(header, sizeof(header), nullptr, 0, out, sizeof(out), apiMode()));
+            }
+        }
+
+        uint8_t XBEmulator::execute(char c0, char c1, bool hasParam, uint32_t param, XBEmulatorRegister*& reg)
+        {
+            reg = nullptr;
+            counters.commands++;
+
+            /* Execution commands */
+            if (!hasParam)
+            {
+                if ((c0 == 'C') && (c1 == 'N'))
+                {
+                    commandMode = false;
+                    applyPending = true;
+                    return XB_AT_STATUS_OK;
+                }
+                else if ((c0 == 'A') && (c1 == 'C'))
+                {
+                    applyPending = true;
+                    return XB_AT_STATUS_OK;
+                }
+                else if ((c0 == 'W') && (c1 == 'R'))
+                {
+                    for (size_t i = 0; i < XB_EMULATOR_REGISTER_COUNT; i++)
+                    {
+                        registers[i].persisted = registers[i].value;
+                    }
+
+                    counters.flashWrites++;
+                    return XB_AT_STATUS_OK;
+                }
+                else if ((c0 == 'R') && (c1 == 'E'))
+                {
+                    for (size_t i = 0; i < XB_EMULATOR_REGISTER_COUNT; i++)
+                    {
+                        if (!registers[i].readOnly)
+                        {
+                            registers[i].value = registers[i].defaultValue;
+                        }
+                    }
+
+                    return XB_AT_STATUS_OK;
+                }
+                else if ((c0 == 'F') && (c1 == 'R'))
+                {
+                    resetPending = true;
+                    return XB_AT_STATUS_OK;
+                }
+            }
+
+            reg = find(c0, c1);
+            if (!reg)
+            {
+                return XB_AT_STATUS_INVALID_COMMAND;
+            }
+
+            if (!hasParam)
+            {
+                return XB_AT_STATUS_OK;
+            }
+
+            XBEmulatorRegister* target = reg;
+            reg = nullptr;
+
+            if (target->readOnly || (param < target->min) || (param > target->max))
+            {
+                return XB_AT_STATUS_INVALID_PARAMETER;
+            }
+
+            target->value = param;
+            return XB_AT_STATUS_OK;
+        }
+
+        void XBEmulator::finishCommand()
+        {
+            if (resetPending)
+            {
+                resetPending = false;
+                applyPending = false;
+                loadPersisted();
+            }
+            else if (applyPending)
+            {
+                applyPending = false;
+                apply();
+            }
+        }
+
+        void XBEmulator::apply()
+        {
+            XBAPIMode previous = apiMode();
+
+            for (size_t i = 0; i < XB_EMULATOR_REGISTER_COUNT; i++)
+            {
+                registers[i].active = registers[i].value;
+            }
+
+            if (apiMode() != previous)
+            {
+                decoder.setMode(apiMode());
+            }
+        }
+
+        void XBEmulator::loadPersisted()
+        {
+            for (size_t i = 0; i < XB_EMULATOR_REGISTER_COUNT; i++)
+            {
+                registers[i].value = registers[i].persisted;
+                registers[i].active = registers[i].persisted;
+            }
+
+            commandMode = false;
+            sequenceCount = 0;
+            anyRx = false;
+            decoder.setMode(apiMode());
+        }
+
+        XBEmulatorRegister* XBEmulator::find(char c0, char c1)
+        {
+            for (size_t i = 0; i < XB_EMULATOR_REGISTER_COUNT; i++)
+            {
+                if ((registers[i].code[0] == c0) && (registers[i].code[1] == c1))
+                {
+                    return &registers[i];
+                }
+            }
+
+            return nullptr;
+        }
+
+        XBAPIMode XBEmulator::apiMode()
+        {
+            return (XBAPIMode)find('A', 'P')->active;
+        }
+
+        uint64_t XBEmulator::guardTime_uS()
+        {
+            return (uint64_t)find('G', 'T')->active * 1000u;
+        }
+
+        uint64_t XBEmulator::commandTimeout_uS()
+        {
+            return (uint64_t)find('C', 'T')->active * XB_AT_TIMEOUT_MULT * 1000u;
+        }
+
+        bool XBEmulator::hostBaudMatches()
+        {
+            struct termios2 tio;
+
+            if (ioctl(slaveFd, TCGETS2, &tio) < 0)
+            {
+                return true;
+            }
+
+            return tio.c_ospeed == registerToBaud(find('B', 'D')->active);
+        }
+
+        void XBEmulator::respond(const uint8_t* data, size_t length)
+        {
+            if (config.maxCleanBaud && (registerToBaud(find('B', 'D')->active) > config.maxCleanBaud))
+            {
+                counters.lostResponses++;
+                return;
+            }
+
+            uint64_t delay_uS = config.responseDelay_uS;
+
+            if (config.simulateLineRate)
+            {
+                /* 10 bits per byte at 8N1 */
+                delay_uS += ((uint64_t)length * 10u * 1000000u) / registerToBaud(find('B', 'D')->active);
+            }
+
+            if (delay_uS)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(delay_uS));
+            }
+
+            while (length)
+            {
+                ssize_t written = ::write(masterFd, data, length);
+
+                if (written > 0)
+                {
+                    data += written;
+                    length -= (size_t)written;
+                }
+                else if ((written < 0) && (errno != EAGAIN) && (errno != EINTR))
+                {
+                    break;
+                }
+                else
+                {
+                    struct pollfd pfd = { masterFd, POLLOUT, 0 };
+                    poll(&pfd, 1, 10);
+                }
+            }
+        }
+
+        bool XBEmulator::setRegister(const char* command, uint32_t value)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            command = commandCode(command);
+            XBEmulatorRegister* reg = command ? find(command[0], command[1]) : nullptr;
+
+            if (!reg)
+            {
+                return false;
+            }
+
+            XBAPIMode previous = apiMode();
+            reg->value = value;
+            reg->active = value;
+            reg->persisted = value;
+
+            if (apiMode() != previous)
+            {
+                decoder.setMode(apiMode());
+            }
+
+            return true;
+        }
+
+        bool XBEmulator::getRegister(const char* command, uint32_t& value)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            command = commandCode(command);
+            XBEmulatorRegister* reg = command ? find(command[0], command[1]) : nullptr;
+
+            if (!reg)
+            {
+                return false;
+            }
+
+            value = reg->value;
+            return true;
+        }
+
+        bool XBEmulator::getRemoteRegister(size_t index, const char* command, uint32_t& value)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            command = commandCode(command);
+            XBEmulatorRegister* reg = command ? find(command[0], command[1]) : nullptr;
+
+            if (!reg || (index >= config.remoteNodes))
+            {
+                return false;
+            }
+
+            value = remoteRegisters[(index * XB_EMULATOR_REGISTER_COUNT) + (size_t)(reg - registers)];
+            return true;
+        }
+
+        bool XBEmulator::setRemoteRegister(size_t index, const char* command, uint32_t value)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            command = commandCode(command);
+            XBEmulatorRegister* reg = command ? find(command[0], command[1]) : nullptr;
+
+            if (!reg || (index >= config.remoteNodes))
+            {
+                return false;
+            }
+
+            remoteRegisters[(index * XB_EMULATOR_REGISTER_COUNT) + (size_t)(reg - registers)] = value;
+            return true;
+        }
+
+        bool XBEmulator::isCommandMode()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return commandMode;
+        }
+
+        void XBEmulator::powerCycle()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            loadPersisted();
+            counters.powerCycles++;
+
+            /* Whatever was still on its way out is lost with the old state */
+            delayed.clear();
+            bootEnd_uS = now_uS() + config.bootTime_uS;
+
+            if (apiMode() != XB_API_DISABLED)
+            {
+                const uint8_t status[] = { XB_FRAME_MODEM_STATUS, 0x00 };
+                uint8_t out[2 * (XB_API_FRAME_OVERHEAD + sizeof(status))];
+                size_t outLength = encodeAPIFrame(status, sizeof(status), nullptr, 0, out, sizeof(out), apiMode());
+
+                DelayedFrame announcement;
+                announcement.due_uS = bootEnd_uS;
+                announcement.data.assign(out, out + outLength);
+                delayed.push_back(std::move(announcement));
+            }
+
+            uint64_t wake = 1;
+            ssize_t result = ::write(wakeFd, &wake, sizeof(wake));
+            (void)result;
+        }
+
+        uint32_t XBEmulator::baud()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return registerToBaud(find('B', 'D')->active);
+        }
+
+        XBEmulatorStats XBEmulator::stats()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            return counters;
+        }
+
+        void XBEmulator::resetStats()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            counters = XBEmulatorStats();
+        }
+    }
+}
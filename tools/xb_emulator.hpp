@@ -0,0 +1,238 @@
+/**
+ * @file xb_emulator.hpp
+ */
+
+#ifndef XBEE_EMULATOR_HPP
+#define XBEE_EMULATOR_HPP
+
+/* C/C++ Includes */
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* LibXBEE Includes */
+#include <libxbee/include/xb_definitions.hpp>
+#include <libxbee/include/xb_api_frame.hpp>
+
+#define XB_EMULATOR_REGISTER_COUNT  16      /**< Entries in the emulator's register table */
+#define XB_EMULATOR_MAX_LINE        64      /**< Longest AT command line accepted before it's thrown away */
+#define XB_EMULATOR_NODE_ADDRESS    ((uint64_t)0x0013A20041000000)  /**< 64-bit address of the first remote node */
+
+namespace libxbee
+{
+    namespace emulator
+    {
+        struct XBEmulatorConfig
+        {
+            uint32_t baud = 9600;               /**< Rate the emulated UART starts at, before any ATBD change */
+            size_t responseDelay_uS = 0;        /**< Processing time added in front of every response */
+            bool simulateLineRate = false;      /**< Hold each response back for the time it would take on the wire */
+            uint32_t maxCleanBaud = 0;          /**< Responses are lost above this rate, to exercise link checks. 0 = never. */
+            size_t transmitFailEvery = 0;       /**< Every Nth Transmit Request reports a network ACK failure. 0 = never. */
+            bool loopback = false;              /**< Delivered payloads come back as Receive Packets from the destination */
+            bool loopbackSwapPairs = false;     /**< Looped back packets are returned in swapped pairs, out of order */
+            size_t loopbackDuplicateEvery = 0;  /**< Every Nth looped back packet is delivered twice. 0 = never. */
+            size_t remoteNodes = 0;             /**< Nodes answering ATND/ATDN, named "NODE0"... at 0x1000 + n */
+            bool routeRecords = false;          /**< Looped back packets follow a Route Record (0xA1) of address % 4 hops */
+            size_t remoteLatency_uS = 0;        /**< RF round trip added in front of every Remote AT Command Response */
+            size_t remoteFailEvery = 0;         /**< Every Nth Remote AT Command reports a transmit failure. 0 = never. */
+            size_t bootTime_uS = 0;             /**< Time after a power cycle during which the module ignores the host */
+        };
+
+        struct XBEmulatorStats
+        {
+            size_t commands = 0;                /**< AT commands and AT Command frames executed */
+            size_t commandModeEntries = 0;      /**< Accepted "+++" sequences */
+            size_t guardViolations = 0;         /**< "+++" sequences rejected for breaking the guard times */
+            size_t commandModeExpiries = 0;     /**< Times command mode ended because ATCT ran out */
+            size_t flashWrites = 0;             /**< ATWR executions */
+            size_t baudMismatchBytes = 0;       /**< Bytes dropped because the host tty wasn't at the module's rate */
+            size_t lostResponses = 0;           /**< Responses dropped because of maxCleanBaud */
+            size_t transmits = 0;               /**< Transmit Request (0x10) frames received */
+            size_t loopbacks = 0;               /**< Receive Packet (0x90) frames sent back by loopback */
+            size_t sourceRoutes = 0;            /**< Create Source Route (0x21) frames received */
+            size_t sourceRoutedTransmits = 0;   /**< Transmit Requests sent right after a source route to their destination */
+            size_t remoteCommands = 0;          /**< Remote AT Command (0x17) frames received */
+            size_t remoteWrites = 0;            /**< Remote register writes that succeeded */
+            size_t remoteFlashWrites = 0;       /**< Remote ATWR executions */
+            size_t remoteInFlightHighWater = 0; /**< Most Remote AT Command Responses waiting on remoteLatency_uS at once */
+            size_t powerCycles = 0;             /**< Simulated power cycles and hardware resets */
+            size_t bootDroppedBytes = 0;        /**< Bytes received while the module was still booting */
+        };
+
+        /** A single emulated register */
+        struct XBEmulatorRegister
+        {
+            char code[3];
+            uint8_t width;                      /**< Bytes used for the value in API responses */
+            uint32_t min;
+            uint32_t max;
+            bool readOnly;
+            uint32_t defaultValue;
+            uint32_t value;                     /**< What a read reports, including queued changes */
+            uint32_t active;                    /**< What the module is actually running with */
+            uint32_t persisted;                 /**< What survives a reset */
+        };
+
+        /** Software XBee over a Pseudo-Terminal
+         *  Emulates an XBee Pro S2 well enough to exercise the driver without hardware. The host side opens
+         *  devicePath() as if it were a USB serial adapter, and the emulator thread answers on the master side.
+         *
+         *  What is modeled:
+         *  - "+++" is only accepted with a full GT of silence before and after it, and only with the CC character
+         *  - Command mode ends after CT of inactivity, or on ATCN
+         *  - AT lines with comma separated commands, answered one "\r" terminated line per command
+         *  - Register changes are queued until ATAC/ATCN, ATWR persists them and ATRE/ATFR restore them
+         *  - AP=1/2 switches to API mode, where AT Command (0x08) frames are answered with 0x88 responses and
+         *    Transmit Requests (0x10) with a successful Transmit Status (0x8B), optionally looped back as Receive
+         *    Packets (0x90)
+         *  - ATND and ATDN in API mode, answered by remoteNodes simulated nodes
+         *  - Route Record Indicators (0xA1) ahead of looped back packets, and Create Source Route (0x21) frames
+         *  - Remote AT Commands (0x17) to the simulated nodes, each with its own copy of the writable registers and
+         *    an optional RF round trip, during which other frames are still answered
+         *  - The module only understands the host while the pty is configured at the ATBD rate
+         *  - A power cycle takes bootTime_uS, after which a module in API mode reports a hardware reset with a Modem
+         *    Status (0x8A) frame
+         **/
+        class XBEmulator
+        {
+        public:
+            /** Creates the pty pair and starts answering on it
+             *  @return XB_OK, or XB_UNKNOWN_ERROR if the pty couldn't be created */
+            XBStatus start();
+
+            /** Stops the emulator thread and closes the pty */
+            void stop();
+
+            /** Path the driver should open, e.g. "/dev/pts/3" */
+            const char* devicePath() { return slavePath; }
+
+            /** Sets a register's running and persisted value, e.g. to start with a short guard time */
+            bool setRegister(const char* command, uint32_t value);
+
+            /** Reads a register's running value */
+            bool getRegister(const char* command, uint32_t& value);
+
+            /** Reads a register of simulated remote node index, as left by Remote AT Commands */
+            bool getRemoteRegister(size_t index, const char* command, uint32_t& value);
+
+            /** Sets a register of simulated remote node index */
+            bool setRemoteRegister(size_t index, const char* command, uint32_t value);
+
+            /** True while the module is in AT command mode */
+            bool isCommandMode();
+
+            /** Simulates a power cycle, or a pulse of the reset pin: leaves command mode, reloads the persisted
+             *  register values and boots, see bootTime_uS */
+            void powerCycle();
+
+            /** Rate the emulated UART is running at */
+            uint32_t baud();
+
+            XBEmulatorStats stats();
+            void resetStats();
+
+            XBEmulator(const XBEmulatorConfig& config = XBEmulatorConfig());
+            ~XBEmulator();
+
+        private:
+            XBEmulatorConfig config;
+            XBEmulatorStats counters;
+            XBEmulatorRegister registers[XB_EMULATOR_REGISTER_COUNT];
+
+            int masterFd = -1;
+            int slaveFd = -1;                   /**< Held open so the host can come and go, and to read its tty settings */
+            int wakeFd = -1;
+            char slavePath[64] = { 0 };
+
+            std::thread worker;
+            std::atomic<bool> running{ false };
+            std::mutex lock;
+
+            /** Until when the module is booting and deaf to the host, 0 once it's up */
+            uint64_t bootEnd_uS = 0;
+
+            /* Transparent mode "+++" detection */
+            uint64_t lastRx_uS = 0;
+            bool anyRx = false;
+            uint8_t sequenceCount = 0;
+            uint64_t sequenceEnd_uS = 0;
+
+            /* Command mode */
+            bool commandMode = false;
+            uint64_t commandDeadline_uS = 0;
+            char line[XB_EMULATOR_MAX_LINE];
+            size_t lineLength = 0;
+            bool lineOverflow = false;
+
+            XBAPIDecoder decoder;
+            bool applyPending = false;
+            bool resetPending = false;
+
+            void run();
+            void receive(const uint8_t* data, size_t length, uint64_t now_uS);
+            void receiveTransparent(uint8_t byte, uint64_t now_uS);
+            void receiveCommand(uint8_t byte, uint64_t now_uS);
+            void receiveAPI(uint8_t byte);
+            void transmit(const uint8_t* frame, size_t length);
+            void loopback(const uint8_t* frame, size_t length);
+
+            /** Answers an ATND or ATDN frame for the simulated remote nodes */
+            void discover(const uint8_t* frame, size_t length);
+
+            /** Answers a Remote AT Command frame addressed to one of the simulated remote nodes */
+            void remoteCommand(const uint8_t* frame, size_t length);
+
+            /** Register values of the simulated remote nodes, XB_EMULATOR_REGISTER_COUNT per node */
+            std::vector<uint32_t> remoteRegisters;
+
+            /** Remote AT Command Responses waiting out remoteLatency_uS, and the Modem Status waiting out the boot */
+            struct DelayedFrame
+            {
+                uint64_t due_uS;
+                std::vector<uint8_t> data;
+            };
+            std::vector<DelayedFrame> delayed;
+
+            /* Destination of the last Create Source Route, 0 if none */
+            uint64_t sourceRoute64 = 0;
+
+            /* A looped back Receive Packet held back by loopbackSwapPairs */
+            uint8_t heldPacket[XB_API_MAX_FRAME_DATA];
+            size_t heldLength = 0;
+            void expire(uint64_t now_uS);
+
+            /** Executes every command on one AT line and sends the responses */
+            void executeLine(uint64_t now_uS);
+
+            /** Executes a single command
+             *
+             *  @param[in]  c0, c1      Command code
+             *  @param[in]  hasParam    True for a register write
+             *  @param[in]  param       The value to write
+             *  @param[out] reg         The register read, if the command was a read
+             *  @return     uint8_t     One of XBATResponseStatus
+             **/
+            uint8_t execute(char c0, char c1, bool hasParam, uint32_t param, XBEmulatorRegister*& reg);
+
+            /** Makes queued register changes take effect. Called once the response has gone out. */
+            void apply();
+
+            /** Acts on applyPending/resetPending after a response */
+            void finishCommand();
+
+            void loadPersisted();
+            XBEmulatorRegister* find(char c0, char c1);
+            XBAPIMode apiMode();
+            uint64_t guardTime_uS();
+            uint64_t commandTimeout_uS();
+            bool hostBaudMatches();
+            void respond(const uint8_t* data, size_t length);
+        };
+    }
+}
+
+#endif /* !XBEE_EMULATOR_HPP */